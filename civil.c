@@ -0,0 +1,214 @@
+/*
+ * Calendar date arithmetic
+ *
+ * Copyright:
+ *	(C) 1999-2023 Craig Knudsen, craig@k5n.us
+ *	See accompanying file "COPYING".
+ *
+ *	This program is free software; you can redistribute it and/or
+ *	modify it under the terms of the GNU General Public License
+ *	as published by the Free Software Foundation; either version 2
+ *	of the License, or (at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program; if not, write to the
+ *	Free Software Foundation, Inc., 59 Temple Place,
+ *	Suite 330, Boston, MA  02111-1307, USA
+ *
+ * History:
+ *	16-Oct-2026	Created
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "civil.h"
+
+#ifdef GTIMER_MEMDEBUG
+#include "memdebug/memdebug.h"
+#endif
+
+/*
+** The calculations below count years from 1 March so that the leap
+** day is the last day of the year, and work in 400 year eras, which
+** always have 146097 days.  719468 is the number of days from
+** 1 Mar 0000 to 1 Jan 1970.
+*/
+#define DAYS_PER_ERA		146097
+#define EPOCH_OFFSET		719468
+
+static int month_days[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+
+
+int civilIsLeapYear ( year )
+int year;
+{
+  return ( ( year % 4 == 0 && year % 100 != 0 ) || year % 400 == 0 );
+}
+
+
+/*
+** Number of days in a month (1-12).
+*/
+int civilDaysInMonth ( year, month )
+int year, month;
+{
+  if ( month == 2 && civilIsLeapYear ( year ) )
+    return ( 29 );
+  return ( month_days[month - 1] );
+}
+
+
+/*
+** Convert a date (month 1-12, mday 1-31) to a day number.
+*/
+int civilDays ( year, month, mday )
+int year, month, mday;
+{
+  int era, year_of_era, day_of_year, day_of_era;
+
+  if ( month <= 2 )
+    year--;
+  era = ( year >= 0 ? year : year - 399 ) / 400;
+  year_of_era = year - era * 400;
+  day_of_year = ( 153 * ( month > 2 ? month - 3 : month + 9 ) + 2 ) / 5 +
+    mday - 1;
+  day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 +
+    day_of_year;
+
+  return ( era * DAYS_PER_ERA + day_of_era - EPOCH_OFFSET );
+}
+
+
+/*
+** Convert a day number to a date (month 1-12, mday 1-31).
+*/
+void civilDate ( days, year, month, mday )
+int days;
+int *year, *month, *mday;
+{
+  int era, day_of_era, year_of_era, day_of_year, mp;
+
+  days += EPOCH_OFFSET;
+  era = ( days >= 0 ? days : days - DAYS_PER_ERA + 1 ) / DAYS_PER_ERA;
+  day_of_era = days - era * DAYS_PER_ERA;
+  year_of_era = ( day_of_era - day_of_era / 1460 + day_of_era / 36524 -
+    day_of_era / ( DAYS_PER_ERA - 1 ) ) / 365;
+  day_of_year = day_of_era - ( 365 * year_of_era + year_of_era / 4 -
+    year_of_era / 100 );
+  mp = ( 5 * day_of_year + 2 ) / 153;
+
+  *mday = day_of_year - ( 153 * mp + 2 ) / 5 + 1;
+  *month = mp < 10 ? mp + 3 : mp - 9;
+  *year = year_of_era + era * 400 + ( *month <= 2 );
+}
+
+
+/*
+** Day of the week (0=Sunday).  1 Jan 1970 was a Thursday.
+*/
+int civilWeekday ( days )
+int days;
+{
+  return ( days >= -4 ? ( days + 4 ) % 7 : ( days + 5 ) % 7 + 6 );
+}
+
+
+/*
+** Is this the last day of a week that starts on start_of_week
+** (0=Sunday)?
+*/
+int civilIsLastDayOfWeek ( days, start_of_week )
+int days;
+int start_of_week;
+{
+  return ( civilWeekday ( days ) == ( start_of_week + 6 ) % 7 );
+}
+
+
+int civilIsLastDayOfMonth ( days )
+int days;
+{
+  int year, month, mday;
+
+  civilDate ( days, &year, &month, &mday );
+  return ( mday == civilDaysInMonth ( year, month ) );
+}
+
+
+int civilIsLastDayOfYear ( days )
+int days;
+{
+  int year, month, mday;
+
+  civilDate ( days, &year, &month, &mday );
+  return ( month == 12 && mday == 31 );
+}
+
+
+/*
+** Fill in the date fields of a struct tm (for strftime()).
+** The time of day is set to midnight.
+*/
+void civilToTm ( days, tm )
+int days;
+struct tm *tm;
+{
+  int year, month, mday;
+
+  civilDate ( days, &year, &month, &mday );
+  memset ( tm, '\0', sizeof ( struct tm ) );
+  tm->tm_year = year - 1900;
+  tm->tm_mon = month - 1;
+  tm->tm_mday = mday;
+  tm->tm_wday = civilWeekday ( days );
+  tm->tm_yday = days - civilDays ( year, 1, 1 );
+  tm->tm_isdst = -1;
+}
+
+
+/*
+** The current day in the local time zone.  Times less than
+** midnight_offset seconds after midnight count as the day before.
+*/
+int civilToday ( midnight_offset )
+int midnight_offset;
+{
+  time_t now;
+  struct tm *tm;
+
+  time ( &now );
+  now -= midnight_offset;
+  tm = localtime ( &now );
+  return ( civilDays ( tm->tm_year + 1900, tm->tm_mon + 1, tm->tm_mday ) );
+}
+
+
+/*
+** Parse a date in YYYY-MM-DD format.
+** Returns 0 on success or CIVIL_ERROR_BAD_DATE.
+*/
+int civilParseDate ( str, days )
+char *str;
+int *days;
+{
+  int year, month, mday;
+  char extra;
+
+  if ( sscanf ( str, "%d-%d-%d%c", &year, &month, &mday, &extra ) != 3 )
+    return ( CIVIL_ERROR_BAD_DATE );
+  if ( year < 1 || year > 9999 || month < 1 || month > 12 || mday < 1 ||
+    mday > civilDaysInMonth ( year, month ) )
+    return ( CIVIL_ERROR_BAD_DATE );
+
+  *days = civilDays ( year, month, mday );
+  return ( 0 );
+}
@@ -0,0 +1,59 @@
+/*
+ * Calendar date arithmetic
+ *
+ * Copyright:
+ *	(C) 1999-2023 Craig Knudsen, craig@k5n.us
+ *	See accompanying file "COPYING".
+ *
+ *	This program is free software; you can redistribute it and/or
+ *	modify it under the terms of the GNU General Public License
+ *	as published by the Free Software Foundation; either version 2
+ *	of the License, or (at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program; if not, write to the
+ *	Free Software Foundation, Inc., 59 Temple Place,
+ *	Suite 330, Boston, MA  02111-1307, USA
+ *
+ * Description:
+ *	A day is represented by the number of days since 1 Jan 1970
+ *	(which may be negative) in the proleptic Gregorian calendar.
+ *	Stepping through days is then just adding one, and converting
+ *	to and from year/month/day is done with integer arithmetic
+ *	rather than with localtime() and mktime(), so it does not depend
+ *	on the time zone or daylight saving time and is thread-safe.
+ *	Only civilToday() looks at the clock and the time zone.
+ *
+ * History:
+ *	16-Oct-2026	Created
+ */
+
+
+#ifndef _CIVIL_H
+#define _CIVIL_H
+
+/* Errors */
+#define CIVIL_ERROR_BAD_DATE	1	/* not a valid YYYY-MM-DD date */
+
+/*
+ * Functions
+ */
+
+int civilIsLeapYear ( int year );
+int civilDaysInMonth ( int year, int month );
+int civilDays ( int year, int month, int mday );
+void civilDate ( int days, int *year, int *month, int *mday );
+int civilWeekday ( int days );
+int civilIsLastDayOfWeek ( int days, int start_of_week );
+int civilIsLastDayOfMonth ( int days );
+int civilIsLastDayOfYear ( int days );
+void civilToTm ( int days, struct tm *tm );
+int civilToday ( int midnight_offset );
+int civilParseDate ( char *str, int *days );
+
+#endif /* _CIVIL_H */
@@ -25,6 +25,8 @@
  *	https://www.k5n.us/gtimer/
  *
  * History:
+ *	16-Oct-2026	Added report-threads setting.
+ *	16-Oct-2026	Added journal, snapshot and load-threads settings.
  *	17-Apr-2005	Added configurability of the browser. (Russ Allbery)
  *	04-Apr-98	Created
  *			(Code stolen from another project/program I wrote.)
@@ -58,6 +60,11 @@
 #define CONFIG_NEXT_VERSION_CHECK	"next_version_check"
 #define CONFIG_LAST_TIMED_TASKS		"timed_tasks"
 #define CONFIG_BROWSER			"browser"
+#define CONFIG_JOURNAL			"journal"
+#define CONFIG_JOURNAL_MAX		"journal-max"
+#define CONFIG_SNAPSHOT			"snapshot"
+#define CONFIG_LOAD_THREADS		"load-threads"
+#define CONFIG_REPORT_THREADS		"report-threads"
 
 /* default values */
 #ifdef CONFIG_DEFAULTS
@@ -74,6 +81,11 @@ static char *default_config[] = {
   CONFIG_MAIN_WINDOW_WIDTH, "500",
   CONFIG_MAIN_WINDOW_HEIGHT, "400",
   CONFIG_NEXT_VERSION_CHECK, "0",
+  CONFIG_JOURNAL, "1",
+  CONFIG_JOURNAL_MAX, "65536",
+  CONFIG_SNAPSHOT, "1",
+  CONFIG_LOAD_THREADS, "4",
+  CONFIG_REPORT_THREADS, "4",
 
   /* rra 2005-07-15: Changed to sensible-browser for Debian. */
   CONFIG_BROWSER, "sensible-browser",
@@ -1,3 +1,10 @@
+#include <time.h>
+#include <string.h>
+
+#include "project.h"
+#include "task.h"
+#include "gtimer.h"
+
 #include "custom-list.h"
 
 
@@ -166,12 +173,20 @@ custom_list_init (CustomList *custom_list)
 
   custom_list->column_types[0] = G_TYPE_POINTER;  /* CUSTOM_LIST_COL_RECORD    */
   custom_list->column_types[1] = G_TYPE_STRING;   /* CUSTOM_LIST_COL_NAME      */
+  custom_list->column_types[2] = G_TYPE_STRING;   /* CUSTOM_LIST_COL_PROJECT   */
+  custom_list->column_types[3] = G_TYPE_STRING;   /* CUSTOM_LIST_COL_TODAY     */
+  custom_list->column_types[4] = G_TYPE_STRING;   /* CUSTOM_LIST_COL_TOTAL     */
+  custom_list->column_types[5] = G_TYPE_BOOLEAN;  /* CUSTOM_LIST_COL_TIMER_ON  */
 //  custom_list->column_types[2] = G_TYPE_UINT;     /* CUSTOM_LIST_COL_YEAR_BORN */
 
-  g_assert (CUSTOM_LIST_N_COLUMNS == 2);
+  g_assert (CUSTOM_LIST_N_COLUMNS == 6);
 
   custom_list->num_rows = 0;
   custom_list->rows     = NULL;
+  custom_list->tasks    = NULL;
+  custom_list->num_tasks   = 0;
+  custom_list->filter      = NULL;
+  custom_list->filter_rows = NULL;
 
 //  custom_list->stamp = g_random_int();  /* Random int to check whether an iter belongs to our model */
 
@@ -205,6 +220,8 @@ custom_list_finalize (GObject *object)
  *                         we have a list model (instead of a tree), and each
  *                         tree iter is valid as long as the row in question
  *                         exists, as it only contains a pointer to our struct.
+ *                         Task list iters hold a row number, which changes
+ *                         when rows are inserted or deleted above it.
  *
  *****************************************************************************/
 
@@ -213,6 +230,9 @@ custom_list_get_flags (GtkTreeModel *tree_model)
 {
   g_return_val_if_fail (CUSTOM_IS_LIST(tree_model), (GtkTreeModelFlags)0);
 
+  if (CUSTOM_LIST(tree_model)->tasks != NULL)
+    return GTK_TREE_MODEL_LIST_ONLY;
+
   return (GTK_TREE_MODEL_LIST_ONLY | GTK_TREE_MODEL_ITERS_PERSIST);
 }
 
@@ -251,6 +271,23 @@ custom_list_get_column_type (GtkTreeModel *tree_model,
 }
 
 
+/*****************************************************************************
+ *
+ *  custom_list_row_task: returns the task shown in row n of a task list.
+ *
+ *****************************************************************************/
+
+static TaskData *
+custom_list_row_task (CustomList *custom_list,
+                      gint        n)
+{
+  if (custom_list->filter != NULL)
+    n = custom_list->filter[n];
+
+  return (*custom_list->tasks)[n];
+}
+
+
 /*****************************************************************************
  *
  *  custom_list_get_iter: converts a tree path (physical position) into a
@@ -286,6 +323,15 @@ custom_list_get_iter (GtkTreeModel *tree_model,
   if ( n >= custom_list->num_rows || n < 0 )
     return FALSE;
 
+  /* For a task list, store the task and its row number */
+  if (custom_list->tasks != NULL)
+  {
+    iter->user_data  = custom_list_row_task(custom_list, n);
+    iter->user_data2 = GINT_TO_POINTER(n);
+    iter->user_data3 = NULL;   /* unused */
+    return TRUE;
+  }
+
   record = custom_list->rows[n];
 
   g_assert(record != NULL);
@@ -322,15 +368,72 @@ custom_list_get_path (GtkTreeModel *tree_model,
 
   custom_list = CUSTOM_LIST(tree_model);
 
+  path = gtk_tree_path_new();
+
+  if (custom_list->tasks != NULL)
+  {
+    gtk_tree_path_append_index(path, GPOINTER_TO_INT(iter->user_data2));
+    return path;
+  }
+
   record = (CustomRecord*) iter->user_data;
 
-  path = gtk_tree_path_new();
   gtk_tree_path_append_index(path, record->pos);
 
   return path;
 }
 
 
+/*****************************************************************************
+ *
+ *  custom_list_get_task_value: get_value for a task list. The strings are
+ *                              the ones kept in the TaskData (the times are
+ *                              those last formatted by the main window), so
+ *                              they are passed on without being copied.
+ *
+ *****************************************************************************/
+
+static void
+custom_list_get_task_value (CustomList   *custom_list,
+                            GtkTreeIter  *iter,
+                            gint          column,
+                            GValue       *value)
+{
+  TaskData  *taskdata;
+
+  taskdata = (TaskData*) iter->user_data;
+
+  g_return_if_fail ( taskdata != NULL );
+
+  switch(column)
+  {
+    case CUSTOM_LIST_COL_RECORD:
+      g_value_set_pointer(value, taskdata);
+      break;
+
+    case CUSTOM_LIST_COL_NAME:
+      g_value_set_static_string(value, taskdata->task->name);
+      break;
+
+    case CUSTOM_LIST_COL_PROJECT:
+      g_value_set_static_string(value, taskdata->project_name);
+      break;
+
+    case CUSTOM_LIST_COL_TODAY:
+      g_value_set_static_string(value, taskdata->last_today);
+      break;
+
+    case CUSTOM_LIST_COL_TOTAL:
+      g_value_set_static_string(value, taskdata->last_total);
+      break;
+
+    case CUSTOM_LIST_COL_TIMER_ON:
+      g_value_set_boolean(value, taskdata->last_on);
+      break;
+  }
+}
+
+
 /*****************************************************************************
  *
  *  custom_list_get_value: Returns a row's exported data columns
@@ -355,6 +458,12 @@ custom_list_get_value (GtkTreeModel *tree_model,
 
   custom_list = CUSTOM_LIST(tree_model);
 
+  if (custom_list->tasks != NULL)
+  {
+    custom_list_get_task_value(custom_list, iter, column, value);
+    return;
+  }
+
   record = (CustomRecord*) iter->user_data;
 
   g_return_if_fail ( record != NULL );
@@ -372,6 +481,16 @@ custom_list_get_value (GtkTreeModel *tree_model,
       g_value_set_string(value, record->taskname);
       break;
 
+    case CUSTOM_LIST_COL_PROJECT:
+    case CUSTOM_LIST_COL_TODAY:
+    case CUSTOM_LIST_COL_TOTAL:
+      g_value_set_static_string(value, "");
+      break;
+
+    case CUSTOM_LIST_COL_TIMER_ON:
+      g_value_set_boolean(value, FALSE);
+      break;
+
 //    case CUSTOM_LIST_COL_YEAR_BORN:
 //      g_value_set_uint(value, record->year_born);
 //      break;
@@ -400,6 +519,19 @@ custom_list_iter_next (GtkTreeModel  *tree_model,
 
   custom_list = CUSTOM_LIST(tree_model);
 
+  if (custom_list->tasks != NULL)
+  {
+    gint n = GPOINTER_TO_INT(iter->user_data2) + 1;
+
+    if (n >= custom_list->num_rows)
+      return FALSE;
+
+    iter->user_data  = custom_list_row_task(custom_list, n);
+    iter->user_data2 = GINT_TO_POINTER(n);
+
+    return TRUE;
+  }
+
   record = (CustomRecord *) iter->user_data;
 
   /* Is this the last record in the list? */
@@ -452,6 +584,9 @@ custom_list_iter_children (GtkTreeModel *tree_model,
   if (custom_list->num_rows == 0)
     return FALSE;
 
+  if (custom_list->tasks != NULL)
+    return custom_list_iter_nth_child(tree_model, iter, NULL, 0);
+
   /* Set iter to first item in list */
 //  iter->stamp     = custom_list->stamp;
   iter->user_data = custom_list->rows[0];
@@ -537,9 +672,16 @@ custom_list_iter_nth_child (GtkTreeModel *tree_model,
 
   /* special case: if parent == NULL, set iter to n-th top-level row */
 
-  if( n >= custom_list->num_rows )
+  if( n >= custom_list->num_rows || n < 0 )
     return FALSE;
 
+  if (custom_list->tasks != NULL)
+  {
+    iter->user_data  = custom_list_row_task(custom_list, n);
+    iter->user_data2 = GINT_TO_POINTER(n);
+    return TRUE;
+  }
+
   record = custom_list->rows[n];
 
   g_assert( record != NULL );
@@ -600,9 +742,10 @@ custom_list_new (void)
  *
  *****************************************************************************/
 
-GtkTreePath *
+void
 custom_list_append_record (CustomList   *custom_list,
-                           const gchar  *name)
+                           const gchar  *name,
+                           gint          index)
 {
   GtkTreeIter   iter;
   GtkTreePath  *path;
@@ -624,8 +767,8 @@ custom_list_append_record (CustomList   *custom_list,
   newrecord = g_new0(CustomRecord, 1);
 
   newrecord->taskname = g_strdup(name);
-  newrecord->name_collate_key = g_utf8_collate_key(name,-1); /* for fast sorting, used later */
 //  newrecord->year_born = year_born;
+  newrecord->index = index;
 
   custom_list->rows[pos] = newrecord;
   newrecord->pos = pos;
@@ -640,7 +783,366 @@ custom_list_append_record (CustomList   *custom_list,
   custom_list_get_iter(GTK_TREE_MODEL(custom_list), &iter, path);
 
   gtk_tree_model_row_inserted(GTK_TREE_MODEL(custom_list), path, &iter);
-// PV:
-  return path;
-//  gtk_tree_path_free(path);
+
+  gtk_tree_path_free(path);
+}
+
+
+/*****************************************************************************
+ *
+ *  custom_list_get_index:  Returns the index that was passed to
+ *                          custom_list_append_record() for the row at
+ *                          the given path (such as one returned by
+ *                          gtk_tree_selection_get_selected_rows), or -1
+ *                          if there is no such row.
+ *
+ *****************************************************************************/
+
+gint
+custom_list_get_index (CustomList   *custom_list,
+                       GtkTreePath  *path)
+{
+  gint  *indices;
+
+  g_return_val_if_fail (CUSTOM_IS_LIST(custom_list), -1);
+  g_return_val_if_fail (path != NULL, -1);
+
+  indices = gtk_tree_path_get_indices(path);
+
+  if ( gtk_tree_path_get_depth(path) != 1 || indices[0] < 0 ||
+       indices[0] >= custom_list->num_rows )
+    return -1;
+
+  /* task list rows are the caller's array in order */
+  if (custom_list->tasks != NULL)
+    return custom_list->filter ? custom_list->filter[indices[0]] : indices[0];
+
+  return custom_list->rows[indices[0]]->index;
+}
+
+
+/*****************************************************************************
+ *
+ *  custom_list_update_filter_rows: fills in filter_rows from filter.
+ *
+ *****************************************************************************/
+
+static void
+custom_list_update_filter_rows (CustomList *custom_list)
+{
+  gint  n;
+
+  g_free(custom_list->filter_rows);
+  custom_list->filter_rows = NULL;
+
+  if (custom_list->filter == NULL)
+    return;
+
+  custom_list->filter_rows = g_new(gint, custom_list->num_tasks + 1);
+
+  for (n = 0; n < custom_list->num_tasks; n++)
+    custom_list->filter_rows[n] = -1;
+
+  for (n = 0; n < custom_list->num_rows; n++)
+    custom_list->filter_rows[custom_list->filter[n]] = n;
+}
+
+
+/*****************************************************************************
+ *
+ *  custom_list_reorder_filter: the caller's array has been reordered while
+ *                              a filter is set. The rows shown stay in the
+ *                              order of the array, so they are reordered
+ *                              too (new_order is as for
+ *                              custom_list_tasks_reordered).
+ *
+ *****************************************************************************/
+
+static void
+custom_list_reorder_filter (CustomList *custom_list,
+                            gint       *new_order)
+{
+  GtkTreePath  *path;
+  gint         *row_order;
+  gint          i, n, row;
+
+  row_order = g_new(gint, custom_list->num_rows + 1);
+
+  for (i = 0, n = 0; i < custom_list->num_tasks; i++)
+  {
+    row = custom_list->filter_rows[new_order[i]];
+    if (row >= 0)
+    {
+      row_order[n] = row;
+      custom_list->filter[n] = i;
+      n++;
+    }
+  }
+  custom_list_update_filter_rows(custom_list);
+
+  if (custom_list->num_rows > 0)
+  {
+    path = gtk_tree_path_new();
+    gtk_tree_model_rows_reordered(GTK_TREE_MODEL(custom_list), path, NULL, row_order);
+    gtk_tree_path_free(path);
+  }
+
+  g_free(row_order);
+}
+
+
+/*****************************************************************************
+ *
+ *  custom_list_new_for_tasks:  Creates a list whose rows are the first
+ *                              num_tasks entries of the TaskData array
+ *                              that *tasks points to. When the caller adds,
+ *                              removes or changes an entry, it must then
+ *                              call custom_list_task_inserted(), _deleted()
+ *                              or _changed() so the tree view knows.
+ *
+ *****************************************************************************/
+
+CustomList *
+custom_list_new_for_tasks (TaskData   ***tasks,
+                           gint          num_tasks)
+{
+  CustomList *newcustomlist;
+
+  g_return_val_if_fail (tasks != NULL, NULL);
+
+  newcustomlist = custom_list_new();
+
+  newcustomlist->tasks    = tasks;
+  newcustomlist->num_rows  = num_tasks;
+  newcustomlist->num_tasks = num_tasks;
+
+  return newcustomlist;
+}
+
+
+/*****************************************************************************
+ *
+ *  custom_list_task_inserted:  A task was inserted into the caller's array
+ *                              at pos (the entries after it have already
+ *                              been moved down one).
+ *
+ *****************************************************************************/
+
+void
+custom_list_task_inserted (CustomList   *custom_list,
+                           gint          pos)
+{
+  GtkTreeIter   iter;
+  GtkTreePath  *path;
+  gint          n;
+
+  g_return_if_fail (CUSTOM_IS_LIST(custom_list));
+  g_return_if_fail (custom_list->tasks != NULL);
+  g_return_if_fail (pos >= 0 && pos <= custom_list->num_tasks);
+
+  custom_list->num_tasks++;
+
+  /* with a filter, the new task is not shown until it is set again */
+  if (custom_list->filter != NULL)
+  {
+    for (n = 0; n < custom_list->num_rows; n++)
+    {
+      if (custom_list->filter[n] >= pos)
+        custom_list->filter[n]++;
+    }
+    custom_list_update_filter_rows(custom_list);
+    return;
+  }
+
+  custom_list->num_rows++;
+
+  path = gtk_tree_path_new();
+  gtk_tree_path_append_index(path, pos);
+
+  custom_list_get_iter(GTK_TREE_MODEL(custom_list), &iter, path);
+
+  gtk_tree_model_row_inserted(GTK_TREE_MODEL(custom_list), path, &iter);
+
+  gtk_tree_path_free(path);
+}
+
+
+/*****************************************************************************
+ *
+ *  custom_list_task_deleted:  The task at pos was removed from the caller's
+ *                             array (the entries after it have already
+ *                             been moved up one).
+ *
+ *****************************************************************************/
+
+void
+custom_list_task_deleted (CustomList   *custom_list,
+                          gint          pos)
+{
+  GtkTreePath  *path;
+  gint          row, n, m;
+
+  g_return_if_fail (CUSTOM_IS_LIST(custom_list));
+  g_return_if_fail (custom_list->tasks != NULL);
+  g_return_if_fail (pos >= 0 && pos < custom_list->num_tasks);
+
+  custom_list->num_tasks--;
+
+  row = pos;
+  if (custom_list->filter != NULL)
+  {
+    row = custom_list->filter_rows[pos];
+    for (n = 0, m = 0; n < custom_list->num_rows; n++)
+    {
+      if (n != row)
+        custom_list->filter[m++] = custom_list->filter[n] -
+          (custom_list->filter[n] > pos);
+    }
+    custom_list->num_rows = m;
+    custom_list_update_filter_rows(custom_list);
+
+    if (row < 0)
+      return;   /* it was not shown */
+  }
+  else
+    custom_list->num_rows--;
+
+  path = gtk_tree_path_new();
+  gtk_tree_path_append_index(path, row);
+
+  gtk_tree_model_row_deleted(GTK_TREE_MODEL(custom_list), path);
+
+  gtk_tree_path_free(path);
+}
+
+
+/*****************************************************************************
+ *
+ *  custom_list_task_changed:  Something shown for the task at pos has
+ *                             changed. The tree view redraws the row if
+ *                             it is on screen.
+ *
+ *****************************************************************************/
+
+void
+custom_list_task_changed (CustomList   *custom_list,
+                          gint          pos)
+{
+  GtkTreeIter   iter;
+  GtkTreePath  *path;
+  gint          row;
+
+  g_return_if_fail (CUSTOM_IS_LIST(custom_list));
+  g_return_if_fail (custom_list->tasks != NULL);
+  g_return_if_fail (pos >= 0 && pos < custom_list->num_tasks);
+
+  row = custom_list_get_row(custom_list, pos);
+  if (row < 0)
+    return;   /* not shown */
+
+  path = gtk_tree_path_new();
+  gtk_tree_path_append_index(path, row);
+
+  custom_list_get_iter(GTK_TREE_MODEL(custom_list), &iter, path);
+
+  gtk_tree_model_row_changed(GTK_TREE_MODEL(custom_list), path, &iter);
+
+  gtk_tree_path_free(path);
+}
+
+
+/*****************************************************************************
+ *
+ *  custom_list_tasks_reordered:  The caller's array has been reordered.
+ *                                new_order[i] is the old position of the
+ *                                task now at position i. The tree view
+ *                                moves its rows (and the selection) to
+ *                                match without reading any of them.
+ *
+ *****************************************************************************/
+
+void
+custom_list_tasks_reordered (CustomList *custom_list,
+                             gint       *new_order)
+{
+  GtkTreePath  *path;
+
+  g_return_if_fail (CUSTOM_IS_LIST(custom_list));
+  g_return_if_fail (custom_list->tasks != NULL);
+  g_return_if_fail (new_order != NULL);
+
+  if (custom_list->filter != NULL)
+  {
+    custom_list_reorder_filter(custom_list, new_order);
+    return;
+  }
+
+  if (custom_list->num_rows == 0)
+    return;
+
+  path = gtk_tree_path_new();
+
+  gtk_tree_model_rows_reordered(GTK_TREE_MODEL(custom_list), path, NULL, new_order);
+
+  gtk_tree_path_free(path);
+}
+
+
+/*****************************************************************************
+ *
+ *  custom_list_set_filter:  Shows only some of the tasks: row n shows task
+ *                           rows[n] (which must be in increasing order).
+ *                           With rows NULL, all tasks are shown. No
+ *                           signals are emitted, so the list must not be
+ *                           in a tree view while this is done; give it to
+ *                           the view again afterwards (cheap in fixed
+ *                           height mode, as only the number of rows is
+ *                           looked at).
+ *
+ *****************************************************************************/
+
+void
+custom_list_set_filter (CustomList   *custom_list,
+                        gint         *rows,
+                        gint          num_rows)
+{
+  g_return_if_fail (CUSTOM_IS_LIST(custom_list));
+  g_return_if_fail (custom_list->tasks != NULL);
+
+  g_free(custom_list->filter);
+  custom_list->filter = NULL;
+
+  if (rows != NULL)
+  {
+    custom_list->filter = g_new(gint, num_rows + 1);
+    memcpy(custom_list->filter, rows, num_rows * sizeof(gint));
+    custom_list->num_rows = num_rows;
+  }
+  else
+    custom_list->num_rows = custom_list->num_tasks;
+
+  custom_list_update_filter_rows(custom_list);
+}
+
+
+/*****************************************************************************
+ *
+ *  custom_list_get_row:  Returns the row showing the task at pos in the
+ *                        caller's array, or -1 if it is not shown.
+ *
+ *****************************************************************************/
+
+gint
+custom_list_get_row (CustomList   *custom_list,
+                     gint          pos)
+{
+  g_return_val_if_fail (CUSTOM_IS_LIST(custom_list), -1);
+
+  if (pos < 0 || pos >= custom_list->num_tasks)
+    return -1;
+
+  if (custom_list->filter != NULL)
+    return custom_list->filter_rows[pos];
+
+  return pos;
 }
@@ -3,6 +3,8 @@
 
 #include <gtk/gtk.h>
 
+/* TaskData comes from gtimer.h, which must be included first */
+
 /* Some boilerplate GObject defines. 'klass' is used
  *   instead of 'class', because 'class' is a C++ keyword */
 
@@ -19,6 +21,10 @@ enum
 {
   CUSTOM_LIST_COL_RECORD = 0,
   CUSTOM_LIST_COL_NAME,
+  CUSTOM_LIST_COL_PROJECT,   /* the rest are for task lists only */
+  CUSTOM_LIST_COL_TODAY,
+  CUSTOM_LIST_COL_TOTAL,
+  CUSTOM_LIST_COL_TIMER_ON,
 //  CUSTOM_LIST_COL_YEAR_BORN,
   CUSTOM_LIST_N_COLUMNS,
 } ;
@@ -36,7 +42,7 @@ struct _CustomRecord
 {
   /* data - you can extend this */
   gchar    *taskname;
-  gchar    *name_collate_key;
+  gint      index;  /* caller's index for the row (e.g. into a task array) */
 //  guint     year_born;
 
   /* admin stuff used by the custom list model */
@@ -60,6 +66,20 @@ struct _CustomList
   CustomRecord  **rows;        /* a dynamically allocated array of pointers to
                                 *   the CustomRecord structure for each row    */
 
+  /* A task list (see custom_list_new_for_tasks) has no records. Its  */
+  /*   rows are read from the caller's array of TaskData as they are  */
+  /*   drawn, so nothing is copied and only visible rows are touched. */
+  /*   tasks points to the array pointer, as the array may be         */
+  /*   reallocated; num_rows only changes when the caller says so.    */
+  TaskData     ***tasks;
+  gint            num_tasks;   /* number of tasks in the caller's array */
+
+  /* A task list can show only some of the tasks (see               */
+  /*   custom_list_set_filter). Then row n shows task filter[n], and */
+  /*   filter_rows[i] is the row showing task i (or -1 if none).     */
+  gint           *filter;
+  gint           *filter_rows;
+
   /* These two fields are not absolutely necessary, but they    */
   /*   speed things up a bit in our get_value implementation    */
   gint            n_columns;
@@ -82,8 +102,34 @@ GType             custom_list_get_type (void);
 
 CustomList       *custom_list_new (void);
 
-GtkTreePath       *custom_list_append_record (CustomList   *custom_list,
-                                             const gchar  *name);
+void              custom_list_append_record (CustomList   *custom_list,
+                                             const gchar  *name,
+                                             gint          index);
+
+gint              custom_list_get_index (CustomList   *custom_list,
+                                         GtkTreePath  *path);
+
+CustomList       *custom_list_new_for_tasks (TaskData   ***tasks,
+                                             gint          num_tasks);
+
+void              custom_list_task_inserted (CustomList   *custom_list,
+                                             gint          pos);
+
+void              custom_list_task_deleted  (CustomList   *custom_list,
+                                             gint          pos);
+
+void              custom_list_task_changed  (CustomList   *custom_list,
+                                             gint          pos);
+
+void              custom_list_tasks_reordered (CustomList *custom_list,
+                                               gint       *new_order);
+
+void              custom_list_set_filter    (CustomList   *custom_list,
+                                             gint         *rows,
+                                             gint          num_rows);
+
+gint              custom_list_get_row       (CustomList   *custom_list,
+                                             gint          pos);
 
 #endif /* _custom_list_h_included_ */
 
@@ -30,6 +30,7 @@
  *	https://www.k5n.us/gtimer/
  *
  * History:
+ *	16-Oct-2026	Update the sort keys of renamed tasks and projects.
  *	17-Apr-2005	Added configurability of the browser. (Russ Allbery)
  *	28-Feb-2003	Added project create/edit window.
  *	21-Feb-2003	Added project pulldown in task create/edit.
@@ -105,13 +106,11 @@ gpointer data;
   if ( ed->p ) {
     str = gtk_entry_get_text ( GTK_ENTRY(ed->name) );
     if ( strcmp ( str, ed->p->name ) ) {
-      free ( ed->p->name );
       /* remove trailing white space */
       for ( ptr = str + strlen ( str ) - 1; isspace ( *ptr ) && ptr > str;
         ptr-- )
         *ptr = '\0';
-      ed->p->name = (char *) malloc ( strlen ( str ) + 1 );
-      strcpy ( ed->p->name, str );
+      projectSetName ( ed->p, str );
       project_updated = 1;
     }
     showMessage ( gettext("Project updated") );
@@ -135,11 +134,13 @@ gpointer data;
   }
 
   /* redraw the task list only if we changed a project name */
+  /* (hidden tasks need the new name too, for when they are unhidden) */
   if ( project_updated ) {
-    for ( loop = 0; ed->p && loop < num_visible_tasks; loop++ ) {
-      if ( visible_tasks[loop]->task->project_id == ed->p->number ) {
-        visible_tasks[loop]->name_updated = 1;
-        visible_tasks[loop]->project_name = ed->p->name;
+    for ( loop = 0; ed->p && loop < num_tasks; loop++ ) {
+      if ( tasks[loop]->task->project_id == ed->p->number ) {
+        tasks[loop]->name_updated = 1;
+        tasks[loop]->project_name = ed->p->name;
+        update_sort_keys ( tasks[loop] );
       }
     }
     update_list ();
@@ -306,26 +307,26 @@ gpointer data;
   if ( ed->taskdata ) {
     str = gtk_entry_get_text ( GTK_ENTRY(ed->name) );
     if ( strcmp ( str, ed->taskdata->task->name ) ) {
-      free ( ed->taskdata->task->name );
       /* remove trailing white space */
       for ( ptr = str + strlen ( str ) - 1; isspace ( *ptr ) && ptr > str;
         ptr-- )
         *ptr = '\0';
-      ed->taskdata->task->name = (char *) malloc ( strlen ( str ) + 1 );
-      strcpy ( ed->taskdata->task->name, str );
+      taskSetName ( ed->taskdata->task, str );
       ed->taskdata->name_updated = 1;
     }
     if ( ed->projectMenu ) {
       new_project_id = selp ? selp->number : -1;     
       if ( ed->taskdata->task->project_id != new_project_id ) {
         if ( selp == NULL )
-          ed->taskdata->task->project_id = -1; /* none */
+          taskSetProject ( ed->taskdata->task, -1 ); /* none */
         else
-          ed->taskdata->task->project_id = selp->number;
+          taskSetProject ( ed->taskdata->task, selp->number );
         ed->taskdata->name_updated = 1;
         ed->taskdata->project_name = selp ? selp->name : "";
       }
     }
+    if ( ed->taskdata->name_updated )
+      update_sort_keys ( ed->taskdata );
     showMessage ( gettext("Task updated") );
   }
 
@@ -353,8 +354,9 @@ gpointer data;
     num_visible_tasks++;
     num_tasks++;
     new_project_id = selp ? selp->number : -1;     
-    td->task->project_id = new_project_id;
+    taskSetProject ( td->task, new_project_id );
     td->project_name = selp ? selp->name : "";
+    update_sort_keys ( td );
     showMessage ( gettext("Task updated") );
   }
 
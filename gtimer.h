@@ -30,6 +30,9 @@
  *	https://www.k5n.us/gtimer
  *
  * History:
+ *	16-Oct-2026	Added list_pos to TaskData
+ *	16-Oct-2026	Added search_id and shown to TaskData
+ *	16-Oct-2026	Added name_key and project_key to TaskData
  *  06-May-2023	Changed release to 2.0.1
  *	09-Mar-2000	Changed release to 1.1.5
  *	09-Mar-2000	Added args to confirm_create_window()
@@ -112,12 +115,19 @@ typedef struct {
   int last_on;			/* was the icon drawn last time? */
   int selected;			/* item is selected */
   int moved;			/* item was moved */
+  char *name_key;		/* collation key of task name */
+  char *project_key;		/* collation key of project name */
+  int search_id;		/* id in task search index (0 if none) */
+  int shown;			/* item matches the filter */
+  int list_pos;			/* where it was last found in visible_tasks */
 } TaskData;
 
 void save_all ();
 
 void update_list ();
 
+void update_sort_keys ( TaskData *taskdata );
+
 #ifdef __GTK_H__
 
 #ifndef WIN32
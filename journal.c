@@ -0,0 +1,257 @@
+/*
+ * Append-only journal of task and project changes
+ *
+ * Copyright:
+ *	(C) 1999-2023 Craig Knudsen, craig@k5n.us
+ *	See accompanying file "COPYING".
+ *
+ *	This program is free software; you can redistribute it and/or
+ *	modify it under the terms of the GNU General Public License
+ *	as published by the Free Software Foundation; either version 2
+ *	of the License, or (at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program; if not, write to the
+ *	Free Software Foundation, Inc., 59 Temple Place,
+ *	Suite 330, Boston, MA  02111-1307, USA
+ *
+ * History:
+ *	16-Oct-2026	Created
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#if HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#ifdef WIN32
+#include <io.h>
+#endif
+#include <errno.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+
+#include "task.h"
+#include "project.h"
+#include "journal.h"
+
+#ifdef GTIMER_MEMDEBUG
+#include "memdebug/memdebug.h"
+#endif
+
+static FILE *journal_fp = NULL;
+
+
+/*
+** Build the path of the journal file in the specified directory.
+** Caller must free return value.
+*/
+static char *journal_file ( dir )
+char *dir;
+{
+  char *path;
+
+  path = (char *) malloc ( strlen ( dir ) + strlen ( JOURNAL_FILE ) + 2 );
+  sprintf ( path, "%s/%s", dir, JOURNAL_FILE );
+  return ( path );
+}
+
+
+/*
+** Open the journal for appending.  Once the journal is open,
+** taskSaveAll() and projectSaveAll() append records to it rather
+** than rewriting files.
+*/
+int journalOpen ( dir )
+char *dir;
+{
+  char *path;
+
+  if ( journal_fp )
+    journalClose ();
+
+  path = journal_file ( dir );
+  journal_fp = fopen ( path, "a" );
+  free ( path );
+  if ( ! journal_fp )
+    return ( JOURNAL_ERROR_SYSTEM_ERROR );
+
+  return ( 0 );
+}
+
+
+/*
+** Is the journal open?
+*/
+int journalIsOpen ()
+{
+  return ( journal_fp != NULL );
+}
+
+
+/*
+** Append a single record to the journal.  The record should not
+** include the trailing newline.  Records are buffered until
+** journalSync() is called.
+*/
+int journalAppend ( record )
+char *record;
+{
+  if ( ! journal_fp )
+    return ( JOURNAL_ERROR_NOT_OPEN );
+
+  if ( fprintf ( journal_fp, "%s\n", record ) < 0 )
+    return ( JOURNAL_ERROR_SYSTEM_ERROR );
+
+  return ( 0 );
+}
+
+
+/*
+** Flush all appended records to disk.
+*/
+int journalSync ()
+{
+  if ( ! journal_fp )
+    return ( JOURNAL_ERROR_NOT_OPEN );
+
+  if ( fflush ( journal_fp ) )
+    return ( JOURNAL_ERROR_SYSTEM_ERROR );
+#ifdef WIN32
+  _commit ( fileno ( journal_fp ) );
+#else
+  fsync ( fileno ( journal_fp ) );
+#endif
+
+  return ( 0 );
+}
+
+
+/*
+** Get the current size (in bytes) of the journal.
+*/
+long journalSize ()
+{
+  struct stat buf;
+
+  if ( ! journal_fp )
+    return ( 0 );
+
+  fflush ( journal_fp );
+  if ( fstat ( fileno ( journal_fp ), &buf ) != 0 )
+    return ( 0 );
+
+  return ( (long) buf.st_size );
+}
+
+
+/*
+** Apply all the records in the journal to the tasks and projects
+** already loaded from their files.  This should be called after
+** projectLoadAll() and taskLoadAll() and before journalOpen().
+** A partial record at the end of the file (from a crash in the middle
+** of a write) and records that cannot be parsed are ignored.
+** The number of records applied is returned in num_records.
+*/
+int journalReplay ( dir, num_records )
+char *dir;
+int *num_records;
+{
+  char *path, *text, *ptr, *eol;
+  struct stat buf;
+  int fd, len, ret;
+
+  *num_records = 0;
+
+  path = journal_file ( dir );
+  if ( stat ( path, &buf ) != 0 ) {
+    free ( path );
+    /* no journal is not an error */
+    return ( errno == ENOENT ? 0 : JOURNAL_ERROR_SYSTEM_ERROR );
+  }
+
+  fd = open ( path, O_RDONLY );
+  free ( path );
+  if ( fd < 0 )
+    return ( JOURNAL_ERROR_SYSTEM_ERROR );
+  text = (char *) malloc ( buf.st_size + 1 );
+  len = read ( fd, text, buf.st_size );
+  close ( fd );
+  if ( len < 0 ) {
+    free ( text );
+    return ( JOURNAL_ERROR_SYSTEM_ERROR );
+  }
+  text[len] = '\0';
+
+  for ( ptr = text; ( eol = strchr ( ptr, '\n' ) ) != NULL; ptr = eol + 1 ) {
+    *eol = '\0';
+    if ( *ptr == 'T' )
+      ret = taskReplay ( ptr, dir );
+    else if ( *ptr == 'P' )
+      ret = projectReplay ( ptr, dir );
+    else
+      ret = JOURNAL_ERROR_BAD_FILE;
+    if ( ret == 0 )
+      (*num_records)++;
+  }
+  free ( text );
+
+  return ( 0 );
+}
+
+
+/*
+** Fold the journal into the task and project files: every task and
+** project with journaled changes is rewritten to its own file and
+** then the journal is emptied.
+*/
+int journalCompact ( dir )
+char *dir;
+{
+  char *path;
+  int ret;
+
+  if ( ( ret = taskCompact ( dir ) ) )
+    return ( ret );
+  if ( ( ret = projectCompact ( dir ) ) )
+    return ( ret );
+
+  if ( journal_fp ) {
+    fflush ( journal_fp );
+#ifdef WIN32
+    if ( _chsize ( fileno ( journal_fp ), 0 ) )
+#else
+    if ( ftruncate ( fileno ( journal_fp ), 0 ) )
+#endif
+      return ( JOURNAL_ERROR_SYSTEM_ERROR );
+  } else {
+    path = journal_file ( dir );
+    unlink ( path );
+    free ( path );
+  }
+
+  return ( 0 );
+}
+
+
+/*
+** Close the journal.  Anything appended since the last journalSync()
+** is flushed.
+*/
+void journalClose ()
+{
+  if ( journal_fp ) {
+    journalSync ();
+    fclose ( journal_fp );
+    journal_fp = NULL;
+  }
+}
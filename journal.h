@@ -0,0 +1,72 @@
+/*
+ * Append-only journal of task and project changes
+ *
+ * Copyright:
+ *	(C) 1999-2023 Craig Knudsen, craig@k5n.us
+ *	See accompanying file "COPYING".
+ *
+ *	This program is free software; you can redistribute it and/or
+ *	modify it under the terms of the GNU General Public License
+ *	as published by the Free Software Foundation; either version 2
+ *	of the License, or (at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program; if not, write to the
+ *	Free Software Foundation, Inc., 59 Temple Place,
+ *	Suite 330, Boston, MA  02111-1307, USA
+ *
+ * Description:
+ *	Rather than rewriting a task file each time it changes, changes
+ *	are appended as one-line records to a single journal file.
+ *	Each record holds the new value (not a difference), so replaying
+ *	a record more than once is harmless.  Records start with a two
+ *	letter code:
+ *
+ *		TC <task> <created>	task created
+ *		TN <task> <name>	task renamed
+ *		TO <task> <options>	task options changed
+ *		TP <task> <project>	task moved to a project
+ *		TT <task> <YYYYMMDD> <seconds>	time for a day
+ *		TD <task>		task deleted
+ *		PC <project> <created>	project created
+ *		PN <project> <name>	project renamed
+ *		PO <project> <options>	project options changed
+ *		PD <project>		project deleted
+ *
+ *	Compaction writes every task and project with journaled changes
+ *	back to its own file and then empties the journal.
+ *
+ * History:
+ *	16-Oct-2026	Created
+ */
+
+
+#ifndef _JOURNAL_H
+#define _JOURNAL_H
+
+#define JOURNAL_FILE		"journal"	/* in the task directory */
+
+/* Errors */
+#define JOURNAL_ERROR_SYSTEM_ERROR	1	/* check errno value */
+#define JOURNAL_ERROR_BAD_FILE		2	/* bad record in journal */
+#define JOURNAL_ERROR_NOT_OPEN		3	/* journalOpen() not called */
+
+/*
+ * Functions
+ */
+
+int journalOpen ( char *dir );
+int journalIsOpen ();
+int journalAppend ( char *record );
+int journalSync ();
+long journalSize ();
+int journalReplay ( char *dir, int *num_records );
+int journalCompact ( char *dir );
+void journalClose ();
+
+#endif /* _JOURNAL_H */
@@ -30,6 +30,28 @@
  *	https://www.k5n.us/gtimer/
  *
  * History:
+ *	17-Oct-2026	The Save action reports how many task and project
+ *			files were written, journaled or left unchanged.
+ *	16-Oct-2026	Keep the tasks being timed in a list so the
+ *			once-a-second update, idle handling and Stop All
+ *			only look at them.  Hiding a timed task keeps its
+ *			time.
+ *	16-Oct-2026	Added a filter box above the task list.  -start
+ *			also accepts part of a task name or a close match.
+ *	16-Oct-2026	Sort names by cached collation keys.
+ *	16-Oct-2026	Sort the task list in place and tell the view
+ *			with a single rows-reordered signal.
+ *	16-Oct-2026	Replaced the task GtkCList with a GtkTreeView on
+ *			a CustomList model that reads visible_tasks[].
+ *	16-Oct-2026	Only redraw rows that changed on the one-second
+ *			tick.
+ *	16-Oct-2026	Added --from and --to for --report.
+ *	16-Oct-2026	Added --report for writing reports without the
+ *			user interface (e.g. from cron).
+ *	16-Oct-2026	Get task totals from taskSumRange().
+ *	16-Oct-2026	Write the binary task snapshot when saving.
+ *	16-Oct-2026	Save changes to the journal and fold it back into
+ *			the data files from the idle loop.
  *      07-Aug-2008	Ver 1.1.7 - Support UTF-8 using GTK+ ver. > 2.4.0
  *	15-Jul-2005	Add -weekstart to configure the first day of the
  *			week.  (Russ Allbery)
@@ -150,6 +172,8 @@
 #endif
 #include <pwd.h>
 #include <time.h>
+#include <string.h>
+#include <errno.h>
 #include <memory.h>
 #include <ctype.h>
 #include <sys/types.h>
@@ -167,7 +191,12 @@
 
 #include "project.h"
 #include "task.h"
+#include "journal.h"
+#include "snapshot.h"
 #include "gtimer.h"
+#include "reportgen.h"
+#include "civil.h"
+#include "search.h"
 #include "gtimeri18n.h"
 #include "config.h"
 #include "tcpt.h"
@@ -216,16 +245,24 @@ static GtkWidget *idle_prompt_window = NULL;
 static GtkWidget *option_menu_items[4];
 static time_t splash_until, last_save;
 static int modified_since_save = 0;
+static int compact_pending = 0;
 static int splash_seconds = 2;
 GtkWidget *toolbar = NULL;
 GtkWidget *task_list = NULL;
+static CustomList *task_model = NULL;
+static SearchIndex *task_index = NULL; /* task and project names */
+static GtkWidget *filter_entry = NULL;
+static char *filter_text = NULL; /* folded filter text (NULL if none) */
+static int rebuilding_list = 0;
 GtkWidget *status = NULL;
 guint status_id = 0;
 static time_t lastMessageTime = 0;
 GtkWidget *total_label = NULL;
 static char total_str[20];
-GdkPixmap *icons[8], *blankicon, *appicon, *appicon2;
-GdkBitmap *icon_masks[8], *blankicon_mask, *appicon_mask, *appicon2_mask;
+GdkPixbuf *icons[8], *blankicon;
+static GdkPixbuf *timer_icon; /* icon drawn for tasks being timed */
+GdkPixmap *appicon, *appicon2;
+GdkBitmap *appicon_mask, *appicon2_mask;
 #if OLD_GTK
 #else
 GtkAccelGroup* mainag;
@@ -246,11 +283,34 @@ typedef struct {
   GtkJustification justify;
   gboolean resizeable;
   GtkWidget *widget;
+  GtkTreeViewColumn *column;
 } list_column_def;
 
 static int sort_forward = 1;
 static int last_sort = 0;
-static int rebuilding_list = 0;
+
+/* What the task list can be sorted by */
+#define SORT_PROJECT_ID		0
+#define SORT_PROJECT_NAME	1
+#define SORT_TASK_NAME		2
+#define SORT_TASK_ID		3
+#define SORT_TODAY		4
+#define SORT_TOTAL		5
+
+/* How visible_tasks[] is sorted (-1 if it may be out of order) */
+static int sorted_by = -1;
+static int sorted_forward = 1;
+
+/*
+** A task and the value it is sorted by.  sort_tasks() works these out
+** once per sort rather than on every comparison.
+*/
+typedef struct {
+  TaskData *td;
+  int pos;			/* position before sorting */
+  time_t number;		/* id or time to sort by */
+  char *name;			/* name key to sort by (not a copy) */
+} sort_key;
 
 int today_year, today_mon, today_mday;
 int config_midnight_offset = 0;
@@ -261,6 +321,9 @@ int config_toolbar_enabled = 1;
 int config_animate_enabled = 1;
 int config_autosave_interval = (60*15); /* 15 minutes */
 int config_start_of_week = 0;
+int config_journal_enabled = 1;
+int config_journal_max = 65536; /* compact journal beyond this size */
+int config_snapshot_enabled = 1;
 
 char *taskdir = NULL;
 char *config_file = NULL;
@@ -271,14 +334,16 @@ int pulldown_selected_task = -1; /* task selected with right mouse button */
 TaskData **tasks;
 int num_tasks = 0;
 int num_timing = 0;
+static TaskData **timing_tasks = NULL; /* the num_timing tasks being timed */
+static int max_timing = 0;
 TaskData **visible_tasks; /* not hidden */
 int num_visible_tasks;
 
 list_column_def task_list_columns[4] = {
-  { "Project",	150, 0,	GTK_JUSTIFY_LEFT,	(gboolean)1,	NULL },
-  { "Task",	150, 0,	GTK_JUSTIFY_LEFT,	(gboolean)1,	NULL },
-  { "Today",	70, 70,	GTK_JUSTIFY_RIGHT,	(gboolean)0,	NULL },
-  { "Total",	70, 70,	GTK_JUSTIFY_RIGHT,	(gboolean)0,	NULL }
+  { "Project",	150, 0,	GTK_JUSTIFY_LEFT,	(gboolean)1,	NULL,	NULL },
+  { "Task",	150, 0,	GTK_JUSTIFY_LEFT,	(gboolean)1,	NULL,	NULL },
+  { "Today",	70, 70,	GTK_JUSTIFY_RIGHT,	(gboolean)0,	NULL,	NULL },
+  { "Total",	70, 70,	GTK_JUSTIFY_RIGHT,	(gboolean)0,	NULL,	NULL }
 };
 
 /*
@@ -314,6 +379,8 @@ static void idle_reset_callback ( GtkWidget *widget, gpointer data );
 static void idle_cancel_callback ( GtkWidget *widget, gpointer data );
 static void idle_resume_callback ( GtkWidget *widget, gpointer data );
 static void column_selected_callback ( GtkWidget *widget, int col );
+static void select_list_row ( int pos );
+static void move_list_to_row ( int pos );
 static void toolbar_toggle_callback ( GtkToggleAction *act );
 static void idle_toggle_callback ( GtkToggleAction *act );
 static void autosave_toggle_callback ( GtkToggleAction *act );
@@ -625,25 +692,101 @@ static int get_selected_task ()
 }
 
 
-static int my_strcasecmp ( char *str1, char *str2 )
+/*
+ * Make a key for sorting a name: names compare like their keys do with
+ * strcmp(), ignoring case and in the order of the user's locale.
+ */
+static char *collate_key ( char *str )
 {
-  char *ptr1, *ptr2, *ptr;
-  int ret;
+  char *folded, *ret;
 
-  ptr1 = strdup ( str1 );
-  ptr2 = strdup ( str2 );
+  /* names that are not UTF-8 just sort by their bytes */
+  if ( ! g_utf8_validate ( str, -1, NULL ) )
+    return ( g_strdup ( str ) );
 
-  for ( ptr = ptr1; *ptr != '\0'; ptr++ ) {
-    *ptr = toupper ( *ptr );
-  }
-  for ( ptr = ptr2; *ptr != '\0'; ptr++ ) {
-    *ptr = toupper ( *ptr );
+  folded = g_utf8_casefold ( str, -1 );
+  ret = g_utf8_collate_key ( folded, -1 );
+  g_free ( folded );
+  return ( ret );
+}
+
+
+/*
+ * Work out the sort keys of a task from its name and its project's
+ * name.  Call this after either of them changes.
+ */
+void update_sort_keys ( taskdata )
+TaskData *taskdata;
+{
+  g_free ( taskdata->name_key );
+  g_free ( taskdata->project_key );
+  taskdata->name_key = collate_key ( taskdata->task->name );
+  taskdata->project_key = collate_key ( taskdata->project_name );
+}
+
+
+/*
+ * Fold the case of some text for searching.  Text that is not UTF-8
+ * only has its ASCII letters folded.
+ */
+static char *fold_text ( char *str )
+{
+  if ( ! g_utf8_validate ( str, -1, NULL ) )
+    return ( g_ascii_strdown ( str, -1 ) );
+  return ( g_utf8_casefold ( str, -1 ) );
+}
+
+
+/*
+ * Remove a task from the search index.
+ */
+static void unindex_task ( taskdata )
+TaskData *taskdata;
+{
+  if ( taskdata->search_id > 0 ) {
+    searchRemove ( task_index, taskdata->search_id );
+    taskdata->search_id = 0;
   }
+}
 
-  ret = strcmp ( ptr1, ptr2 );
-  free ( ptr1 );
-  free ( ptr2 );
-  return ( ret );
+
+/*
+ * Add a task to the search index (or update it after a name change).
+ * The task name and project name are indexed together, separated by
+ * a newline so that no pattern matches across them.
+ */
+static void index_task ( taskdata )
+TaskData *taskdata;
+{
+  char *name, *project, *text;
+
+  unindex_task ( taskdata );
+  name = fold_text ( taskdata->task->name );
+  project = fold_text ( taskdata->project_name );
+  text = g_strconcat ( name, "\n", project, NULL );
+  taskdata->search_id = searchAdd ( task_index, taskdata, text );
+  g_free ( text );
+  g_free ( project );
+  g_free ( name );
+}
+
+
+/*
+ * Apply the sort direction to the result of a comparison.  Tasks that
+ * compare equal stay in the order they were in.
+ */
+static int sort_direction ( ret, k1, k2 )
+int ret;
+sort_key *k1;
+sort_key *k2;
+{
+  if ( ret == 0 )
+    return ( k1->pos - k2->pos );
+
+  if ( sort_forward )
+    return ( ret );
+  else
+    return ( - ret );
 }
 
 
@@ -651,134 +794,185 @@ static int my_strcasecmp ( char *str1, char *str2 )
  * Sort by project id, which will put oldest projects first, newest
  * projects last.
  */
-static int sort_task_by_project_id ( td1, td2 )
-TaskData **td1;
-TaskData **td2;
+static int sort_task_by_project_id ( k1, k2 )
+sort_key *k1;
+sort_key *k2;
 {
-  TaskData *tda = *td1;
-  TaskData *tdb = *td2;
   int ret;
 
   /* put tasks with no projects (-1) at the end of the list, most
      recent projects at the top */
-  if ( tda->task->project_id > tdb->task->project_id )
+  if ( k1->number > k2->number )
     ret = -1;
-  else if ( tda->task->project_id < tdb->task->project_id )
+  else if ( k1->number < k2->number )
     ret = 1;
   else
     ret = 0;
 
-  if ( sort_forward )
-    return ( ret );
-  else
-    return ( - ret );
+  return ( sort_direction ( ret, k1, k2 ) );
 }
 
 
 /*
  * Sort by project name.
  */
-static int sort_task_by_project_name ( td1, td2 )
-TaskData **td1;
-TaskData **td2;
+static int sort_task_by_project_name ( k1, k2 )
+sort_key *k1;
+sort_key *k2;
 {
-  TaskData *tda = *td1;
-  TaskData *tdb = *td2;
   int ret;
 
   /* put tasks with no projects (-1) at the end of the list, most
      recent projects at the top */
-  if ( tda->task->project_id < 0 )
+  if ( k1->number < 0 && k2->number < 0 )
+    ret = 0;
+  else if ( k1->number < 0 )
     ret = -1;
-  else if ( tdb->task->project_id < 0 )
+  else if ( k2->number < 0 )
     ret = 1;
   else
-    ret = my_strcasecmp ( tda->project_name, tdb->project_name );
+    ret = strcmp ( k1->name, k2->name );
 
-  if ( sort_forward )
-    return ( ret );
-  else
-    return ( - ret );
+  return ( sort_direction ( ret, k1, k2 ) );
 }
 
-static int sort_task_by_name ( td1, td2 )
-TaskData **td1;
-TaskData **td2;
+static int sort_task_by_name ( k1, k2 )
+sort_key *k1;
+sort_key *k2;
 {
-  TaskData *tda = *td1;
-  TaskData *tdb = *td2;
-  int ret;
-
-  ret = ( my_strcasecmp ( tda->task->name, tdb->task->name ) );
-  if ( sort_forward )
-    return ( ret );
-  else
-    return ( - ret );
+  return ( sort_direction ( strcmp ( k1->name, k2->name ), k1, k2 ) );
 }
 
-static int sort_task_by_id ( td1, td2 )
-TaskData **td1;
-TaskData **td2;
+static int sort_task_by_id ( k1, k2 )
+sort_key *k1;
+sort_key *k2;
 {
-  TaskData *tda = *td1;
-  TaskData *tdb = *td2;
   int ret;
 
   /* put most recent tasks at the top */
-  if ( tda->task->number > tdb->task->number )
+  if ( k1->number > k2->number )
     ret = -1;
-  else if ( tda->task->number < tdb->task->number )
+  else if ( k1->number < k2->number )
     ret = 1;
   else
     ret = 0;
 
-  if ( sort_forward )
-    return ( ret );
-  else
-    return ( - ret );
+  return ( sort_direction ( ret, k1, k2 ) );
 }
 
-static int sort_task_by_today ( td1, td2 )
-TaskData **td1;
-TaskData **td2;
+/*
+ * Sort by time for today or total time, most time first.
+ */
+static int sort_task_by_time ( k1, k2 )
+sort_key *k1;
+sort_key *k2;
 {
-  TaskData *tda = *td1;
-  TaskData *tdb = *td2;
-  int ret = 0;
+  int ret;
 
-  if ( tda->last_today_int > tdb->last_today_int )
-    ret = 1;
-  else if ( tda->last_today_int < tdb->last_today_int )
+  if ( k1->number > k2->number )
     ret = -1;
-  else if ( tda->last_today_int == tdb->last_today_int )
-    ret = ( (void *)tda < (void *)td2 );
-
-  if ( sort_forward )
-    return ( - ret );
+  else if ( k1->number < k2->number )
+    ret = 1;
   else
-    return ( ret );
+    ret = 0;
+
+  return ( sort_direction ( ret, k1, k2 ) );
 }
 
 
-static int sort_task_by_total ( td1, td2 )
-TaskData **td1;
-TaskData **td2;
+/*
+ * Sort a list of tasks by one of the SORT_* values.  If new_order is
+ * not NULL, new_order[i] is set to the old position of the task that
+ * is now at position i.
+ */
+static void sort_tasks ( list, num, by, new_order )
+TaskData **list;
+int num;
+int by;
+int *new_order;
 {
-  TaskData *tda = *td1;
-  TaskData *tdb = *td2;
-  int ret = 0;
+  sort_key *keys;
+  int (*compare)();
+  int i;
 
-  if ( tda->last_total_int > tdb->last_total_int )
-    ret = 1;
-  else if ( tda->last_total_int < tdb->last_total_int )
-    ret = -1;
-  else if ( tda->last_total_int == tdb->last_total_int )
-    ret = ( (void *)tda < (void *)td2 );
+  if ( num <= 0 )
+    return;
+
+  keys = (sort_key *) malloc ( num * sizeof ( sort_key ) );
+  for ( i = 0; i < num; i++ ) {
+    keys[i].td = list[i];
+    keys[i].pos = i;
+    keys[i].number = 0;
+    keys[i].name = NULL;
+    switch ( by ) {
+      case SORT_PROJECT_ID:
+        keys[i].number = list[i]->task->project_id;
+        break;
+      case SORT_PROJECT_NAME:
+        keys[i].number = list[i]->task->project_id;
+        keys[i].name = list[i]->project_key;
+        break;
+      case SORT_TASK_NAME:
+        keys[i].name = list[i]->name_key;
+        break;
+      case SORT_TASK_ID:
+        keys[i].number = list[i]->task->number;
+        break;
+      case SORT_TODAY:
+        keys[i].number = list[i]->last_today_int;
+        break;
+      case SORT_TOTAL:
+        keys[i].number = list[i]->last_total_int;
+        break;
+    }
+  }
 
-  if ( sort_forward )
-    return ( - ret );
-  else
-    return ( ret );
+  switch ( by ) {
+    case SORT_PROJECT_ID:
+      compare = sort_task_by_project_id;
+      break;
+    case SORT_PROJECT_NAME:
+      compare = sort_task_by_project_name;
+      break;
+    case SORT_TASK_NAME:
+      compare = sort_task_by_name;
+      break;
+    case SORT_TASK_ID:
+      compare = sort_task_by_id;
+      break;
+    default:
+      compare = sort_task_by_time;
+      break;
+  }
+  qsort ( keys, num, sizeof ( sort_key ), compare );
+
+  for ( i = 0; i < num; i++ ) {
+    list[i] = keys[i].td;
+    if ( new_order )
+      new_order[i] = keys[i].pos;
+  }
+  free ( keys );
+}
+
+
+/*
+ * Reverse a list of tasks.  new_order is set as for sort_tasks().
+ */
+static void reverse_tasks ( list, num, new_order )
+TaskData **list;
+int num;
+int *new_order;
+{
+  TaskData *td;
+  int i;
+
+  for ( i = 0; i < num / 2; i++ ) {
+    td = list[i];
+    list[i] = list[num - 1 - i];
+    list[num - 1 - i] = td;
+  }
+  for ( i = 0; i < num; i++ )
+    new_order[i] = num - 1 - i;
 }
 
 
@@ -794,20 +988,109 @@ static void update_tasks ()
   time_t now, diff;
 
   time ( &now );
-  for ( i = 0; i < num_visible_tasks; i++ ) {
-    if ( visible_tasks[i]->timer_on ) {
-      diff = now - visible_tasks[i]->on_since;
-      visible_tasks[i]->todays_entry->seconds += diff;
-      visible_tasks[i]->on_since = now;
+  for ( i = 0; i < num_timing; i++ ) {
+    diff = now - timing_tasks[i]->on_since;
+    taskAddTime ( timing_tasks[i]->task, timing_tasks[i]->todays_entry,
+      (int) diff );
+    timing_tasks[i]->on_since = now;
+  }
+}
+
+
+/*
+** Start timing a task.  The tasks being timed are kept in
+** timing_tasks[] (in the order they were started) so that the
+** work done every second, on idle and at midnight only looks at them.
+*/
+static void start_timer ( td )
+TaskData *td;
+{
+  if ( td->timer_on )
+    return;
+  if ( num_timing == max_timing ) {
+    max_timing = max_timing ? max_timing * 2 : 8;
+    timing_tasks = (TaskData **) realloc ( timing_tasks,
+      max_timing * sizeof ( TaskData * ) );
+  }
+  timing_tasks[num_timing++] = td;
+  td->timer_on = 1;
+  time ( &td->on_since );
+  if ( td->todays_entry == NULL )
+    td->todays_entry = taskNewTimeEntry ( td->task, today_year,
+      today_mon, today_mday );
+}
+
+
+/*
+** Stop timing a task.  If add_time is set, the time since it was
+** started is added to today's time for the task; otherwise it is
+** thrown away.
+*/
+static void stop_timer ( td, add_time )
+TaskData *td;
+int add_time;
+{
+  time_t now;
+  int loop;
+
+  if ( ! td->timer_on )
+    return;
+  if ( add_time ) {
+    time ( &now );
+    taskAddTime ( td->task, td->todays_entry, (int) ( now - td->on_since ) );
+  }
+  td->timer_on = 0;
+  td->on_since = 0;
+  for ( loop = 0; timing_tasks[loop] != td; loop++ )
+    ;
+  for ( num_timing--; loop < num_timing; loop++ )
+    timing_tasks[loop] = timing_tasks[loop + 1];
+}
+
+
+/*
+** Find where a task is in visible_tasks[] (-1 if it is hidden).
+** Where it was found last time is checked first, since tasks only
+** move when the list is sorted or tasks are added or removed.
+*/
+static int visible_task_pos ( td )
+TaskData *td;
+{
+  int loop;
+
+  if ( td->list_pos >= 0 && td->list_pos < num_visible_tasks &&
+    visible_tasks[td->list_pos] == td )
+    return ( td->list_pos );
+  for ( loop = 0; loop < num_visible_tasks; loop++ ) {
+    if ( visible_tasks[loop] == td ) {
+      td->list_pos = loop;
+      return ( loop );
     }
   }
+  return ( -1 );
 }
 
 
 
 
+/*
+** Fold the journal back into the task files.  This is run from
+** the GTK idle loop so it never holds up the timer display.
+*/
+static gint compact_journal_handler ( data )
+gpointer data;
+{
+  journalCompact ( taskdir );
+  compact_pending = 0;
+  return ( FALSE );
+}
+
+
 /*
 ** Save all the tasks to their files.
+** When the journal is enabled, only the changes are appended to the
+** journal and the task files are rewritten later once the journal
+** grows too large.
 */
 void save_all ()
 {
@@ -816,6 +1099,11 @@ void save_all ()
   projectSaveAll ( taskdir );
   time ( &last_save );
   modified_since_save = 0;
+  if ( ! compact_pending && journalIsOpen () &&
+    journalSize () > config_journal_max ) {
+    compact_pending = 1;
+    g_idle_add ( compact_journal_handler, NULL );
+  }
 }
 
 
@@ -827,6 +1115,10 @@ GdkEvent *event;
 gpointer data;
 {
   save_all ();
+  journalCompact ( taskdir );
+  journalClose ();
+  if ( config_snapshot_enabled )
+    snapshotWrite ( taskdir );
   configSaveAttributes ( config_file );
 #ifdef GTIMER_MEMDEBUG
   configClear ();
@@ -842,6 +1134,10 @@ static void exit_callback ( GtkAction *act )
 
   /* save task data */
   save_all ();
+  journalCompact ( taskdir );
+  journalClose ();
+  if ( config_snapshot_enabled )
+    snapshotWrite ( taskdir );
 
   /* save window size */
   w = 0;
@@ -853,25 +1149,23 @@ static void exit_callback ( GtkAction *act )
   }
 
   /* get columns widths in main window */
-  w = GTK_CLIST ( task_list )->column[0].width;
+  w = gtk_tree_view_column_get_width ( task_list_columns[0].column );
   configSetAttributeInt ( CONFIG_MAIN_WINDOW_PROJECT_WIDTH, w );
-  w = GTK_CLIST ( task_list )->column[1].width;
+  w = gtk_tree_view_column_get_width ( task_list_columns[1].column );
   configSetAttributeInt ( CONFIG_MAIN_WINDOW_TASK_WIDTH, w );
-  w = GTK_CLIST ( task_list )->column[2].width;
+  w = gtk_tree_view_column_get_width ( task_list_columns[2].column );
   configSetAttributeInt ( CONFIG_MAIN_WINDOW_TODAY_WIDTH, w );
-  w = GTK_CLIST ( task_list )->column[3].width;
+  w = gtk_tree_view_column_get_width ( task_list_columns[3].column );
   configSetAttributeInt ( CONFIG_MAIN_WINDOW_TOTAL_WIDTH, w );
 
   /* keep track of which tasks were being timed in case the user starts up
      with -resume next time */
   temp[0] = '\0';
-  for ( loop = 0; loop < num_visible_tasks; loop++ ) {
-    if ( visible_tasks[loop]->timer_on ) {
-      if ( strlen ( temp ) )
-        strcat ( temp, "," );
-      sprintf ( temp + strlen ( temp ), "%d",
-        visible_tasks[loop]->task->number );
-    }
+  for ( loop = 0; loop < num_timing; loop++ ) {
+    if ( strlen ( temp ) )
+      strcat ( temp, "," );
+    sprintf ( temp + strlen ( temp ), "%d",
+      timing_tasks[loop]->task->number );
   }
   configSetAttribute ( CONFIG_LAST_TIMED_TASKS, temp );
 
@@ -912,8 +1206,29 @@ static void update_toolbar_buttons () {
 
 static void save_callback ( GtkAction *act )
 {
-  showMessage ( gettext("All data saved") );
+  int task_written, task_journaled, task_skipped;
+  int project_written, project_journaled, project_skipped;
+  int written, journaled, skipped;
+  char temp[256];
+
+  taskGetSaveCounts ( &task_written, &task_journaled, &task_skipped );
+  projectGetSaveCounts ( &project_written, &project_journaled,
+    &project_skipped );
   save_all ();
+  taskGetSaveCounts ( &written, &journaled, &skipped );
+  task_written = written - task_written;
+  task_journaled = journaled - task_journaled;
+  task_skipped = skipped - task_skipped;
+  projectGetSaveCounts ( &written, &journaled, &skipped );
+  project_written = written - project_written;
+  project_journaled = journaled - project_journaled;
+  project_skipped = skipped - project_skipped;
+
+  sprintf ( temp,
+    gettext("All data saved: %d files written, %d journaled, %d unchanged"),
+    task_written + project_written, task_journaled + project_journaled,
+    task_skipped + project_skipped );
+  showMessage ( temp );
 }
 
 static void about_callback ( GtkAction *act )
@@ -1006,14 +1321,22 @@ static void task_hide_callback ( GtkAction *act )
   } else {
     td = visible_tasks[st];
     taskSetOption ( td->task, GTIMER_TASK_OPTION_HIDDEN );
-    td->timer_on = 0;
+    unindex_task ( td );
+    /* keep the time it has been timed for so far */
+    if ( td->timer_on ) {
+      stop_timer ( td, TRUE );
+      if ( num_timing == 0 )
+        gdk_window_set_icon ( GTK_WIDGET ( main_window )->window,
+          NULL, appicon2, appicon2_mask );
+    }
     for ( i = st; i < num_visible_tasks; i++ ) {
       if ( i + 1 < num_visible_tasks )
         visible_tasks[i] = visible_tasks[i + 1];
     }
     num_visible_tasks--;
+    custom_list_task_deleted ( task_model, st );
     update_list ();
-    gtk_clist_remove ( GTK_CLIST ( task_list ), st );
+    update_toolbar_buttons ();
     showMessage ( gettext("Task hidden") );
   }
 }
@@ -1048,6 +1371,13 @@ gpointer data;
   int ret, loop, tasknumber;
   char msg[500];
 
+  if ( td->timer_on ) {
+    stop_timer ( td, FALSE );
+    if ( num_timing == 0 )
+      gdk_window_set_icon ( GTK_WIDGET ( main_window )->window,
+        NULL, appicon2, appicon2_mask );
+  }
+
   if ( ( ret = taskDelete ( td->task, taskdir ) ) ) {
     sprintf ( msg, "%s:\n%s",
       gettext("Error deleting task"), taskErrorString ( ret ) );
@@ -1058,18 +1388,20 @@ gpointer data;
       NULL, NULL, NULL, NULL );
   }
 
-  /* delete from visible_tasks[] and the list window */
+  /* delete from visible_tasks[], the list window and the search index */
+  unindex_task ( td );
   tasknumber = -1;
   for ( loop = 0; loop < num_visible_tasks && tasknumber < 0; loop++ ) {
     if ( visible_tasks[loop] == td )
       tasknumber = loop;
   }
   if ( tasknumber >= 0 ) {
-    gtk_clist_remove ( GTK_CLIST ( task_list ), tasknumber );
     for ( loop = tasknumber; loop < num_visible_tasks; loop++ ) {
       if ( loop + 1 < num_visible_tasks )
         visible_tasks[loop] = visible_tasks[loop + 1];
     }
+    num_visible_tasks--;
+    custom_list_task_deleted ( task_model, tasknumber );
   }
 
   /* delete from tasks[] */
@@ -1085,12 +1417,14 @@ gpointer data;
     }
   }
 
+  g_free ( td->name_key );
+  g_free ( td->project_key );
   free ( td );
   num_tasks--;
-  num_visible_tasks--;
   showMessage ( gettext("Task removed") );
 
   update_list ();
+  update_toolbar_buttons ();
 }
 
 
@@ -1137,13 +1471,8 @@ static void start_callback ( GtkAction *act )
         NULL, NULL, NULL,
         NULL );
     } else {
-      td->timer_on = 1;
-      time ( &td->on_since );
-      if ( td->todays_entry == NULL )
-        td->todays_entry = taskNewTimeEntry ( td->task, today_year,
-          today_mon, today_mday );
+      start_timer ( td );
       update_list ();
-      num_timing++;
       if ( num_timing == 1 )
         gdk_window_set_icon ( GTK_WIDGET ( main_window )->window,
           NULL, appicon, appicon_mask );
@@ -1155,7 +1484,6 @@ static void start_callback ( GtkAction *act )
 static void stop_callback ( GtkAction *act )
 {
   TaskData *td;
-  time_t now, diff;
   int st = get_selected_task ();
 
   if ( st < 0 || ! num_visible_tasks ) {
@@ -1175,13 +1503,8 @@ static void stop_callback ( GtkAction *act )
         NULL, NULL, NULL,
         NULL );
     } else {
-      td->timer_on = 0;
-      time ( &now );
-      diff = now - td->on_since;
-      td->todays_entry->seconds += diff;
-      td->on_since = 0;
+      stop_timer ( td, TRUE );
       update_list ();
-      num_timing--;
       if ( num_timing == 0 )
         gdk_window_set_icon ( GTK_WIDGET ( main_window )->window,
           NULL, appicon2, appicon2_mask );
@@ -1212,26 +1535,13 @@ static void annotate_callback ( GtkAction *act )
 
 static void stop_all_callback ( GtkAction *act )
 {
-  TaskData *td;
-  time_t now, diff;
-  int loop;
-
   get_selected_task (); /* reset pulldown task selection */
 
-  for ( loop = 0; loop < num_visible_tasks; loop++ ) {
-    td = visible_tasks[loop];
-    if ( td->timer_on ) {
-      td->timer_on = 0;
-      time ( &now );
-      diff = now - td->on_since;
-      td->todays_entry->seconds += diff;
-      td->on_since = 0;
-    }
-  }
   if ( num_timing )
     gdk_window_set_icon ( GTK_WIDGET ( main_window )->window,
        NULL, appicon2, appicon2_mask );
-  num_timing = 0;
+  while ( num_timing > 0 )
+    stop_timer ( timing_tasks[num_timing - 1], TRUE );
   update_list ();
   update_toolbar_buttons ();
 }
@@ -1242,32 +1552,12 @@ static void switch_to_callback ( widget, data )
 GtkWidget *widget;
 gpointer data;
 {
-  TaskData *td;
-  time_t now, diff;
-  int loop;
-  int new_icon = 1;
+  int new_icon = ( num_timing == 0 );
   int st = get_selected_task ();
 
-  for ( loop = 0; loop < num_visible_tasks; loop++ ) {
-    td = visible_tasks[loop];
-    if ( td->timer_on ) {
-      td->timer_on = 0;
-      time ( &now );
-      diff = now - td->on_since;
-      td->todays_entry->seconds += diff;
-      td->on_since = 0;
-      new_icon = 0;
-      num_timing--;
-    }
-  }
-  td = visible_tasks[st];
-  td->timer_on = 1;
-  time ( &td->on_since );
-  if ( td->todays_entry == NULL )
-    td->todays_entry = taskNewTimeEntry ( td->task, today_year,
-      today_mon, today_mday );
-  update_list ();
-  num_timing = 1;
+  while ( num_timing > 0 )
+    stop_timer ( timing_tasks[num_timing - 1], TRUE );
+  start_timer ( visible_tasks[st] );
   if ( new_icon )
     gdk_window_set_icon ( GTK_WIDGET ( main_window )->window,
        NULL, appicon, appicon_mask );
@@ -1444,18 +1734,18 @@ int offset;
     if ( offset == 0 ) {
       /* set to zero */
       cutBuffer = td->todays_entry->seconds;
-      td->todays_entry->seconds = 0;
+      taskSetTime ( td->task, td->todays_entry, 0 );
     } else if ( offset < 0 ) {
       /* decrement */
       if ( td->todays_entry->seconds < ( 0 - offset ) ) {
         cutBuffer += td->todays_entry->seconds;
-        td->todays_entry->seconds = 0;
+        taskSetTime ( td->task, td->todays_entry, 0 );
       } else {
         cutBuffer += - offset;
-        td->todays_entry->seconds += offset;
+        taskAddTime ( td->task, td->todays_entry, offset );
       }
     } else {
-      td->todays_entry->seconds += offset;
+      taskAddTime ( td->task, td->todays_entry, offset );
     }
     modified_since_save = 1;
     update_list ();
@@ -1479,28 +1769,23 @@ gpointer data;
 
   time ( &now );
 
-  /* add up total time for today */
-  for ( timeBeforeReset = loop = 0; loop < num_tasks; loop++ )  {
-    if ( tasks[loop]->todays_entry ) {
-      timeBeforeReset += tasks[loop]->todays_entry->seconds;
-      if ( tasks[loop]->timer_on ) {
-        timeBeforeReset += ( now - tasks[loop]->on_since );
-      }
-    }
+  /*
+  ** Only the tasks being timed were marked when the idle was noticed
+  ** (and they cannot change while the idle window is up), so only
+  ** their time for today changes here.
+  */
+  for ( timeBeforeReset = loop = 0; loop < num_timing; loop++ )  {
+    timeBeforeReset += timing_tasks[loop]->todays_entry->seconds;
+    timeBeforeReset += ( now - timing_tasks[loop]->on_since );
   }
 
-  taskRestoreAll ();
+  for ( loop = 0; loop < num_timing; loop++ )
+    taskRestore ( timing_tasks[loop]->task );
 
-  for ( timeAfterReset = loop = 0; loop < num_tasks; loop++ )  {
-    if ( tasks[loop]->timer_on ) {
-      tasks[loop]->timer_on = 0;
-      tasks[loop]->on_since = 0;
-      num_timing--;
-    }
-    if ( tasks[loop]->todays_entry ) {
-      timeAfterReset += tasks[loop]->todays_entry->seconds;
-    }
-  }
+  for ( timeAfterReset = loop = 0; loop < num_timing; loop++ )
+    timeAfterReset += timing_tasks[loop]->todays_entry->seconds;
+  while ( num_timing > 0 )
+    stop_timer ( timing_tasks[num_timing - 1], FALSE );
   update_list ();
   update_toolbar_buttons ();
 
@@ -1549,23 +1834,22 @@ gpointer data;
 
   idle_prompt_window = NULL;
 
-  /* add up total time for today */
-  for ( timeBeforeReset = loop = 0; loop < num_tasks; loop++ )  {
-    if ( tasks[loop]->todays_entry ) {
-      timeBeforeReset += tasks[loop]->todays_entry->seconds;
-      if ( tasks[loop]->timer_on ) {
-        timeBeforeReset += ( now - tasks[loop]->on_since );
-      }
-    }
+  /*
+  ** Only the tasks being timed were marked when the idle was noticed
+  ** (and they cannot change while the idle window is up), so only
+  ** their time for today changes here.
+  */
+  for ( timeBeforeReset = loop = 0; loop < num_timing; loop++ )  {
+    timeBeforeReset += timing_tasks[loop]->todays_entry->seconds;
+    timeBeforeReset += ( now - timing_tasks[loop]->on_since );
   }
 
-  taskRestoreAll ();
+  for ( loop = 0; loop < num_timing; loop++ )
+    taskRestore ( timing_tasks[loop]->task );
 
-  for ( timeAfterReset = loop = 0; loop < num_visible_tasks; loop++ ) {
-    if ( visible_tasks[loop]->timer_on )
-      time ( &visible_tasks[loop]->on_since );
-    if ( tasks[loop]->todays_entry )
-      timeAfterReset += tasks[loop]->todays_entry->seconds;
+  for ( timeAfterReset = loop = 0; loop < num_timing; loop++ ) {
+    timing_tasks[loop]->on_since = now;
+    timeAfterReset += timing_tasks[loop]->todays_entry->seconds;
   }
   update_list ();
 
@@ -1851,7 +2135,7 @@ static void column_selected_callback ( widget, col )
 GtkWidget *widget;
 int col;
 {
-  int i;
+  int i, by, *new_order;
   static int same_col = 0;
 
   /*
@@ -1877,48 +2161,57 @@ int col;
   switch ( col ) {
     case 0:
       if ( same_col % 4 < 2 ) {
-        qsort ( visible_tasks, num_visible_tasks, sizeof ( TaskData * ),
-          sort_task_by_project_id );
+        by = SORT_PROJECT_ID;
         showMessage ( gettext("Sorted by project creation date") );
       } else {
-        qsort ( visible_tasks, num_visible_tasks, sizeof ( TaskData * ),
-          sort_task_by_project_name );
+        by = SORT_PROJECT_NAME;
         showMessage ( gettext("Sorted by project name") );
       }
       break;
     case 1:
       if ( same_col % 4 < 2 ) {
-        qsort ( visible_tasks, num_visible_tasks, sizeof ( TaskData * ),
-          sort_task_by_name );
+        by = SORT_TASK_NAME;
         showMessage ( gettext("Sorted by task name") );
       } else {
-        qsort ( visible_tasks, num_visible_tasks, sizeof ( TaskData * ),
-          sort_task_by_id );
+        by = SORT_TASK_ID;
         showMessage ( gettext("Sorted by task creation date") );
       }
       break;
     case 2:
-      qsort ( visible_tasks, num_visible_tasks, sizeof ( TaskData * ),
-        sort_task_by_today );
+      by = SORT_TODAY;
       showMessage ( gettext("Sorted by time for today") );
       break;
     default:
     case 3:
-      qsort ( visible_tasks, num_visible_tasks, sizeof ( TaskData * ),
-        sort_task_by_total );
+      by = SORT_TOTAL;
       showMessage ( gettext("Sorted by total time") );
       break;
   }
-  rebuilding_list = 1;
-  gtk_clist_freeze( GTK_CLIST (task_list) );
-  build_list ();
-  update_list ();
-  rebuilding_list = 0;
-  for ( i = 0; i < num_visible_tasks; i++ ) {
-    if ( visible_tasks[i]->selected )
-      gtk_clist_select_row ( GTK_CLIST (task_list), i, 0 );
+
+  /*
+  ** If the list is still sorted the same way, just in the other
+  ** direction, reversing it is enough.  The rows are then moved in the
+  ** view with a single "rows-reordered" signal; the selection moves
+  ** with its row.
+  */
+  if ( num_visible_tasks > 0 ) {
+    new_order = (int *) malloc ( num_visible_tasks * sizeof ( int ) );
+    if ( by == sorted_by && sort_forward != sorted_forward )
+      reverse_tasks ( visible_tasks, num_visible_tasks, new_order );
+    else
+      sort_tasks ( visible_tasks, num_visible_tasks, by, new_order );
+    custom_list_tasks_reordered ( task_model, new_order );
+    for ( i = 0; i < num_visible_tasks; i++ ) {
+      if ( new_order[i] == selected_task ) {
+        selected_task = i;
+        break;
+      }
+    }
+    free ( new_order );
   }
-  gtk_clist_thaw( GTK_CLIST (task_list) );
+  sorted_by = by;
+  sorted_forward = sort_forward;
+
   configSetAttributeInt ( CONFIG_SORT, col );
   configSetAttributeInt ( CONFIG_SORT_FORWARD, sort_forward );
 }
@@ -1929,7 +2222,18 @@ int col;
 
 
 /*
-** General event handler for the task list clist widget.  Catch
+** Callback for clicking on a column header.
+*/
+static void column_clicked_callback ( column, data )
+GtkTreeViewColumn *column;
+gpointer data;
+{
+  column_selected_callback ( NULL, GPOINTER_TO_INT ( data ) );
+}
+
+
+/*
+** General event handler for the task list widget.  Catch
 ** right mouse button events and create the pulldown menu.
 */
 static gint task_list_event ( widget, event )
@@ -1938,14 +2242,17 @@ GdkEvent *event;
 {
   GdkEventButton *eb;
   GtkWidget *menu;
-  int row, col;
+  GtkTreePath *path;
 
   if ( event->type == GDK_BUTTON_PRESS ) {
     eb = (GdkEventButton *)event;
     if ( eb->button == 3 ) {
-      gtk_clist_get_selection_info ( GTK_CLIST ( task_list ),
-        eb->x, eb->y, &row, &col );
-      pulldown_selected_task = row;
+      pulldown_selected_task = -1;
+      if ( gtk_tree_view_get_path_at_pos ( GTK_TREE_VIEW ( task_list ),
+        (gint) eb->x, (gint) eb->y, &path, NULL, NULL, NULL ) ) {
+        pulldown_selected_task = custom_list_get_index ( task_model, path );
+        gtk_tree_path_free ( path );
+      }
       menu = create_task_pulldown ( FALSE );
       gtk_menu_popup (GTK_MENU (menu), NULL, NULL, NULL,
          NULL, 3, eb->time);
@@ -1956,35 +2263,240 @@ GdkEvent *event;
 
 
 /*
-** Callback for user selecting a task (single-click, double-click,
-** right-mouse, etc.)
+** Callback for the selected task changing (single-click, keyboard, etc.)
 */
-static gint task_selected_callback ( widget, col, row, bevent, user_data )
-GtkWidget *widget;
-int col;
-int row;
-GdkEventButton *bevent;
+static void task_selected_callback ( selection, user_data )
+GtkTreeSelection *selection;
 gpointer user_data;
 {
+  GtkTreeModel *model;
+  GtkTreeIter iter;
+  GtkTreePath *path;
   int i;
 
+  /* the view clears the selection when the filter changes */
   if ( rebuilding_list )
-    return ( TRUE );
+    return;
 
   for ( i = 0; i < num_visible_tasks; i++ )
     visible_tasks[i]->selected = 0;
 
-  selected_task = col;
-  if ( selected_task >= 0 )
+  selected_task = -1;
+  if ( gtk_tree_selection_get_selected ( selection, &model, &iter ) ) {
+    path = gtk_tree_model_get_path ( model, &iter );
+    selected_task = custom_list_get_index ( task_model, path );
+    gtk_tree_path_free ( path );
     visible_tasks[selected_task]->selected = 1;
+  }
+}
+
+
+/*
+** Callback for double-clicking on a task.
+*/
+static void task_activated_callback ( view, path, column, user_data )
+GtkTreeView *view;
+GtkTreePath *path;
+GtkTreeViewColumn *column;
+gpointer user_data;
+{
+  selected_task = custom_list_get_index ( task_model, path );
+  switch_to_callback ( GTK_WIDGET ( view ), user_data );
+}
+
+
+/*
+** Select a task (its position in visible_tasks[]) in the task list.
+** Nothing is done if the filter hides it.
+*/
+static void select_list_row ( pos )
+int pos;
+{
+  GtkTreePath *path;
+  int row;
+
+  if ( ( row = custom_list_get_row ( task_model, pos ) ) < 0 )
+    return;
+  path = gtk_tree_path_new_from_indices ( row, -1 );
+  gtk_tree_selection_select_path (
+    gtk_tree_view_get_selection ( GTK_TREE_VIEW ( task_list ) ), path );
+  gtk_tree_path_free ( path );
+}
 
-  if ( bevent != NULL ) {
-    /* double-click ? */
-    if ( bevent->type == GDK_2BUTTON_PRESS )
-      switch_to_callback ( widget, user_data );
+
+/*
+** Scroll the task list so that a task (its position in visible_tasks[])
+** is in the middle.  Nothing is done if the filter hides it.
+*/
+static void move_list_to_row ( pos )
+int pos;
+{
+  GtkTreePath *path;
+  int row;
+
+  if ( ( row = custom_list_get_row ( task_model, pos ) ) < 0 )
+    return;
+  path = gtk_tree_path_new_from_indices ( row, -1 );
+  gtk_tree_view_scroll_to_cell ( GTK_TREE_VIEW ( task_list ), path, NULL,
+    TRUE, 0.5, 0.0 );
+  gtk_tree_path_free ( path );
+}
+
+
+/*
+** Show only the tasks whose task or project name contains the text in
+** the filter box (all of them if it is empty).  If narrow is set, the
+** text has only grown since the last time, so only the tasks shown now
+** need to be checked; otherwise the search index finds them.
+*/
+static void filter_list ( narrow )
+int narrow;
+{
+  TaskData **matches;
+  gint *rows = NULL;
+  int i, num, num_rows = 0, st;
+
+  if ( task_model == NULL )
+    return;
+
+  if ( filter_text != NULL ) {
+    rows = (gint *) malloc ( ( num_visible_tasks + 1 ) * sizeof ( gint ) );
+    if ( narrow && task_model->filter != NULL ) {
+      for ( i = 0; i < task_model->num_rows; i++ ) {
+        if ( searchMatches ( task_index,
+          visible_tasks[task_model->filter[i]]->search_id, filter_text ) )
+          rows[num_rows++] = task_model->filter[i];
+      }
+    } else {
+      for ( i = 0; i < num_visible_tasks; i++ )
+        visible_tasks[i]->shown = 0;
+      num = searchFind ( task_index, filter_text, (void ***) &matches );
+      for ( i = 0; i < num; i++ )
+        matches[i]->shown = 1;
+      free ( matches );
+      /* keep the rows in the order of visible_tasks[] */
+      for ( i = 0; i < num_visible_tasks; i++ ) {
+        if ( visible_tasks[i]->shown )
+          rows[num_rows++] = i;
+      }
+    }
   }
 
-  return ( TRUE );
+  /*
+  ** The model does not signal the change, so the view is given the
+  ** model again.  In fixed height mode this only looks at the number
+  ** of rows.
+  */
+  st = selected_task;
+  rebuilding_list = 1;
+  gtk_tree_view_set_model ( GTK_TREE_VIEW ( task_list ), NULL );
+  custom_list_set_filter ( task_model, rows, num_rows );
+  gtk_tree_view_set_model ( GTK_TREE_VIEW ( task_list ),
+    GTK_TREE_MODEL ( task_model ) );
+  rebuilding_list = 0;
+  if ( rows != NULL )
+    free ( rows );
+
+  /* keep the selected task selected if it is still shown */
+  if ( st >= 0 && custom_list_get_row ( task_model, st ) >= 0 ) {
+    select_list_row ( st );
+    move_list_to_row ( st );
+  } else {
+    if ( st >= 0 && st < num_visible_tasks )
+      visible_tasks[st]->selected = 0;
+    selected_task = -1;
+  }
+}
+
+
+/*
+** Callback for the text in the filter box changing.
+*/
+static void filter_changed_callback ( widget, data )
+GtkWidget *widget;
+gpointer data;
+{
+  char *text, *old;
+  int narrow;
+
+  text = fold_text ( (char *) gtk_entry_get_text ( GTK_ENTRY ( widget ) ) );
+  if ( text[0] == '\0' ) {
+    g_free ( text );
+    text = NULL;
+  }
+  /* anything that matches the new text also matches text it contains */
+  narrow = ( filter_text != NULL && text != NULL &&
+    strstr ( text, filter_text ) != NULL );
+  old = filter_text;
+  filter_text = text;
+  g_free ( old );
+  filter_list ( narrow );
+}
+
+
+/*
+** Callback for pressing Enter in the filter box: time the selected
+** task, or the first one shown if none is selected.
+*/
+static void filter_activate_callback ( widget, data )
+GtkWidget *widget;
+gpointer data;
+{
+  if ( selected_task < 0 && task_model->num_rows > 0 )
+    select_list_row ( task_model->filter ? task_model->filter[0] : 0 );
+  if ( selected_task >= 0 )
+    switch_to_callback ( widget, data );
+}
+
+
+/*
+** Find a visible task by name for -start.  An exact match is used
+** first, then a task whose name contains the given name (if only one
+** does), then a task whose name is like it.  What was not found, or
+** which task is used instead, is reported on stderr.
+** Returns NULL if none is found.
+*/
+static TaskData *find_task_by_name ( name )
+char *name;
+{
+  TaskData **matches, *ret = NULL;
+  char *pattern, *folded;
+  int i, num, num_found = 0;
+
+  pattern = fold_text ( name );
+  num = searchFind ( task_index, pattern, (void ***) &matches );
+  for ( i = 0; i < num && ret == NULL; i++ ) {
+    if ( strcmp ( matches[i]->task->name, name ) == 0 )
+      ret = matches[i];
+  }
+  /* the project name is indexed too, so check the task name */
+  for ( i = 0; i < num && ret == NULL; i++ ) {
+    folded = fold_text ( matches[i]->task->name );
+    if ( strstr ( folded, pattern ) != NULL ) {
+      if ( num_found++ == 0 )
+        matches[0] = matches[i];
+    }
+    g_free ( folded );
+  }
+  if ( ret == NULL && num_found == 1 ) {
+    ret = matches[0];
+  } else if ( ret == NULL && num_found > 1 ) {
+    fprintf ( stderr, "%s \"%s\" %s.\n",
+      gettext ( "Task" ), name, gettext ( "matches more than one task" ) );
+  } else if ( ret == NULL ) {
+    ret = (TaskData *) searchFindSimilar ( task_index, pattern );
+    if ( ret != NULL )
+      fprintf ( stderr, "%s \"%s\" %s; %s \"%s\".\n",
+        gettext ( "Task" ), name, gettext ( "not found" ),
+        gettext ( "using" ), ret->task->name );
+    else
+      fprintf ( stderr, "%s \"%s\" %s.\n",
+        gettext ( "Task" ), name, gettext ( "not found" ) );
+  }
+  free ( matches );
+  g_free ( pattern );
+
+  return ( ret );
 }
 
 /*
@@ -2073,171 +2585,205 @@ static GtkWidget *create_main_window_menu_bar()
 }
 
 
+/*
+** Draw the clock icon for tasks being timed.
+*/
+static void timer_icon_data_func ( column, renderer, model, iter, data )
+GtkTreeViewColumn *column;
+GtkCellRenderer *renderer;
+GtkTreeModel *model;
+GtkTreeIter *iter;
+gpointer data;
+{
+  gboolean timer_on;
+
+  gtk_tree_model_get ( model, iter, CUSTOM_LIST_COL_TIMER_ON, &timer_on, -1 );
+  g_object_set ( renderer, "pixbuf", timer_on ? timer_icon : blankicon, NULL );
+}
+
+
+/*
+** Create the task list view.  The columns have fixed widths and the
+** view is in fixed height mode, so only the rows being shown are ever
+** looked at; with thousands of tasks, creating or re-sorting the list
+** does not measure every row.
+*/
 static GtkWidget *create_list_column_def (num, cols)
 int num;
 list_column_def *cols;
 {
-  GtkWidget *clist;
-  GtkWidget *alignment;
+  GtkWidget *view;
+  GtkTreeViewColumn *col;
+  GtkCellRenderer *renderer;
   GtkWidget *label;
   int i;
+  static int model_columns[4] = { CUSTOM_LIST_COL_PROJECT,
+    CUSTOM_LIST_COL_NAME, CUSTOM_LIST_COL_TODAY, CUSTOM_LIST_COL_TOTAL };
 
-  clist = gtk_clist_new (num);
-#ifdef GTK_CLIST_SET_FLAGS /* GTK 1.0.1 */
-  GTK_CLIST_SET_FLAGS (clist, CLIST_SHOW_TITLES);
-#else
-  GTK_CLIST_SET_FLAG (clist, CLIST_SHOW_TITLES);
-#endif
+  view = gtk_tree_view_new ();
+  gtk_tree_view_set_headers_visible ( GTK_TREE_VIEW (view), TRUE );
 
   for (i = 0; i < num; i++) {
-    gtk_clist_set_column_width (GTK_CLIST (clist), i, cols[i].width);
-/*
-    gtk_clist_set_column_resizeable (GTK_CLIST (clist), i, cols[i].resizeable);
-    gtk_clist_set_column_auto_resize (GTK_CLIST (clist), i, (gboolean)1);
-    if ( cols[i].max_width )
-      gtk_clist_set_column_max_width ( GTK_CLIST (clist), i,
-        cols[i].max_width );
-*/
-    if (cols[i].justify != GTK_JUSTIFY_LEFT) {
-      gtk_clist_set_column_justification (GTK_CLIST (clist), i,
-        cols[i].justify);
+    col = gtk_tree_view_column_new ();
+    gtk_tree_view_column_set_sizing ( col, GTK_TREE_VIEW_COLUMN_FIXED );
+    gtk_tree_view_column_set_fixed_width ( col, cols[i].width );
+    gtk_tree_view_column_set_resizable ( col, TRUE );
+    gtk_tree_view_column_set_clickable ( col, TRUE );
+
+    /* the project column also shows the clock for tasks being timed */
+    if ( i == 0 ) {
+      renderer = gtk_cell_renderer_pixbuf_new ();
+      gtk_tree_view_column_pack_start ( col, renderer, FALSE );
+      gtk_tree_view_column_set_cell_data_func ( col, renderer,
+        timer_icon_data_func, NULL, NULL );
     }
 
-    alignment = gtk_alignment_new (0.0, 0.5, 0.0, 0.0);
+    renderer = gtk_cell_renderer_text_new ();
+    if (cols[i].justify == GTK_JUSTIFY_RIGHT)
+      g_object_set ( renderer, "xalign", 1.0, NULL );
+    gtk_tree_view_column_pack_start ( col, renderer, TRUE );
+    gtk_tree_view_column_add_attribute ( col, renderer, "text",
+      model_columns[i] );
 
-    /*label = gtk_label_new (cols[i].name);*/
     label = gtk_label_new ( gettext(cols[i].name) );
     gtk_label_set_justify (GTK_LABEL (label), GTK_JUSTIFY_LEFT);
-    gtk_container_add (GTK_CONTAINER (alignment), label);
     gtk_widget_show (label);
+    gtk_tree_view_column_set_widget ( col, label );
 
     cols[i].widget = label;
+    cols[i].column = col;
 
-    gtk_clist_set_column_widget (GTK_CLIST (clist), i, alignment);
-    /*gtk_clist_column_title_passive ( GTK_CLIST(clist), i );*/
-    gtk_widget_show (alignment);
+    g_signal_connect ( col, "clicked",
+      G_CALLBACK ( column_clicked_callback ), GINT_TO_POINTER ( i ) );
+    gtk_tree_view_append_column ( GTK_TREE_VIEW (view), col );
   }
 
-  return clist;
+  gtk_tree_view_set_fixed_height_mode ( GTK_TREE_VIEW (view), TRUE );
+
+  return view;
 }
 
 
 
 /*
-** Update the time values shown in the list.
+** Redraw rows of the task list.  With all set, every row is redrawn
+** and the total for today is added up again; this is done after
+** anything about the tasks has been changed.  Otherwise only the rows
+** of tasks being timed are redrawn, as nothing else changes on its own
+** (everything that stops a timer or changes a task calls update_list).
+** The total for today is then kept up to date by adding the change in
+** each redrawn row.  The view is only told about rows whose text or
+** icon has changed, and only redraws those that are on screen.
 */
-void update_list () {
+static void redraw_list ( all )
+int all;
+{
   TaskData *taskdata;
-  int i;
+  int i, loop, num;
   int h, m, s;
   char text[100];
-  time_t now, diff, total, today;
-  GdkPixmap *icon;
-  GdkBitmap *mask;
-  char *row[4];
-  int total_today = 0;
+  time_t now, total, today;
+  int inserted, changed, refilter = 0;
+  static time_t total_today = 0;
   char today_test[20];
-  char *project_name;
-  Project *p;
-  static char *noproject = "";
 
   time ( &now );
-  if ( config_animate_enabled ) {
-    icon = icons[now%8];
-    mask = icon_masks[now%8];
-  } else {
-    icon = icons[0];
-    mask = icon_masks[0];
-  }
+  if ( config_animate_enabled )
+    timer_icon = icons[now%8];
+  else
+    timer_icon = icons[0];
 
-  /*gtk_clist_freeze ( GTK_CLIST(task_list) );*/
-  for ( i = 0; i < num_visible_tasks; i++ ) {
+  if ( all )
+    total_today = 0;
+
+  num = all ? num_visible_tasks : num_timing;
+  for ( loop = 0; loop < num; loop++ ) {
+    if ( all )
+      i = loop;
+    else if ( ( i = visible_task_pos ( timing_tasks[loop] ) ) < 0 )
+      continue;
     taskdata = visible_tasks[i];
+    inserted = changed = 0;
     /* new task ? */
     if ( taskdata->new_task ) {
       modified_since_save = 1;
       taskdata->new_task = 0;
-      if ( taskdata->task->project_id > 0 ) {
-        p = projectGet ( taskdata->task->project_id );
-        project_name = p->name;
-      } else {
-        project_name = noproject;
-      }
-      row[0] = project_name;
-      row[1] = taskdata->task->name;
-      row[2] = "00:00:00";
-      row[3] = "00:00:00";
-      gtk_clist_append ( GTK_CLIST(task_list), row );
-      gtk_clist_set_pixtext (GTK_CLIST (task_list), i, 0,
-        taskdata->project_name, 2, blankicon, blankicon_mask);
-      continue;
+      inserted = 1;
+      taskdata->moved = 1;
+      taskdata->last_today_int = 0;
+      sorted_by = -1;
+      index_task ( taskdata );
+      refilter = ( filter_text != NULL );
     }
     /* update the name ? */
     if ( taskdata->name_updated || taskdata->moved ) {
+      if ( taskdata->name_updated ) {
+        sorted_by = -1;
+        index_task ( taskdata );
+        refilter = ( filter_text != NULL );
+      }
       modified_since_save = 1;
       taskdata->name_updated = 0;
-      if ( taskdata->timer_on ) {
-        gtk_clist_set_pixtext (GTK_CLIST (task_list), i, 0,
-          taskdata->project_name, 2, icon, mask);
-        taskdata->last_on = 1;
-      } else {
-        gtk_clist_set_pixtext (GTK_CLIST (task_list), i, 0,
-          taskdata->project_name, 2, blankicon, blankicon_mask);
-        taskdata->last_on = 0;
-      }
+      changed = 1;
     }
-    gtk_clist_set_text ( GTK_CLIST(task_list), i, 1, taskdata->task->name );
-    /* calc total */
-    total = taskdata->total;
+    /* calc today and total */
+    today = 0;
     if ( taskdata->todays_entry )
-      total += taskdata->todays_entry->seconds;
-    if ( taskdata->timer_on ) {
-      time ( &now );
-      diff = now - taskdata->on_since;
-      total += diff;
-    }
+      today = taskdata->todays_entry->seconds;
+    if ( taskdata->timer_on )
+      today += now - taskdata->on_since;
+    total = taskdata->total + today;
     h = total / 3600;
     m = ( total - h * 3600 ) / 60;
     s = total % 60;
     sprintf ( text, "%d:%02d:%02d", h, m, s );
-    if ( strcmp ( text, taskdata->last_total ) || taskdata->moved ) {
-      gtk_clist_set_text ( GTK_CLIST(task_list), i, 3, text );
+    if ( strcmp ( text, taskdata->last_total ) ) {
       strcpy ( taskdata->last_total, text );
+      changed = 1;
     }
-
+    if ( total != taskdata->last_total_int && sorted_by == SORT_TOTAL )
+      sorted_by = -1;
     taskdata->last_total_int = total;
-    today = 0;
-    if ( taskdata->todays_entry )
-      today = taskdata->todays_entry->seconds;
-    if ( taskdata->timer_on ) {
-      time ( &now );
-      diff = now - taskdata->on_since;
-      today += diff;
-    }
+
     h = today / 3600;
     m = ( today - h * 3600 ) / 60;
     s = today % 60;
     sprintf ( text, "%d:%02d:%02d", h, m, s );
-    if ( strcmp ( text, taskdata->last_today ) || taskdata->moved ) {
-      gtk_clist_set_text ( GTK_CLIST(task_list), i, 2, text );
+    if ( strcmp ( text, taskdata->last_today ) ) {
       strcpy ( taskdata->last_today, text );
+      changed = 1;
     }
+    if ( all )
+      total_today += today;
+    else
+      total_today += today - taskdata->last_today_int;
+    if ( today != taskdata->last_today_int && sorted_by == SORT_TODAY )
+      sorted_by = -1;
     taskdata->last_today_int = today;
-    /* draw the icon ? */
+    /* draw the icon ? (it changes every second when animated) */
     if ( taskdata->timer_on ) {
       modified_since_save = 1;
-      gtk_clist_set_pixtext (GTK_CLIST (task_list), i, 0,
-        taskdata->project_name, 2, icon, mask);
       taskdata->last_on = 1;
-    } else if ( ! taskdata->timer_on && taskdata->last_on ) {
-      gtk_clist_set_pixtext (GTK_CLIST (task_list), i, 0,
-        taskdata->project_name, 2, blankicon, blankicon_mask);
+      changed = 1;
+    } else if ( taskdata->last_on ) {
       taskdata->last_on = 0;
+      changed = 1;
     }
+    /*
+    ** The view fetches the new values if the row is on screen.  Moved
+    ** rows have just been given to the view again, so it has not drawn
+    ** them yet.
+    */
+    if ( inserted )
+      custom_list_task_inserted ( task_model, i );
+    else if ( changed && ! taskdata->moved )
+      custom_list_task_changed ( task_model, i );
     taskdata->moved = 0;
-    total_today += today;
   }
-  /*gtk_clist_thaw ( GTK_CLIST(task_list) );*/
+
+  /* new and renamed tasks may (no longer) match the filter */
+  if ( refilter )
+    filter_list ( FALSE );
 
   h = total_today / 3600;
   m = ( total_today - h * 3600 ) / 60;
@@ -2246,10 +2792,19 @@ void update_list () {
   if ( strcmp ( today_test, total_str ) ) {
     strcpy ( total_str, today_test );
     gtk_label_set ( GTK_LABEL ( total_label ), total_str );
-  }
 #ifdef HAVE_APP_INDICATOR
-  app_indicator_set_label(indicator, today_test + 7, "Gtimer Indicator");
+    app_indicator_set_label(indicator, today_test + 7, "Gtimer Indicator");
 #endif
+  }
+}
+
+
+/*
+** Update the time values shown in the list.  Call this after changing
+** anything shown in it.
+*/
+void update_list () {
+  redraw_list ( TRUE );
 }
 
 
@@ -2260,55 +2815,24 @@ static void build_list () {
   Task *task;
   TaskData *taskdata;
   Project *p;
-  char *project_name;
-  char today_str[100], total_str[100];
-  char *row[4];
-  int i, j;
-  GdkPixmap *icon;
-  GdkBitmap *mask;
-  time_t now;
-  static int first = 1;
-  GtkWidget *win;
-  static char *noproject = "";
+  int i;
 
-  if ( splash_window )
-    win = splash_window;
-  else
-    win = main_window;
-
-  /* gtk_clist_freeze ( GTK_CLIST(task_list) ); */
-  gtk_clist_clear ( GTK_CLIST(task_list) );
-
-  if ( first ) {
-    icons[0] = gdk_pixmap_create_from_xpm_d (
-      GTK_WIDGET ( win )->window, &icon_masks[0],
-      &win->style->white, clock1_xpm);
-    icons[1] = gdk_pixmap_create_from_xpm_d (
-      GTK_WIDGET ( win )->window, &icon_masks[1],
-      &win->style->white, clock2_xpm);
-    icons[2] = gdk_pixmap_create_from_xpm_d (
-      GTK_WIDGET ( win )->window, &icon_masks[2],
-      &win->style->white, clock3_xpm);
-    icons[3] = gdk_pixmap_create_from_xpm_d (
-      GTK_WIDGET ( win )->window, &icon_masks[3],
-      &win->style->white, clock4_xpm);
-    icons[4] = gdk_pixmap_create_from_xpm_d (
-      GTK_WIDGET ( win )->window, &icon_masks[4],
-      &win->style->white, clock5_xpm);
-    icons[5] = gdk_pixmap_create_from_xpm_d (
-      GTK_WIDGET ( win )->window, &icon_masks[5],
-      &win->style->white, clock6_xpm);
-    icons[6] = gdk_pixmap_create_from_xpm_d (
-      GTK_WIDGET ( win )->window, &icon_masks[6],
-      &win->style->white, clock7_xpm);
-    icons[7] = gdk_pixmap_create_from_xpm_d (
-      GTK_WIDGET ( win )->window, &icon_masks[7],
-      &win->style->white, clock8_xpm);
-    blankicon = gdk_pixmap_create_from_xpm_d (
-      GTK_WIDGET ( win )->window, &blankicon_mask,
-      &win->style->white, blank_xpm);
+  if ( task_model == NULL ) {
+    icons[0] = gdk_pixbuf_new_from_xpm_data ( (const char **) clock1_xpm );
+    icons[1] = gdk_pixbuf_new_from_xpm_data ( (const char **) clock2_xpm );
+    icons[2] = gdk_pixbuf_new_from_xpm_data ( (const char **) clock3_xpm );
+    icons[3] = gdk_pixbuf_new_from_xpm_data ( (const char **) clock4_xpm );
+    icons[4] = gdk_pixbuf_new_from_xpm_data ( (const char **) clock5_xpm );
+    icons[5] = gdk_pixbuf_new_from_xpm_data ( (const char **) clock6_xpm );
+    icons[6] = gdk_pixbuf_new_from_xpm_data ( (const char **) clock7_xpm );
+    icons[7] = gdk_pixbuf_new_from_xpm_data ( (const char **) clock8_xpm );
+    blankicon = gdk_pixbuf_new_from_xpm_data ( (const char **) blank_xpm );
+    timer_icon = icons[0];
   }
 
+  if ( task_index == NULL )
+    task_index = searchNew ();
+
   if ( tasks == NULL ) {
     tasks = (TaskData **) malloc ( taskCount() * sizeof ( TaskData * ) );
     visible_tasks = (TaskData **) malloc ( taskCount() *
@@ -2320,10 +2844,10 @@ static void build_list () {
       taskdata->task = task;
       taskdata->todays_entry = taskGetTimeEntry ( taskdata->task, today_year,
         today_mon, today_mday );
-      for ( j = 0; j < taskdata->task->num_entries; j++ ) {
-        if ( taskdata->task->entries[j] != taskdata->todays_entry )
-          taskdata->total += taskdata->task->entries[j]->seconds;
-      }
+      taskdata->total = taskSumRange ( taskdata->task, TASK_DATE_MIN,
+        TASK_DATE_MAX );
+      if ( taskdata->todays_entry )
+        taskdata->total -= taskdata->todays_entry->seconds;
       strcpy ( taskdata->last_today, "" );
       strcpy ( taskdata->last_total, "" );
       taskdata->project_name = "";
@@ -2332,43 +2856,35 @@ static void build_list () {
         if ( p != NULL )
           taskdata->project_name = p->name;
       }
+      update_sort_keys ( taskdata );
       tasks[num_tasks++] = taskdata;
-      if ( ! taskOptionEnabled ( taskdata->task, GTIMER_TASK_OPTION_HIDDEN ) )
+      if ( ! taskOptionEnabled ( taskdata->task,
+        GTIMER_TASK_OPTION_HIDDEN ) ) {
         visible_tasks[num_visible_tasks++] = taskdata;
+        index_task ( taskdata );
+      }
     }
     /* sort the list of tasks */
-    qsort ( tasks, num_tasks, sizeof ( TaskData * ), sort_task_by_name );
-    qsort ( visible_tasks, num_visible_tasks, sizeof ( TaskData * ),
-      sort_task_by_name );
+    sort_tasks ( tasks, num_tasks, SORT_TASK_NAME, NULL );
+    sort_tasks ( visible_tasks, num_visible_tasks, SORT_TASK_NAME, NULL );
+    sorted_by = SORT_TASK_NAME;
+    sorted_forward = sort_forward;
   }
 
-  time ( &now );
-  icon = icons[now%8];
-  mask = icon_masks[now%8];
-  for ( i = 0; i < num_visible_tasks; i++ ) {
+  for ( i = 0; i < num_visible_tasks; i++ )
     visible_tasks[i]->moved = 1;
-    task = visible_tasks[i]->task;
-    row[0] = noproject;
-    if ( task->project_id >= 0 ) {
-      p = projectGet ( task->project_id );
-      row[0] = p->name;
-    }
-    row[1] = task->name;
-    sprintf ( today_str, "00:00:00" );
-    row[2] = today_str;
-    sprintf ( total_str, "00:00:00" );
-    row[3] = total_str;
-    gtk_clist_append ( GTK_CLIST(task_list), row );
-    if ( tasks[i]->timer_on )
-      gtk_clist_set_pixtext (GTK_CLIST (task_list), i, 0,
-        visible_tasks[i]->project_name, 2, icon, mask);
-    else
-      gtk_clist_set_pixtext (GTK_CLIST (task_list), i, 0,
-        visible_tasks[i]->project_name, 2, blankicon, blankicon_mask);
-  }
-  /* gtk_clist_thaw ( GTK_CLIST(task_list) ); */
 
-  first = 0;
+  /*
+  ** The rows are read from visible_tasks[] as they are drawn.  In fixed
+  ** height mode, giving the model to the view does not look at the
+  ** contents of any row.
+  */
+  if ( task_model == NULL ) {
+    task_model = custom_list_new_for_tasks ( &visible_tasks,
+      num_visible_tasks );
+    gtk_tree_view_set_model ( GTK_TREE_VIEW ( task_list ),
+      GTK_TREE_MODEL ( task_model ) );
+  }
 }
 
 /*
@@ -2423,7 +2939,7 @@ static gint timeout_handler ( gpointer data ) {
   static time_t last_move = 0;
   GdkModifierType mask;
   char *ptr;
-  int idle;
+  int idle, new_day = 0;
 
   time ( &now );
 
@@ -2440,7 +2956,7 @@ static gint timeout_handler ( gpointer data ) {
     gdk_window_set_icon ( GTK_WIDGET ( main_window )->window,
       NULL, appicon2, appicon2_mask );
     if ( move_to_task >= 0 ) {
-      gtk_clist_moveto ( GTK_CLIST ( task_list ), move_to_task, -1, 0.5, 0 );
+      move_list_to_row ( move_to_task );
       move_to_task = -1;
     }
   } else {
@@ -2457,26 +2973,30 @@ static gint timeout_handler ( gpointer data ) {
   now -= config_midnight_offset;
   tm = localtime ( &now );
   if ( today_mday != tm->tm_mday ) {
+    new_day = 1;
     update_tasks ();
     today_year = tm->tm_year + 1900;
     today_mon = tm->tm_mon + 1;
     today_mday = tm->tm_mday;
     for ( loop = 0; loop < num_tasks; loop++ ) {
-      if ( tasks[loop]->todays_entry )
-        tasks[loop]->total += tasks[loop]->todays_entry->seconds;
       tasks[loop]->todays_entry = taskGetTimeEntry ( tasks[loop]->task,
         today_year, today_mon, today_mday );
-      if ( tasks[loop]->timer_on ) {
-        if ( ! tasks[loop]->todays_entry )
-          tasks[loop]->todays_entry = taskNewTimeEntry ( tasks[loop]->task,
-            today_year, today_mon, today_mday );
-        time ( &tasks[loop]->on_since );
-      }
+      tasks[loop]->total = taskSumRange ( tasks[loop]->task, TASK_DATE_MIN,
+        TASK_DATE_MAX );
+      if ( tasks[loop]->todays_entry )
+        tasks[loop]->total -= tasks[loop]->todays_entry->seconds;
+    }
+    /* timers still running carry on into today's entry */
+    for ( loop = 0; loop < num_timing; loop++ ) {
+      if ( ! timing_tasks[loop]->todays_entry )
+        timing_tasks[loop]->todays_entry = taskNewTimeEntry (
+          timing_tasks[loop]->task, today_year, today_mon, today_mday );
+      time ( &timing_tasks[loop]->on_since );
     }
   }
 
-  /* Update the list */
-  update_list ();
+  /* Update the list (all of it if today's times have all changed) */
+  redraw_list ( new_day );
 
   /* have we been idle for too long? */
   if ( num_timing && configGetAttribute ( CONFIG_IDLE, &ptr ) == 0 &&
@@ -2491,13 +3011,12 @@ static gint timeout_handler ( gpointer data ) {
       /* we've been idle too long. mark time, save to file, then popup window */
       update_tasks ();
       save_all ();
-      for ( loop = 0; loop < num_tasks; loop++ ) {
-        if ( tasks[loop]->timer_on ) {
-          taskMark ( tasks[loop]->task, idle );
-        } else {
-          taskMark ( tasks[loop]->task, 0 );
-        }
-      }
+      /*
+      ** The idle window grabs all input, so only the tasks being timed
+      ** can change until it is answered.
+      */
+      for ( loop = 0; loop < num_timing; loop++ )
+        taskMark ( timing_tasks[loop]->task, idle );
       time ( &now );
       now -= idle;
       tm = localtime ( &now );
@@ -2598,7 +3117,7 @@ void create_splash_window () {
 
 
 void create_main_window () {
-  GtkWidget *vbox;
+  GtkWidget *vbox, *hbox, *label;
   GtkWidget *menu_bar, *toolbutton, *iconw, *table, *scroll, *handlebox;
   GdkPixmap *icon;
   GdkBitmap *mask;
@@ -2655,6 +3174,21 @@ void create_main_window () {
   if ( config_toolbar_enabled )
     gtk_widget_show ( toolbar );
 
+  /* add a box for filtering the list by task or project name */
+  hbox = gtk_hbox_new ( FALSE, 2 );
+  gtk_box_pack_start ( GTK_BOX ( vbox ), hbox, FALSE, FALSE, 2 );
+  label = gtk_label_new ( gettext("Filter: ") );
+  gtk_box_pack_start ( GTK_BOX ( hbox ), label, FALSE, FALSE, 2 );
+  gtk_widget_show ( label );
+  filter_entry = gtk_entry_new ();
+  gtk_signal_connect ( GTK_OBJECT ( filter_entry ), "changed",
+    GTK_SIGNAL_FUNC ( filter_changed_callback ), NULL );
+  gtk_signal_connect ( GTK_OBJECT ( filter_entry ), "activate",
+    GTK_SIGNAL_FUNC ( filter_activate_callback ), NULL );
+  gtk_box_pack_start ( GTK_BOX ( hbox ), filter_entry, TRUE, TRUE, 2 );
+  gtk_widget_show ( filter_entry );
+  gtk_widget_show ( hbox );
+
   /* add in list here */
   if ( configGetAttributeInt ( CONFIG_MAIN_WINDOW_PROJECT_WIDTH, &w ) == 0 )
     task_list_columns[0].width = w;
@@ -2665,18 +3199,16 @@ void create_main_window () {
   if ( configGetAttributeInt ( CONFIG_MAIN_WINDOW_TOTAL_WIDTH, &w ) == 0 )
     task_list_columns[3].width = w;
   task_list = create_list_column_def ( 4, task_list_columns );
-  gtk_clist_set_selection_mode (GTK_CLIST (task_list), GTK_SELECTION_BROWSE);
+  gtk_tree_selection_set_mode (
+    gtk_tree_view_get_selection ( GTK_TREE_VIEW (task_list) ),
+    GTK_SELECTION_BROWSE );
   gtk_widget_set_usize (GTK_WIDGET (task_list), 350, 150);
-#if OLD_GTK
-  gtk_clist_set_policy (GTK_CLIST (task_list),
-    GTK_POLICY_AUTOMATIC, GTK_POLICY_AUTOMATIC);
-#endif
-  gtk_signal_connect (GTK_OBJECT (task_list), "click_column",
-    GTK_SIGNAL_FUNC (column_selected_callback), NULL);
   gtk_signal_connect (GTK_OBJECT (task_list), "event",
     GTK_SIGNAL_FUNC (task_list_event), NULL);
-  gtk_signal_connect_after (GTK_OBJECT (task_list), "select_row",
-    GTK_SIGNAL_FUNC (task_selected_callback), NULL);
+  g_signal_connect ( gtk_tree_view_get_selection ( GTK_TREE_VIEW (task_list) ),
+    "changed", G_CALLBACK (task_selected_callback), NULL);
+  g_signal_connect ( task_list, "row-activated",
+    G_CALLBACK (task_activated_callback), NULL);
 
 #if OLD_GTK
   gtk_box_pack_start ( GTK_BOX ( vbox ), task_list, TRUE, TRUE, 0 );
@@ -2745,6 +3277,323 @@ static void print_help () {
     gettext ( "start timing the specified task" ) );
   printf ( "%-20s %s\n", "-weekstart N",
     gettext ( "use N as the first day of weeks" ) );
+  printf ( "%-20s %s\n", "--report",
+    gettext ( "write a report to stdout without opening a window" ) );
+  printf ( "%-20s %s\n", "  --type T",
+    "daily, weekly, monthly, yearly, total" );
+  printf ( "%-20s %s\n", "  --range R",
+    "today, this-week, last-week, this-and-last-week," );
+  printf ( "%-20s %s\n", "",
+    "last-two-weeks, this-month, last-month, this-year, last-year" );
+  printf ( "%-20s %s\n", "  --from YYYY-MM-DD",
+    gettext ( "first day of the report (instead of the range's)" ) );
+  printf ( "%-20s %s\n", "  --to YYYY-MM-DD",
+    gettext ( "last day of the report (instead of the range's)" ) );
+  printf ( "%-20s %s\n", "  --format F", "text, html" );
+  printf ( "%-20s %s\n", "  --data D", "hours, annotations, both" );
+  printf ( "%-20s %s\n", "  --round N", "none, 1m, 5m, 15m, 1h, ..." );
+  printf ( "%-20s %s\n", "  --tasks T1,T2,...",
+    gettext ( "task names or numbers (default: all visible tasks)" ) );
+}
+
+
+
+/*
+** Set config_midnight_offset from a -midnight argument (HHMM, or -HHMM
+** for before midnight).  Exits on an invalid value.
+*/
+static void parse_midnight_offset ( arg )
+char *arg;
+{
+  char *ptr;
+  int offset;
+
+  for ( ptr = arg; *ptr != '\0'; ptr++ ) {
+    if ( ! isdigit ( *ptr ) && *ptr != '-' ) {
+      fprintf ( stderr, "%s: -midnight %s (%s %s)\n",
+        gettext("Error"), gettext("requires a number"),
+        gettext("not"), arg );
+      exit ( 1 );
+    }
+  }
+  if ( *arg == '-' )
+    offset = atoi ( arg + 1 );
+  else
+    offset = atoi ( arg );
+  if ( offset > 2359 ) {
+    fprintf ( stderr, "%s -midnight: %s\n",
+      gettext("Invalid offset for"), arg );
+    fprintf ( stderr, "%s HHMM (<2359)\n",
+      gettext("Format should be") );
+    exit ( 1 );
+  }
+  config_midnight_offset = ( offset / 100 * 3600 ) + ( offset % 100 * 60 );
+  if ( *arg == '-' )
+    config_midnight_offset *= -1;
+}
+
+
+/*
+** Set config_start_of_week from a -weekstart argument.
+** Exits on an invalid value.
+*/
+static void parse_week_start ( arg )
+char *arg;
+{
+  char *ptr;
+
+  for ( ptr = arg; *ptr != '\0'; ptr++ ) {
+    if ( ! isdigit ( *ptr ) ) {
+      fprintf ( stderr, "%s: -weekstart %s (%s %s)\n",
+        gettext("Error"), gettext("requires a number"),
+        gettext("not"), arg );
+      exit ( 1 );
+    }
+  }
+  config_start_of_week = atoi ( arg );
+  if ( config_start_of_week > 6 ) {
+    fprintf ( stderr, "%s -weekstart: %s\n",
+      gettext("Invalid day of week number for"), arg );
+    exit ( 1 );
+  }
+}
+
+
+/*
+** Find value in a NULL-terminated list of names.
+** Returns the index or -1 if not found.
+*/
+static int lookup_name ( names, value )
+char **names;
+char *value;
+{
+  int loop;
+
+  for ( loop = 0; names[loop]; loop++ ) {
+    if ( strcmp ( names[loop], value ) == 0 )
+      return ( loop );
+  }
+  return ( -1 );
+}
+
+
+/*
+** Is the string all digits?
+*/
+static int is_number ( str )
+char *str;
+{
+  if ( ! *str )
+    return ( 0 );
+  for ( ; *str != '\0'; str++ ) {
+    if ( ! isdigit ( *str ) )
+      return ( 0 );
+  }
+  return ( 1 );
+}
+
+
+/*
+** Generate a report and write it to stdout without opening any
+** windows (the --report option).  The data files are only read;
+** nothing is written back (changes still in the journal are applied
+** in memory only, so this is safe to run on a live data directory).
+** If all the tasks given with --tasks are task numbers, only those
+** task files are loaded.
+** Returns the exit status for the program.
+*/
+static int run_report ( argc, argv )
+int argc;
+char *argv[];
+{
+  static char *range_names[] = { "today", "this-week", "last-week",
+    "this-and-last-week", "last-two-weeks", "this-month", "last-month",
+    "this-year", "last-year", NULL };
+  static char *type_names[] = { "daily", "weekly", "monthly", "yearly",
+    "total", NULL };
+  static char *format_names[] = { "text", "html", NULL };
+  static char *data_names[] = { "hours", "annotations", "both", NULL };
+  static char *options_with_values[] = { "-dir", "-midnight", "-weekstart",
+    "--range", "--from", "--to", "--type", "--format", "--data", "--round",
+    "--tasks", NULL };
+  ReportOptions options;
+  ReportSink sink;
+  Task **tasks, *task;
+  char *task_list = NULL, **names = NULL, *ptr, *name, *path, *option;
+  int loop, range = REPORT_RANGE_THIS_WEEK, data = REPORT_DATA_HOURS;
+  int type = 0; /* index into type_names */
+  int from_day = 0, to_day = 0, have_from = 0, have_to = 0, bad_date = 0;
+  int num_tasks = 0, num_names = 0, num_replayed, all_numbers;
+
+  memset ( &options, '\0', sizeof ( options ) );
+  options.format = REPORT_OUTPUT_TEXT;
+  options.round_incr = REPORT_ROUND_NONE;
+
+  for ( loop = 1; loop < argc; loop++ ) {
+    option = argv[loop];
+    if ( strcmp ( option, "--report" ) == 0 ||
+      strcmp ( option, "-nosplash" ) == 0 ||
+      strcmp ( option, "-resume" ) == 0 )
+      continue;
+    if ( lookup_name ( options_with_values, option ) < 0 ) {
+      fprintf ( stderr, "%s: %s\n", gettext("Unknown option"), option );
+      return ( 1 );
+    }
+    if ( ! argv[loop+1] ) {
+      fprintf ( stderr, "%s: %s %s.\n",
+        gettext("Error"), option, gettext("requires an argument") );
+      return ( 1 );
+    }
+    ptr = argv[++loop];
+    if ( strcmp ( option, "-dir" ) == 0 ) {
+      taskdir = ptr;
+    } else if ( strcmp ( option, "-midnight" ) == 0 ) {
+      parse_midnight_offset ( ptr );
+    } else if ( strcmp ( option, "-weekstart" ) == 0 ) {
+      parse_week_start ( ptr );
+    } else if ( strcmp ( option, "--range" ) == 0 ) {
+      range = lookup_name ( range_names, ptr );
+    } else if ( strcmp ( option, "--from" ) == 0 ) {
+      bad_date = civilParseDate ( ptr, &from_day );
+      have_from = 1;
+    } else if ( strcmp ( option, "--to" ) == 0 ) {
+      bad_date = civilParseDate ( ptr, &to_day );
+      have_to = 1;
+    } else if ( strcmp ( option, "--type" ) == 0 ) {
+      type = lookup_name ( type_names, ptr );
+    } else if ( strcmp ( option, "--format" ) == 0 ) {
+      options.format = lookup_name ( format_names, ptr );
+    } else if ( strcmp ( option, "--data" ) == 0 ) {
+      data = lookup_name ( data_names, ptr );
+    } else if ( strcmp ( option, "--round" ) == 0 ) {
+      /* none, or a number of seconds, minutes (15m) or hours (1h) */
+      if ( strcmp ( ptr, "none" ) == 0 ) {
+        options.round_incr = REPORT_ROUND_NONE;
+      } else {
+        options.round_incr = strtol ( ptr, &name, 10 );
+        if ( *name == 'm' )
+          options.round_incr *= 60;
+        else if ( *name == 'h' )
+          options.round_incr *= 3600;
+        else if ( *name != '\0' && *name != 's' )
+          options.round_incr = -1;
+        if ( *name != '\0' && name[1] != '\0' )
+          options.round_incr = -1;
+        if ( options.round_incr <= 0 )
+          options.round_incr = -1;
+      }
+    } else if ( strcmp ( option, "--tasks" ) == 0 ) {
+      task_list = ptr;
+    }
+    if ( range < 0 || type < 0 || options.format < 0 || data < 0 ||
+      options.round_incr < 0 || bad_date ) {
+      fprintf ( stderr, "%s %s: %s\n",
+        gettext("Invalid value for"), option, ptr );
+      return ( 1 );
+    }
+  }
+  options.type = REPORT_TYPE_DAILY + type;
+  options.include_hours = ( data != REPORT_DATA_ANNOTATIONS );
+  options.include_annotations = ( data != REPORT_DATA_HOURS );
+  options.midnight_offset = config_midnight_offset;
+  options.start_of_week = config_start_of_week;
+  reportGetRange ( range, config_midnight_offset, &options.first_day,
+    &options.last_day );
+  if ( have_from )
+    options.first_day = from_day;
+  if ( have_to )
+    options.last_day = to_day;
+  if ( options.first_day > options.last_day ) {
+    fprintf ( stderr, "%s\n",
+      gettext("The start date is after the end date") );
+    return ( 1 );
+  }
+
+  /* gtk_init() normally sets the locale (used for dates) */
+#ifdef HAVE_LIBINTL_H
+  setlocale ( LC_ALL, "" );
+#endif
+
+  config_file = (char *) malloc ( strlen ( taskdir ) +
+    strlen ( CONFIG_DEFAULT_FILE ) + 2 );
+  sprintf ( config_file, "%s/%s", taskdir, CONFIG_DEFAULT_FILE );
+  configReadAttributes ( config_file );
+  if ( configGetAttributeInt ( CONFIG_LOAD_THREADS, &loop ) == 0 )
+    taskSetLoadThreads ( loop );
+  if ( configGetAttributeInt ( CONFIG_REPORT_THREADS, &loop ) == 0 )
+    options.num_threads = loop;
+
+  /* split up the list of tasks */
+  if ( task_list ) {
+    task_list = strdup ( task_list );
+    names = (char **) malloc ( ( strlen ( task_list ) / 2 + 2 ) *
+      sizeof ( char * ) );
+    for ( name = strtok ( task_list, "," ); name;
+      name = strtok ( NULL, "," ) )
+      names[num_names++] = name;
+  }
+  all_numbers = ( num_names > 0 );
+  for ( loop = 0; loop < num_names; loop++ )
+    all_numbers = all_numbers && is_number ( names[loop] );
+
+  /* load the data, including any changes still in the journal */
+  projectLoadAll ( taskdir );
+  if ( all_numbers ) {
+    for ( loop = 0; loop < num_names; loop++ ) {
+      path = (char *) malloc ( strlen ( taskdir ) +
+        strlen ( names[loop] ) + 7 );
+      sprintf ( path, "%s/%s.task", taskdir, names[loop] );
+      /* a task missing here may still be created by the journal */
+      taskLoad ( path, &task );
+      free ( path );
+    }
+  } else {
+    taskLoadAll ( taskdir );
+  }
+  journalReplay ( taskdir, &num_replayed );
+
+  /* which tasks? (all tasks that are not hidden by default) */
+  tasks = (Task **) malloc ( ( taskCount () + 1 ) * sizeof ( Task * ) );
+  if ( num_names ) {
+    for ( loop = 0; loop < num_names; loop++ ) {
+      name = names[loop];
+      for ( task = taskGetFirst (); task != NULL; task = taskGetNext () ) {
+        if ( is_number ( name ) ? task->number == atoi ( name ) :
+          strcmp ( task->name, name ) == 0 )
+          break;
+      }
+      if ( task )
+        tasks[num_tasks++] = task;
+      else if ( all_numbers )
+        fprintf ( stderr, "%s/%s.task: %s\n", taskdir, name,
+          gettext("Cannot read task") );
+      else
+        fprintf ( stderr, "%s: %s\n", gettext("No such task"), name );
+    }
+  } else {
+    for ( task = taskGetFirst (); task != NULL; task = taskGetNext () ) {
+      if ( ! taskOptionEnabled ( task, GTIMER_TASK_OPTION_HIDDEN ) )
+        tasks[num_tasks++] = task;
+    }
+  }
+
+  reportSinkFile ( &sink, stdout );
+  reportWrite ( &sink, &options, tasks, num_tasks );
+  if ( fflush ( stdout ) != 0 && ! sink.error )
+    sink.error = errno;
+
+  free ( tasks );
+  if ( task_list ) {
+    free ( names );
+    free ( task_list );
+  }
+
+  if ( sink.error ) {
+    fprintf ( stderr, "%s: %s\n", gettext("Error writing report"),
+      strerror ( sink.error ) );
+    return ( 1 );
+  }
+  return ( 0 );
 }
 
 
@@ -2759,7 +3608,8 @@ int main ( int argc, char *argv[] ) {
 #endif
   time_t now;
   struct tm *tm;
-  int loop, loop2, offset, lastTaskNumber;
+  int loop, loop2, lastTaskNumber;
+  int num_replayed = 0;
   char *ptr, *ptr2;
   struct stat buf;
   int display_splash = 1;
@@ -2772,7 +3622,7 @@ int main ( int argc, char *argv[] ) {
 #endif
 #endif
   char *matches[100];
-  int nmatches = 0, found;
+  int nmatches = 0;
   TaskData *td;
   char msg[128];
 
@@ -2838,6 +3688,12 @@ int main ( int argc, char *argv[] ) {
   bind_textdomain_codeset(DEFAULT_TEXT_DOMAIN, "UTF-8");
 #endif
 
+  /* Reports from the command line do not need (or want) a display */
+  for ( loop = 1; loop < argc; loop++ ) {
+    if ( strcmp ( argv[loop], "--report" ) == 0 )
+      exit ( run_report ( argc, argv ) );
+  }
+
   /* Init GTK */
   gtk_init ( &argc, &argv );
 #if OLD_GTK
@@ -2885,49 +3741,14 @@ int main ( int argc, char *argv[] ) {
           gettext("Error"), gettext("requires an argument") );
         exit ( 1 );
       }
-      for ( ptr = argv[++loop]; *ptr != '\0'; ptr++ ) {
-        if ( ! isdigit ( *ptr ) && *ptr != '-' ) {
-          fprintf ( stderr, "%s: -midnight %s (%s %s)\n",
-            gettext("Error"), gettext("requires a number"),
-            gettext("not"), argv[loop] );
-          exit ( 1 );
-        }
-      }
-      ptr = argv[loop];
-      if ( *ptr == '-' )
-        offset = atoi ( ptr + 1 );
-      else
-        offset = atoi ( ptr );
-      if ( offset > 2359 ) {
-        fprintf ( stderr, "%s -midnight: %s\n",
-          gettext("Invalid offset for"), argv[loop] );
-        fprintf ( stderr, "%s HHMM (<2359)\n",
-          gettext("Format should be") );
-        exit ( 1 );
-      }
-      config_midnight_offset = ( offset / 100 * 3600 ) + ( offset % 100 * 60 );
-      if ( *ptr == '-' )
-        config_midnight_offset *= -1;
+      parse_midnight_offset ( argv[++loop] );
     } else if ( strcmp ( argv[loop], "-weekstart" ) == 0 ) {
       if ( ! argv[loop+1] ) {
         fprintf ( stderr, "%s: -weekstart %s.\n",
           gettext("Error"), gettext("requires an argument") );
         exit ( 1 );
       }
-      for ( ptr = argv[++loop]; *ptr != '\0'; ptr++ ) {
-        if ( ! isdigit ( *ptr ) ) {
-          fprintf ( stderr, "%s: -weekstart %s (%s %s)\n",
-            gettext("Error"), gettext("requires a number"),
-            gettext("not"), argv[loop] );
-          exit ( 1 );
-        }
-      }
-      config_start_of_week = atoi ( argv[loop] );
-      if ( config_start_of_week > 6 ) {
-        fprintf ( stderr, "%s -weekstart: %s\n",
-          gettext("Invalid day of week number for"), argv[loop] );
-        exit ( 1 );
-      }
+      parse_week_start ( argv[++loop] );
     } else if ( strcmp ( argv[loop], "-start" ) == 0 ) {
       if ( nmatches < 99 )
         matches[nmatches++] = argv[++loop];
@@ -2963,6 +3784,17 @@ int main ( int argc, char *argv[] ) {
   /* Get the autosave setting */
   configGetAttributeInt ( CONFIG_AUTOSAVE, &config_autosave_enabled );
 
+  /* Get the journal settings */
+  configGetAttributeInt ( CONFIG_JOURNAL, &config_journal_enabled );
+  configGetAttributeInt ( CONFIG_JOURNAL_MAX, &config_journal_max );
+
+  /* Get the snapshot setting */
+  configGetAttributeInt ( CONFIG_SNAPSHOT, &config_snapshot_enabled );
+
+  /* Get the number of threads to load task files with */
+  if ( configGetAttributeInt ( CONFIG_LOAD_THREADS, &loop ) == 0 )
+    taskSetLoadThreads ( loop );
+
   /* Get the idle delay */
   if ( configGetAttributeInt ( CONFIG_IDLE_ON, &config_idle_enabled ) < 0 )
     config_idle_enabled = 1;
@@ -2990,9 +3822,17 @@ int main ( int argc, char *argv[] ) {
   /* load all projects */
   projectLoadAll ( taskdir );
 
-  /* load all tasks */
+  /* load all tasks (from the snapshot for tasks that have not changed) */
+  if ( ! config_snapshot_enabled )
+    snapshotRemove ( taskdir );
   taskLoadAll ( taskdir );
 
+  /* recover any changes left in the journal (from a crash) */
+  if ( journalReplay ( taskdir, &num_replayed ) == 0 && num_replayed > 0 )
+    journalCompact ( taskdir );
+  if ( config_journal_enabled )
+    journalOpen ( taskdir );
+
   /* Create splash window */
   if ( display_splash )
     create_splash_window ();
@@ -3074,29 +3914,17 @@ int main ( int argc, char *argv[] ) {
 
   /* handle tasks specified with -start */
   for ( loop = 0; ! resume && loop < nmatches; loop++ ) {
-    found = 0;
-    for ( loop2 = 0; loop2 < num_visible_tasks && ! found; loop2++ ) {
-      td =  visible_tasks[loop2];
-      if ( strcmp ( td->task->name, matches[loop] ) == 0 ) {
-        found = 1;
-        num_timing++;
-        td->timer_on = 1;
-        time ( &td->on_since );
-        if ( td->todays_entry == NULL )
-          td->todays_entry = taskNewTimeEntry ( td->task, today_year,
-            today_mon, today_mday );
-        /* select the task */
-        gtk_clist_select_row ( GTK_CLIST ( task_list ), loop2, 0 );
-        /* make task visible */
-        move_to_task = loop2;
-        if ( ! splash_window )
-          gtk_clist_moveto ( GTK_CLIST ( task_list ), loop2, -1, 0.5, 0 );
-      }
-    }
-    if ( ! found ) {
-      fprintf ( stderr, "%s \"%s\" %s.\n",
-        gettext ( "Task" ), matches[loop], gettext ( "not found" ) );
-    }
+    if ( ( td = find_task_by_name ( matches[loop] ) ) == NULL )
+      continue;
+    for ( loop2 = 0; visible_tasks[loop2] != td; loop2++ )
+      ;
+    start_timer ( td );
+    /* select the task */
+    select_list_row ( loop2 );
+    /* make task visible */
+    move_to_task = loop2;
+    if ( ! splash_window )
+      move_list_to_row ( loop2 );
   }
 
   if ( resume &&
@@ -3108,18 +3936,13 @@ int main ( int argc, char *argv[] ) {
       for ( loop = 0; loop < num_visible_tasks; loop++ ) {
         td =  visible_tasks[loop];
         if ( td->task->number == lastTaskNumber ) {
-          num_timing++;
-          td->timer_on = 1;
-          time ( &td->on_since );
-          if ( td->todays_entry == NULL )
-            td->todays_entry = taskNewTimeEntry ( td->task, today_year,
-              today_mon, today_mday );
+          start_timer ( td );
           /* select the task */
-          gtk_clist_select_row ( GTK_CLIST ( task_list ), loop, 0 );
+          select_list_row ( loop );
           /* make task visible */
           move_to_task = loop2;
           if ( ! splash_window )
-            gtk_clist_moveto ( GTK_CLIST ( task_list ), loop, -1, 0.5, 0 );
+            move_list_to_row ( loop );
           break;
         }
       }
@@ -21,6 +21,15 @@
  *	Suite 330, Boston, MA  02111-1307, USA
  *
  * History:
+ *	17-Oct-2026	projectGetSaveCounts() counts projects appended to
+ *			the journal separately from project files written.
+ *	16-Oct-2026	projectReplay() no longer removes the files of
+ *			deleted projects; projectCompact() does.
+ *	16-Oct-2026	Added projectDataVersion().
+ *	16-Oct-2026	When the journal is open, projectSaveAll() appends
+ *			the changes to it instead of rewriting files.
+ *	16-Oct-2026	Track unsaved changes so that projectSaveAll()
+ *			only rewrites modified project files.
  *	18-Apr-2005	Fix memory clobber when saving projects.  Based on
  *			debugging work by Ove Kaaven.
  *	20-Feb-2003	Created
@@ -48,6 +57,7 @@
 #include <fcntl.h>
 
 #include "project.h"
+#include "journal.h"
 
 #ifdef GTIMER_MEMDEBUG
 #include "memdebug/memdebug.h"
@@ -60,6 +70,12 @@ static int num_projects = 0;
 static Project **projects = NULL;
 static int max_project = -1;
 static int last_number = -1;
+static int num_written = 0;	/* project files written by projectSaveAll */
+static int num_journaled = 0;	/* projects appended to the journal */
+static int num_skipped = 0;	/* unchanged projects skipped */
+static unsigned long data_version = 0; /* see projectDataVersion() */
+static int *replay_deleted = NULL; /* projects deleted by projectReplay() */
+static int num_replay_deleted = 0;
 
 
 #ifdef WIN32
@@ -111,6 +127,7 @@ Project *project;
 
   projects[project->number] = project;
   num_projects++;
+  data_version++;
 }
 
 
@@ -129,11 +146,25 @@ char *name;
   strcpy ( project->name, name );
   time ( &project->created );
   project->number = -1; /* not yet assigned */
+  project->dirty = PROJECT_DIRTY_NEW;
 
   return ( project );
 }
 
 
+/*
+** Remove a project from memory, leaving its files alone.
+*/
+static void project_remove ( project )
+Project *project;
+{
+  projects[project->number] = NULL;
+  num_projects--;
+  projectFree ( project );
+  data_version++;
+}
+
+
 /*
 ** Delete a project.
 ** Must have no tasks associated with it.
@@ -146,16 +177,19 @@ char *projectdir;
 
   /* TODO: make sure project has no tasks */
 
-  path = (char *) malloc ( strlen ( projectdir ) + 10 );
+  path = (char *) malloc ( strlen ( projectdir ) + 32 );
+  if ( journalIsOpen () ) {
+    sprintf ( path, "PD %d", project->number );
+    journalAppend ( path );
+    journalSync ();
+  }
   sprintf ( path, "%s/%d.project", projectdir, project->number );
   unlink ( path );
   sprintf ( path, "%s/%d.ann", projectdir, project->number );
   unlink ( path );
   free ( path );
 
-  projects[project->number] = NULL;
-  num_projects--;
-  projectFree ( project );
+  project_remove ( project );
 
   return ( 0 );
 }
@@ -226,6 +260,7 @@ void projectClearAll ()
   }
   num_projects = 0;
   last_number = max_project = -1;
+  data_version++;
 }
 
 
@@ -254,15 +289,57 @@ char *projectdir;
   fprintf ( fp, "Created: %u\n", (unsigned int)project->created );
   fprintf ( fp, "Options: %u\n", project->options );
 
-  fclose ( fp );
+  if ( fclose ( fp ) ) {
+    free ( path );
+    return ( PROJECT_ERROR_SYSTEM_ERROR );
+  }
   free ( path );
+  project->dirty = 0;
+  project->journaled = 0;
+
+  return ( 0 );
+}
+
+
+/*
+** Append the changes to a project since it was last saved to the journal.
+*/
+static int project_journal ( project )
+Project *project;
+{
+  char *record;
+  int ret = 0;
+
+  record = (char *) malloc ( strlen ( project->name ) + 64 );
+
+  if ( project->dirty & PROJECT_DIRTY_NEW ) {
+    sprintf ( record, "PC %d %u", project->number,
+      (unsigned int)project->created );
+    ret |= journalAppend ( record );
+  }
+  if ( project->dirty & ( PROJECT_DIRTY_NEW | PROJECT_DIRTY_NAME ) ) {
+    sprintf ( record, "PN %d %s", project->number, project->name );
+    ret |= journalAppend ( record );
+  }
+  if ( project->dirty & ( PROJECT_DIRTY_NEW | PROJECT_DIRTY_OPTIONS ) ) {
+    sprintf ( record, "PO %d %u", project->number, project->options );
+    ret |= journalAppend ( record );
+  }
+  free ( record );
+
+  if ( ret )
+    return ( PROJECT_ERROR_SYSTEM_ERROR );
+  project->dirty = 0;
+  project->journaled = 1;
 
   return ( 0 );
 }
 
 
 /*
-** Save all projects
+** Save all projects that have changed since they were loaded or
+** last saved.  If the journal is open, the changes are appended to
+** the journal rather than rewriting each project file.
 */
 int projectSaveAll ( projectdir )
 char *projectdir;
@@ -272,6 +349,60 @@ char *projectdir;
 
   for ( loop = 0; loop <= max_project; loop++ ) {
     if ( projects[loop] ) {
+      if ( ! projects[loop]->dirty ) {
+        num_skipped++;
+        continue;
+      }
+      if ( journalIsOpen () ) {
+        ret = project_journal ( projects[loop] );
+        if ( ret == 0 )
+          num_journaled++;
+      } else {
+        ret = projectSave ( projects[loop], projectdir );
+        if ( ret == 0 )
+          num_written++;
+      }
+      if ( ret )
+        return ( ret );
+    }
+  }
+  if ( journalIsOpen () && journalSync () )
+    return ( PROJECT_ERROR_SYSTEM_ERROR );
+  return ( 0 );
+}
+
+
+/*
+** Write every project that has changes in the journal back to its file.
+** Called by journalCompact().
+*/
+int projectCompact ( projectdir )
+char *projectdir;
+{
+  char *path;
+  int loop, number;
+  int ret;
+
+  /* remove the files of projects deleted in the journal (unless reused) */
+  path = (char *) malloc ( strlen ( projectdir ) + 32 );
+  for ( loop = 0; loop < num_replay_deleted; loop++ ) {
+    number = replay_deleted[loop];
+    if ( number <= max_project && projects[number] )
+      continue;
+    sprintf ( path, "%s/%d.project", projectdir, number );
+    unlink ( path );
+    sprintf ( path, "%s/%d.ann", projectdir, number );
+    unlink ( path );
+  }
+  free ( path );
+  if ( replay_deleted )
+    free ( replay_deleted );
+  replay_deleted = NULL;
+  num_replay_deleted = 0;
+
+  for ( loop = 0; loop <= max_project; loop++ ) {
+    if ( projects[loop] &&
+      ( projects[loop]->journaled || projects[loop]->dirty ) ) {
       ret = projectSave ( projects[loop], projectdir );
       if ( ret )
         return ( ret );
@@ -281,6 +412,82 @@ char *projectdir;
 }
 
 
+/*
+** Apply a single project record from the journal (see journal.h).
+** Only the projects in memory are changed: a deleted project's files
+** are removed by projectCompact().
+** Returns PROJECT_ERROR_BAD_FILE if the record cannot be parsed.
+*/
+int projectReplay ( record, projectdir )
+char *record;
+char *projectdir;
+{
+  Project *project = NULL;
+  char *ptr;
+  int number;
+
+  if ( strlen ( record ) < 4 || record[2] != ' ' )
+    return ( PROJECT_ERROR_BAD_FILE );
+  number = strtol ( record + 3, &ptr, 10 );
+  if ( ptr == record + 3 || number < 0 )
+    return ( PROJECT_ERROR_BAD_FILE );
+  if ( *ptr == ' ' )
+    ptr++;
+  if ( number <= max_project )
+    project = projects[number];
+
+  if ( record[1] == 'C' ) {
+    if ( ! project ) {
+      project = projectCreate ( "" );
+      project->number = number;
+      projectAdd ( project );
+    }
+    project->created = (time_t) strtoul ( ptr, NULL, 10 );
+  } else if ( ! project ) {
+    /* a record for a project that has since been deleted */
+    return ( PROJECT_ERROR_BAD_FILE );
+  } else if ( record[1] == 'N' ) {
+    projectSetName ( project, ptr );
+  } else if ( record[1] == 'O' ) {
+    project->options = (unsigned int) strtoul ( ptr, NULL, 10 );
+  } else if ( record[1] == 'D' ) {
+    replay_deleted = (int *) realloc ( replay_deleted,
+      ( num_replay_deleted + 1 ) * sizeof ( int ) );
+    replay_deleted[num_replay_deleted++] = number;
+    project_remove ( project );
+    return ( 0 );
+  } else {
+    return ( PROJECT_ERROR_BAD_FILE );
+  }
+
+  /* the change is already in the journal; it just needs compacting */
+  project->dirty = 0;
+  project->journaled = 1;
+  data_version++;
+
+  return ( 0 );
+}
+
+
+/*
+** Get the number of project files written, the number of projects
+** appended to the journal and the number of unchanged projects skipped
+** by projectSaveAll() since the program started.
+*/
+void projectGetSaveCounts ( written, journaled, skipped )
+int *written;
+int *journaled;
+int *skipped;
+{
+  if ( written )
+    *written = num_written;
+  if ( journaled )
+    *journaled = num_journaled;
+  if ( skipped )
+    *skipped = num_skipped;
+}
+
+
 
 /*
 ** Free all resources of a project.
@@ -471,15 +678,49 @@ void projectSetOption ( project, option )
 Project *project;
 unsigned int option;
 {
-  project->options |= option;
+  if ( ( project->options & option ) != option ) {
+    project->options |= option;
+    project->dirty |= PROJECT_DIRTY_OPTIONS;
+    data_version++;
+  }
 }
 
 void projectUnsetOption ( project, option )
 Project *project;
 unsigned int option;
 {
-  if ( projectOptionEnabled ( project, option ) )
+  if ( projectOptionEnabled ( project, option ) ) {
     project->options -= option;
+    project->dirty |= PROJECT_DIRTY_OPTIONS;
+    data_version++;
+  }
+}
+
+
+/*
+** Change the name of a project.
+*/
+void projectSetName ( project, name )
+Project *project;
+char *name;
+{
+  if ( project->name && strcmp ( project->name, name ) == 0 )
+    return;
+  free ( project->name );
+  project->name = (char *) malloc ( strlen ( name ) + 1 );
+  strcpy ( project->name, name );
+  project->dirty |= PROJECT_DIRTY_NAME;
+  data_version++;
+}
+
+
+/*
+** Get the current data version.  It goes up every time any project is
+** added, deleted or changed in memory.
+*/
+unsigned long projectDataVersion ()
+{
+  return ( data_version );
 }
 
 
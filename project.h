@@ -32,11 +32,18 @@
 #define PROJECT_ERROR_SYSTEM_ERROR	1	/* check errno value */
 #define PROJECT_ERROR_BAD_FILE	2	/* bad file format */
 
+/* Values for Project.dirty (what has changed since the last save) */
+#define PROJECT_DIRTY_NAME	0x0001	/* name changed */
+#define PROJECT_DIRTY_OPTIONS	0x0002	/* options changed */
+#define PROJECT_DIRTY_NEW	0x0004	/* never been saved */
+
 typedef struct {
   char *name;			/* name of project */
   time_t created;		/* time created */
   int number;			/* unique project id number */
   unsigned int options;		/* app-defined bit-or options */
+  unsigned int dirty;		/* PROJECT_DIRTY_* changes since last save */
+  int journaled;		/* has changes in journal not in file */
 } Project;
 
 /*
@@ -60,6 +67,11 @@ unsigned int projectOptions ( Project *project );
 unsigned int projectOptionEnabled ( Project *project, unsigned int option );
 void projectSetOption ( Project *project, unsigned int option );
 void projectUnsetOption ( Project *project, unsigned int option );
+void projectSetName ( Project *project, char *name );
+void projectGetSaveCounts ( int *written, int *journaled, int *skipped );
+int projectReplay ( char *record, char *projectdir );
+int projectCompact ( char *projectdir );
 char *projectErrorString ( int project_error );
+unsigned long projectDataVersion ();
 
 #endif /* _PROJECT_H */
@@ -30,6 +30,32 @@
  *	https://www.k5n.us/gtimer/
  *
  * History:
+ *	17-Oct-2026	Release the report text once it has all been added
+ *			to the window and search, save and print from the
+ *			text buffer a piece at a time.  The text is shared
+ *			with the report cache rather than copied.
+ *	16-Oct-2026	Keep the text of a report in memory and add it to
+ *			the report window a piece at a time when idle, so
+ *			the first page shows at once.  Search the text with
+ *			the Boyer-Moore-Horspool algorithm.
+ *	16-Oct-2026	Added a "Custom" time range with From and To dates.
+ *	16-Oct-2026	Map selected rows in the task list straight to their
+ *			tasks using the index stored with each row.
+ *	16-Oct-2026	Reuse the last report when the same one is asked
+ *			for again and nothing it covers has changed.
+ *	16-Oct-2026	Use the report-threads setting.
+ *	16-Oct-2026	Stream reports into the text window, the HTML file,
+ *			saved files and the print command rather than
+ *			formatting them into a temporary file first.
+ *	16-Oct-2026	Moved report generation to reportgen.c so reports
+ *			can also be run from the command line.
+ *	16-Oct-2026	Gather the time for all selected tasks and days into
+ *			a matrix first; weekly, monthly and yearly totals
+ *			are then sums over runs of days.
+ *	16-Oct-2026	Walk each task's time entries once for the whole
+ *			report rather than searching them for every day.
+ *	16-Oct-2026	TaskGetAnnotationEntries() no longer allocates its
+ *			return value.
  *	27-Feb-2006	Added "Last Year" report option.  (Bruno Gravato)
  *	27-Feb-2006	Fix a crash in daily reports when annotations are
  *			included.  (Russ Allbery)
@@ -114,6 +140,8 @@
 #include "task.h"
 #include "gtimer.h"
 #include "config.h"
+#include "reportgen.h"
+#include "civil.h"
 // PV:
 #include "custom-list.h"
 
@@ -124,24 +152,6 @@
 
 #define NO_TOOLTIPS	1
 
-/* CSS stylesheet */
-#define CSS_STYLE "\
-<style>\n\
-body {\n\
-  background: #ffffff;\n\
-}\n\
-th {\n\
-  background: #c0c0c0;\n\
-}\n\
-td {\n\
-  background: #ffffff;\n\
-}\n\
-</style>\n"
-
-#define ONE_DAY	(3600*24)
-static int month_days[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
-static int lmonth_days[] = { 31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
-
 extern TaskData **visible_tasks;
 extern int num_visible_tasks;
 extern int config_midnight_offset;
@@ -150,16 +160,6 @@ extern GtkWidget *main_window;
 extern GdkPixmap *appicon2;
 extern GdkPixmap *appicon2_mask;
 
-/* Report types */
-#define REPORT_RANGE_TODAY              0
-#define REPORT_RANGE_THIS_WEEK          1
-#define REPORT_RANGE_LAST_WEEK          2
-#define REPORT_RANGE_THIS_AND_LAST_WEEK 3
-#define REPORT_RANGE_LAST_TWO_WEEKS     4
-#define REPORT_RANGE_THIS_MONTH         5
-#define REPORT_RANGE_LAST_MONTH         6
-#define REPORT_RANGE_THIS_YEAR          7
-#define REPORT_RANGE_LAST_YEAR          8
 static char *time_options[] = { gettext_noop("Today"),
                                 gettext_noop("This Week"),
                                 gettext_noop("Last Week"),
@@ -169,33 +169,18 @@ static char *time_options[] = { gettext_noop("Today"),
                                 gettext_noop("Last Month"),
                                 gettext_noop("This Year"),
                                 gettext_noop("Last Year"),
+                                gettext_noop("Custom"),
 				NULL };
 
-/* Output types */
-#define REPORT_OUTPUT_TEXT		0
-#define REPORT_OUTPUT_HTML		1
-/* LaTeX next? */
 static char *output_options[] = { gettext_noop("Text"),
                                   gettext_noop("HTML"),
 				  NULL };
 
-/* Data to include */
-#define REPORT_DATA_HOURS		0
-#define REPORT_DATA_ANNOTATIONS		1
-#define REPORT_DATA_BOTH		2
 static char *data_options[] = { gettext_noop("Hours worked"),
                                 gettext_noop( "Annotations"),
                                 gettext_noop("Hours & Annotations"),
 				NULL };
 
-/* Rounding options */
-#define REPORT_ROUND_NONE		0
-#define REPORT_ROUND_MINUTE		60
-#define REPORT_ROUND_5_MINUTES		300
-#define REPORT_ROUND_10_MINUTES		600
-#define REPORT_ROUND_15_MINUTES		900
-#define REPORT_ROUND_30_MINUTES		1800
-#define REPORT_ROUND_HOUR		3600
 static char *round_options[] = { gettext_noop("None"),
                                  gettext_noop("Minute"),
                                  gettext_noop("5 Minutes"),
@@ -210,24 +195,12 @@ static int round_values[]= { REPORT_ROUND_NONE,
   REPORT_ROUND_30_MINUTES, REPORT_ROUND_HOUR, -1 };
   
 
-typedef struct {
-  TaskData *taskdata;
-  time_t weekly_total;
-  time_t monthly_total;
-  time_t yearly_total;
-  time_t total;
-  char *todays_annotations;
-  char *weekly_annotations;
-  char *monthly_annotations;
-  char *yearly_annotations;
-  char *total_annotations;
-  char week_start[20];
-} ReportTaskData;
-
 typedef struct {
   GtkWidget *window;
   GtkWidget *time_menu;
-  GtkWidget *time_menu_items[9];
+  GtkWidget *time_menu_items[10];
+  GtkWidget *from_entry;
+  GtkWidget *to_entry;
   GtkWidget *output_menu;
   GtkWidget *output_menu_items[2];
   GtkWidget *data_menu;
@@ -238,8 +211,6 @@ typedef struct {
   GtkTreeView *task_list;    // PV: +
   TaskData **tasks;
   int num_tasks;
-//  GtkWidget **list_items;  // PV: -
-  GtkTreePath **list_items;  // PV: +
   report_type type;
   int include_hours;
   int include_annotations;
@@ -247,86 +218,146 @@ typedef struct {
 
 typedef struct {
   GtkWidget *window;
-  char *text;
+  GtkTextBuffer *buffer;
+  GtkWidget *text_view;
+  GtkWidget *search_entry;
+  ReportSink sink;		/* holds the report until it is all in buffer */
+  const char *text;		/* the report (not nul-terminated) */
+  int len;
+  int inserted;			/* bytes of text added to buffer so far */
+  guint idle_id;		/* idle handler adding the rest */
+  int search_pos;		/* character offset "Next" searches from */
   GtkWidget *filesel;
   GtkWidget *printwin;
   GtkWidget *printentry;
 } DisplayReportData;
 
 
+/*
+** Bytes of text added to the report window at a time.  The first
+** piece is added before the window is shown and the rest when idle.
+*/
+#define TEXT_INSERT_CHUNK	(64*1024)
 
-
+/*
+** Characters of the text buffer copied out at a time when searching,
+** saving or printing the report.
+*/
+#define TEXT_READ_CHUNK		(64*1024)
 
 
 /*
-** Append an annotation to the given pointer after we realloc some
-** space for it.  optionally include the date and time and indent
-** all lines to make it look nice.
+** Add the next piece of the report text to the text buffer.  Pieces
+** end after a newline (or at least between UTF-8 characters).  Once
+** it has all been added, the report text is released; from then on
+** the text buffer is the only copy the window keeps.
+** Returns TRUE if there is more text to add.
 */
-static void concat_annotation ( ptr, annotation, include_date,
-  include_time, indentation, newline )
-char **ptr;
-TaskAnnotation *annotation;
-int include_date, include_time;
-char *indentation;
-char *newline;
+static gboolean insert_text_chunk ( drd )
+DisplayReportData *drd;
 {
-  struct tm *tm;
-  char date_time_str[30];
-  char padding[30], *p;
-  char *anntext, *newtext;
-  int first;
-
-  strcpy ( date_time_str, indentation );
-  tm = localtime ( &annotation->text_time );
-  if ( include_date )
-    sprintf ( date_time_str + strlen ( date_time_str ),
-      "%02d/%02d/%02d ", tm->tm_mon + 1,
-      tm->tm_mday, tm->tm_year % 100 );
-
-  if ( include_time )
-    sprintf ( date_time_str + strlen ( date_time_str ),
-      "%02d:%02d ", tm->tm_hour, tm->tm_min );
-
-  strcpy ( padding, date_time_str );
-  for ( p = padding; *p != '\0'; p++ )
-    *p = ' ';
-
-  /* make a copy of the annotation text because strtok() stomps on it */
-  anntext = (char *) malloc ( strlen ( annotation->text ) + 1 );
-  strcpy ( anntext, annotation->text );
-
-  if ( *ptr ) {
-    newtext = (char *) malloc ( strlen ( *ptr ) + 1 );
-    strcpy ( newtext, *ptr );
+  GtkTextIter iter;
+  int end, start = drd->inserted;
+
+  if ( start >= drd->len )
+    return ( FALSE );
+  end = start + TEXT_INSERT_CHUNK;
+  if ( end >= drd->len ) {
+    end = drd->len;
   } else {
-    newtext = (char *) malloc ( 1 );
-    newtext[0] = '\0';
-  }
-  first = 1;
-  p = strtok ( anntext, "\n" );
-  while ( p ) {
-    newtext = (char *) realloc ( newtext,
-      strlen ( newtext ) + strlen ( p ) + strlen ( padding ) + 2 +
-      strlen ( newline ) );
-    if ( first ) {
-      first = 0;
-      strcat ( newtext, date_time_str );
-    } else {
-      strcat ( newtext, padding );
+    while ( end > start && drd->text[end - 1] != '\n' )
+      end--;
+    if ( end == start ) {
+      end = start + TEXT_INSERT_CHUNK;
+      while ( end > start && ( drd->text[end] & 0xC0 ) == 0x80 )
+        end--;
     }
-    strcat ( newtext, p );
-    strcat ( newtext, newline );
-    p = strtok ( NULL, "\n" );
   }
-  free ( anntext );
 
-  if ( *ptr )
-    free ( *ptr );
-  *ptr = newtext;
+  gtk_text_buffer_get_end_iter ( drd->buffer, &iter );
+  gtk_text_buffer_insert ( drd->buffer, &iter, drd->text + start,
+    end - start );
+  drd->inserted = end;
+  if ( drd->inserted >= drd->len ) {
+    reportSinkTextFree ( &drd->sink );
+    drd->text = NULL;
+    return ( FALSE );
+  }
+
+  return ( TRUE );
+}
+
+
+static gboolean insert_text_idle ( data )
+gpointer data;
+{
+  DisplayReportData *drd = (DisplayReportData *) data;
+
+  if ( insert_text_chunk ( drd ) )
+    return ( TRUE );
+  drd->idle_id = 0;
+  return ( FALSE );
 }
 
 
+/*
+** Make sure the text buffer holds at least the first len bytes of
+** the report.
+*/
+static void insert_text_upto ( drd, len )
+DisplayReportData *drd;
+int len;
+{
+  while ( drd->inserted < len && insert_text_chunk ( drd ) )
+    ;
+  if ( drd->inserted >= drd->len && drd->idle_id ) {
+    g_source_remove ( drd->idle_id );
+    drd->idle_id = 0;
+  }
+}
+
+
+/*
+** Copy the characters of the text buffer from offset start up to (but
+** not including) offset end.  Caller must g_free() the return value.
+*/
+static gchar *get_buffer_text ( drd, start, end )
+DisplayReportData *drd;
+int start, end;
+{
+  GtkTextIter istart, iend;
+
+  gtk_text_buffer_get_iter_at_offset ( drd->buffer, &istart, start );
+  gtk_text_buffer_get_iter_at_offset ( drd->buffer, &iend, end );
+  return ( gtk_text_buffer_get_text ( drd->buffer, &istart, &iend, TRUE ) );
+}
+
+
+/*
+** Write the report text to a report sink, a piece of the text buffer
+** at a time.
+** Returns 0 on success or the errno value of a failed write.
+*/
+static int write_report_text ( drd, sink )
+DisplayReportData *drd;
+ReportSink *sink;
+{
+  gchar *piece;
+  int start, count;
+
+  insert_text_upto ( drd, drd->len );
+  count = gtk_text_buffer_get_char_count ( drd->buffer );
+  for ( start = 0; start < count && ! sink->error;
+    start += TEXT_READ_CHUNK ) {
+    piece = get_buffer_text ( drd, start, start + TEXT_READ_CHUNK );
+    errno = 0;
+    if ( sink->write ( sink, piece, strlen ( piece ) ) )
+      sink->error = errno ? errno : EIO;
+    g_free ( piece );
+  }
+  return ( sink->error );
+}
+
 
 static void display_text_results_ok_callback ( widget, data )
 GtkWidget *widget;
@@ -343,7 +374,10 @@ gpointer data;
     gtk_grab_remove ( drd->printwin );
     gtk_widget_destroy ( drd->printwin );
   }
-  free ( drd->text );
+  if ( drd->idle_id )
+    g_source_remove ( drd->idle_id );
+  g_object_unref ( drd->buffer );
+  reportSinkTextFree ( &drd->sink );
   free ( drd );
 }
 
@@ -365,6 +399,7 @@ gpointer data;
   char *file;
   int fd;
   char *msg;
+  ReportSink sink;
 
 // PV: better: gtk_file_chooser_dialog  see
 // http://library.gnome.org/devel/gtk/stable/GtkFileChooserDialog.html
@@ -382,8 +417,20 @@ gpointer data;
       NULL, NULL, NULL, NULL );
     free ( msg );
   } else {
-    write ( fd, drd->text, strlen ( drd->text ) );
-    close ( fd );
+    reportSinkFd ( &sink, fd );
+    write_report_text ( drd, &sink );
+    if ( close ( fd ) != 0 && ! sink.error )
+      sink.error = errno;
+    if ( sink.error ) {
+      msg = (char *) malloc ( strlen ( file ) + 100 );
+      sprintf ( msg, "%s %d %s\n%s", gettext ("Error"),
+        sink.error, gettext("writing to file"), file );
+      create_confirm_window ( CONFIRM_ERROR,
+        gettext("Error"), msg, gettext("Ok"), NULL, NULL,
+        NULL, NULL, NULL, NULL );
+      free ( msg );
+      return;
+    }
     gtk_grab_remove ( drd->filesel );
     gtk_widget_destroy ( drd->filesel );
     drd->filesel = NULL;
@@ -421,10 +468,10 @@ gpointer data;
   DisplayReportData *drd = (DisplayReportData *)data;
   FILE *fp = NULL;
   char cmd[500], *ptr, *msg;
+  ReportSink sink;
 
 #if PV_DEBUG
   printf("OK(print)\n");
-  printf("\n****************\n%s", drd->text);
 #endif
 
 // PV: warning: assignment discards qualifiers from pointer target type
@@ -448,9 +495,9 @@ gpointer data;
         NULL, NULL, NULL, NULL );
     free ( msg );
   } else {
-    fwrite ( drd->text, strlen ( drd->text ), sizeof(char), fp );
-    fclose ( fp );
-    if ( ferror (fp) ) {
+    reportSinkFile ( &sink, fp );
+    write_report_text ( drd, &sink );
+    if ( pclose ( fp ) != 0 || sink.error ) {
       create_confirm_window ( CONFIRM_ERROR,
         gettext("Error"), gettext("Error printing"),
         gettext("Ok"), NULL, NULL,
@@ -538,83 +585,120 @@ gpointer data;
 }
 
 
-/* PV: static void display_text_results ( text )
-*     rewritten during migration to GTK2
-*     Thanks to Vijay Kumar B. and his tutorial
-*     Multiline Text Editing Widget
+/*
+** Find the first occurrence of pattern in text at or after byte offset
+** from using the Boyer-Moore-Horspool algorithm.
+** Returns the byte offset of the match or -1 if there is none.
 */
-
-void
-find (GtkTextView *text_view, const gchar *text, GtkTextIter *iter)
+static int search_text ( text, len, pattern, from )
+const char *text;
+int len;
+const char *pattern;
+int from;
 {
-  GtkTextIter mstart, mend;
-  gboolean found;
-  GtkTextBuffer *buffer;
-  GtkTextMark *last_pos;
-
-  buffer = gtk_text_view_get_buffer (GTK_TEXT_VIEW (text_view));
-  found = gtk_text_iter_forward_search (iter, text, 0, &mstart, &mend, NULL);
-
-  if (found)
-    {
-      gtk_text_buffer_select_range (buffer, &mstart, &mend);
-      last_pos = gtk_text_buffer_create_mark (buffer, "last_pos", 
-                                              &mend, FALSE);
-      gtk_text_view_scroll_mark_onscreen (text_view, last_pos);
-    }
+  int skip[256];
+  int plen, loop, pos, last;
+
+  plen = strlen ( pattern );
+  if ( plen == 0 || from < 0 || len - from < plen )
+    return ( -1 );
+
+  for ( loop = 0; loop < 256; loop++ )
+    skip[loop] = plen;
+  last = plen - 1;
+  for ( loop = 0; loop < last; loop++ )
+    skip[(unsigned char) pattern[loop]] = last - loop;
+
+  for ( pos = from; pos <= len - plen;
+    pos += skip[(unsigned char) text[pos + last]] ) {
+    if ( text[pos + last] == pattern[last] &&
+      memcmp ( text + pos, pattern, last ) == 0 )
+      return ( pos );
+  }
+  return ( -1 );
 }
 
 
+/*
+** Search the text buffer for the contents of the search entry from
+** character offset from, and select and show the match.  The rest of
+** the report is added to the buffer first, and the buffer is then
+** searched a piece at a time.  Each piece runs on for one character
+** less than the search text so no match is missed between pieces.
+*/
+static void find ( drd, from )
+DisplayReportData *drd;
+int from;
+{
+  const gchar *text;
+  gchar *piece;
+  GtkTextIter mstart, mend;
+  int start, count, nchars, pos, end = -1;
 
-typedef struct _App {
-  GtkWidget *text_view;
-  GtkWidget *search_entry;
-} App;
-
-App app;
+  text = gtk_entry_get_text ( GTK_ENTRY ( drd->search_entry ) );
+  nchars = g_utf8_strlen ( text, -1 );
+  if ( nchars == 0 )
+    return;
+  insert_text_upto ( drd, drd->len );
+  count = gtk_text_buffer_get_char_count ( drd->buffer );
+  start = from;
+  while ( end < 0 && start + nchars <= count ) {
+    piece = get_buffer_text ( drd, start,
+      start + TEXT_READ_CHUNK + nchars - 1 );
+    pos = search_text ( piece, strlen ( piece ), text, 0 );
+    if ( pos >= 0 ) {
+      start += g_utf8_pointer_to_offset ( piece, piece + pos );
+      end = start + nchars;
+    } else {
+      start += TEXT_READ_CHUNK;
+    }
+    g_free ( piece );
+  }
+  if ( end < 0 )
+    return;
 
-void
-win_destroy (void)
-{
-  gtk_main_quit();
+  gtk_text_buffer_get_iter_at_offset ( drd->buffer, &mstart, start );
+  gtk_text_buffer_get_iter_at_offset ( drd->buffer, &mend, end );
+  gtk_text_buffer_select_range ( drd->buffer, &mstart, &mend );
+  gtk_text_view_scroll_mark_onscreen ( GTK_TEXT_VIEW ( drd->text_view ),
+    gtk_text_buffer_get_insert ( drd->buffer ) );
+  drd->search_pos = end;
 }
 
-void
-next_button_clicked (GtkWidget *next_button, App *app)
-{
-  const gchar *text;
-  GtkTextBuffer *buffer;
-  GtkTextMark *last_pos;
-  GtkTextIter iter;
 
-  text = gtk_entry_get_text (GTK_ENTRY (app->search_entry));
-  
-  buffer = gtk_text_view_get_buffer (GTK_TEXT_VIEW (app->text_view));
+static void next_button_clicked ( widget, data )
+GtkWidget *widget;
+gpointer data;
+{
+  DisplayReportData *drd = (DisplayReportData *) data;
 
-  last_pos = gtk_text_buffer_get_mark (buffer, "last_pos");
-  if (last_pos == NULL)
+  if ( drd->search_pos < 0 )
     return;
-
-  gtk_text_buffer_get_iter_at_mark (buffer, &iter, last_pos);
-  find (GTK_TEXT_VIEW (app->text_view), text, &iter);
+  find ( drd, drd->search_pos );
 }
 
-void
-search_button_clicked (GtkWidget *search_button, App *app)
-{
-  const gchar *text;
-  GtkTextBuffer *buffer;
-  GtkTextIter iter;
 
-  text = gtk_entry_get_text (GTK_ENTRY (app->search_entry));
-  buffer = gtk_text_view_get_buffer (GTK_TEXT_VIEW (app->text_view));
-  gtk_text_buffer_get_start_iter (buffer, &iter);
+static void search_button_clicked ( widget, data )
+GtkWidget *widget;
+gpointer data;
+{
+  DisplayReportData *drd = (DisplayReportData *) data;
 
-  find (GTK_TEXT_VIEW (app->text_view), text, &iter);
+  find ( drd, 0 );
 }
 
 
-void static display_text_results ( char *text )
+/* PV: static void display_text_results ( buffer )
+*     rewritten during migration to GTK2
+*     Thanks to Vijay Kumar B. and his tutorial
+*     Multiline Text Editing Widget
+*/
+/*
+** Show a text report.  drd holds the report text; the window and
+** text buffer are created here and drd is freed when the window is
+** closed.
+*/
+void static display_text_results ( DisplayReportData *drd )
 {
   GtkWidget *vbox;
   GtkWidget *hbox;
@@ -625,9 +709,6 @@ void static display_text_results ( char *text )
   // PV: additional variables and original objects
   GtkWidget		*hbox2;
   GtkWidget		*save_button, *print_button, *ok_button;
-  GtkTextBuffer		*txbuf;
-  size_t		txlen;
-  DisplayReportData	*drd;
   char			msg[100];
 
 #if PV_DEBUG
@@ -635,10 +716,8 @@ void static display_text_results ( char *text )
 #endif
 
 
-  // At first copy original code
-  drd = (DisplayReportData *) malloc ( sizeof ( DisplayReportData ) );
-  memset ( drd, '\0', sizeof ( DisplayReportData ) );
-  drd->text = text;
+  drd->buffer = gtk_text_buffer_new ( NULL );
+  drd->search_pos = -1;
 
 #if PV_DEBUG
   g_message("Display_text_results: checkpoint 1");
@@ -675,8 +754,8 @@ void static display_text_results ( char *text )
   hbox = gtk_hbox_new (FALSE, 2);
   gtk_box_pack_start (GTK_BOX (vbox), hbox, FALSE, FALSE, 0);
   
-  app.search_entry = gtk_entry_new ();
-  gtk_box_pack_start (GTK_BOX (hbox), app.search_entry, TRUE, TRUE, 0);
+  drd->search_entry = gtk_entry_new ();
+  gtk_box_pack_start (GTK_BOX (hbox), drd->search_entry, TRUE, TRUE, 0);
 
 #if PV_DEBUG
   g_message("Display_text_results: checkpoint 3");
@@ -686,12 +765,12 @@ void static display_text_results ( char *text )
   search_button = gtk_button_new_with_label ("Search");  
   gtk_box_pack_start (GTK_BOX (hbox), search_button, FALSE, FALSE, 0);
   g_signal_connect (G_OBJECT (search_button), "clicked", 
-                    G_CALLBACK (search_button_clicked), &app);
+                    G_CALLBACK (search_button_clicked), drd);
 
   next_button = gtk_button_new_with_label ("Next");
   gtk_box_pack_start (GTK_BOX (hbox), next_button, FALSE, FALSE, 0);
   g_signal_connect (G_OBJECT (next_button), "clicked",
-                    G_CALLBACK (next_button_clicked), &app);
+                    G_CALLBACK (next_button_clicked), drd);
 
   swindow = gtk_scrolled_window_new (NULL, NULL);
   gtk_scrolled_window_set_policy (GTK_SCROLLED_WINDOW (swindow),
@@ -704,19 +783,13 @@ void static display_text_results ( char *text )
 #endif
 
 
-// PV: add: set text
-  txbuf = gtk_text_buffer_new(NULL);
-  txlen = strlen ( text );
-  gtk_text_buffer_set_text ( GTK_TEXT_BUFFER ( txbuf ), text, txlen );
-// PV: end of set text
-
-#if PV_DEBUG
-  g_message("Display_text_results: checkpoint 5");
-#endif
+  drd->text_view = gtk_text_view_new_with_buffer (drd->buffer);
+  gtk_text_view_set_editable(GTK_TEXT_VIEW(drd->text_view),0);
+  gtk_container_add (GTK_CONTAINER (swindow), drd->text_view);
 
-  app.text_view = gtk_text_view_new_with_buffer (txbuf);
-  gtk_text_view_set_editable(GTK_TEXT_VIEW(app.text_view),0);
-  gtk_container_add (GTK_CONTAINER (swindow), app.text_view);
+  /* show the first page now and add the rest when idle */
+  if ( insert_text_chunk ( drd ) )
+    drd->idle_id = g_idle_add ( insert_text_idle, drd );
 
   hbox2 = gtk_hbox_new (FALSE, 2);
   gtk_box_pack_start (GTK_BOX (vbox), hbox2, FALSE, FALSE, 0);
@@ -757,570 +830,20 @@ void static display_text_results ( char *text )
 
 
 
-static time_t do_round ( time_in, round_incr )
-time_t time_in;
-int round_incr;
-{
-  int t, n, r;
-
-  if ( round_incr == 0 )
-    return ( time_in );
-
-  t = (int) time_in;
-  r = t % round_incr;
-  t -= r;
-  if ( r > ( round_incr / 2 ) )
-    t += round_incr;
-
-  return ( (time_t) t );
-}
-
 
 
-static time_t summarize_day ( fp, seltasks, num_seltasks, then, type,
-  format, include_hours, include_annotations, round_incr, is_last )
-FILE *fp;
-ReportTaskData **seltasks;
-int num_seltasks;
-time_t then;
-report_type type;
-int format;
-int include_hours;
-int include_annotations;
-int round_incr;
-int is_last;
-{
-  struct tm *tm;
-  int found = 0;
-  int loop, loop2;
-  int mon, mday, year, wday;
-  TaskTimeEntry *entry;
-  TaskAnnotation **anns;
-  int num_anns = 0;
-  int h, m, s, rounded;
-  time_t ret = 0;
-  char indentation[30];
-  int ncols = 0;
-  char *newline = "\n";
-  char daystring[20];
 
-  switch ( format ) {
-    case REPORT_OUTPUT_TEXT:
-      newline = "\n";
-      break;
-    case REPORT_OUTPUT_HTML:
-      newline = "<br>\n";
-      break;
-  }
-
-  if ( include_hours )
-    ncols++;
-  if ( include_annotations )
-    ncols++;
-
-  tm = localtime ( &then );
-  mon = tm->tm_mon + 1;
-  mday = tm->tm_mday;
-  year = tm->tm_year + 1900;
-  wday = tm->tm_wday;
-
-  if ( include_hours )
-    strcpy ( indentation, "            " );
-  else
-    strcpy ( indentation, "  " );
-
-  strftime ( daystring, sizeof(daystring), "%x %a", tm );
-
-  for ( loop = 0; loop < num_seltasks; loop++ ) {
-    if ( ( seltasks[loop]->week_start[0] == '\0' ) ||
-      ( tm->tm_wday == config_start_of_week ) )
-      strcpy ( seltasks[loop]->week_start, daystring );
-    if ( include_hours )
-      entry = taskGetTimeEntry ( seltasks[loop]->taskdata->task,
-        year, mon, mday );
-    else
-      entry = NULL;
-    if ( include_annotations ) {
-      anns = TaskGetAnnotationEntries ( seltasks[loop]->taskdata->task,
-        year, mon, mday, config_midnight_offset, &num_anns );
-      for ( loop2 = 0; loop2 < num_anns; loop2++ ) {
-        if ( type == REPORT_TYPE_DAILY )
-          concat_annotation ( &seltasks[loop]->todays_annotations,
-            anns[loop2], 0, 0, indentation, newline );
-        else if ( type == REPORT_TYPE_WEEKLY )
-          concat_annotation ( &seltasks[loop]->weekly_annotations,
-            anns[loop2], 0, 0, indentation, newline );
-        else if ( type == REPORT_TYPE_MONTHLY )
-          concat_annotation ( &seltasks[loop]->monthly_annotations,
-            anns[loop2], 0, 0, indentation, newline );
-        else if ( type == REPORT_TYPE_YEARLY )
-          concat_annotation ( &seltasks[loop]->yearly_annotations,
-            anns[loop2], 0, 0, indentation, newline );
-        else if ( type == REPORT_TYPE_TOTAL )
-          concat_annotation ( &seltasks[loop]->total_annotations,
-            anns[loop2], 0, 0, indentation, newline );
-      }
-      if ( anns )
-        free ( anns );
-    }
-    rounded = 0;
-    if ( ( entry && entry->seconds ) || seltasks[loop]->todays_annotations ) {
-      if ( entry && entry->seconds ) {
-        rounded = do_round ( entry->seconds, round_incr );
-        h = rounded / 3600;
-        m = ( rounded - h * 3600 ) / 60;
-        s = rounded % 60;
-      }
-      if ( type == REPORT_TYPE_DAILY ) {
-        if ( ! found ) {
-          switch ( format ) {
-            case REPORT_OUTPUT_TEXT:
-              fprintf ( fp, "\n%s\n", daystring );
-              fprintf ( fp, "-------------------------------------\n" );
-              break;
-            case REPORT_OUTPUT_HTML:
-              fprintf ( fp, "<tr><th colspan=\"%d\">",
-                ncols + 1 );
-              fprintf ( fp, "\n%s\n", daystring );
-              fprintf ( fp, "</th></tr>\n" );
-              break;
-          }
-          found = 1;
-        }
-        if ( format == REPORT_OUTPUT_HTML )
-          fprintf ( fp, "<tr>" );
-        if ( include_hours ) {
-          switch ( format ) {
-            case REPORT_OUTPUT_TEXT:
-              fprintf ( fp, "%3d:%02d:%02d - [%s] %s\n", h, m, s,
-                seltasks[loop]->taskdata->task->project_id < 0 ?
-                "none" : seltasks[loop]->taskdata->project_name,
-                seltasks[loop]->taskdata->task->name );
-              break;
-            case REPORT_OUTPUT_HTML:
-              fprintf ( fp,
-                "<td align=\"right\" valign=\"top\">%d:%02d:%02d</td>",
-                h, m, s );
-              fprintf ( fp, "<td valign=\"top\">[%s] %s</td>",
-                seltasks[loop]->taskdata->task->project_id < 0 ?
-                "none" : seltasks[loop]->taskdata->project_name,
-                seltasks[loop]->taskdata->task->name );
-              break;
-          }
-        } else {
-          switch ( format ) {
-            case REPORT_OUTPUT_TEXT:
-              fprintf ( fp, "[%s] %s\n",
-                seltasks[loop]->taskdata->task->project_id < 0 ?
-                "none" : seltasks[loop]->taskdata->project_name,
-                seltasks[loop]->taskdata->task->name );
-              break;
-            case REPORT_OUTPUT_HTML:
-              fprintf ( fp, "<td valign=\"top\">[%s] %s</td>",
-                seltasks[loop]->taskdata->task->project_id < 0 ?
-                "none" : seltasks[loop]->taskdata->project_name,
-                seltasks[loop]->taskdata->task->name );
-              break;
-          }
-        }
-      }
-      if ( rounded ) {
-        ret += rounded;
-        /* update totals */
-        seltasks[loop]->weekly_total += rounded;
-        seltasks[loop]->monthly_total += rounded;
-        seltasks[loop]->yearly_total += rounded;
-        seltasks[loop]->total += rounded;
-      }
-      if ( seltasks[loop]->todays_annotations ) {
-        switch ( format ) {
-          case REPORT_OUTPUT_TEXT:
-            fprintf ( fp, "%s", seltasks[loop]->todays_annotations );
-            break;
-          case REPORT_OUTPUT_HTML:
-            fprintf ( fp, "<td>%s</td>", seltasks[loop]->todays_annotations );
-            break;
-        }
-        free ( seltasks[loop]->todays_annotations );
-        seltasks[loop]->todays_annotations = NULL;
-      }
-      if ( type == REPORT_TYPE_DAILY && format == REPORT_OUTPUT_HTML )
-        fprintf ( fp, "</tr>\n" );
-    }
-  }
 
-  if ( type == REPORT_TYPE_DAILY && ret ) {
-    h = ret / 3600;
-    m = ( ret - h * 3600 ) / 60;
-    s = ret % 60;
-    switch ( format ) {
-      case REPORT_OUTPUT_TEXT:
-        fprintf ( fp, "---------\n" );
-        fprintf ( fp, "%3d:%02d:%02d - %s\n", h, m, s, gettext("Total") );
-        break;
-      case REPORT_OUTPUT_HTML:
-        fprintf ( fp, "<tr><td align=\"right\"><b>%d:%02d:%02d</b></td>",
-          h, m, s );
-        fprintf ( fp, "<td><b>%s</b></td></tr>\n", gettext("Total") );
-        break;
-    }
-  }
-
-  if ( ( type == REPORT_TYPE_WEEKLY ) && 
-    ( wday == ( ( config_start_of_week + 6 ) % 7 ) || is_last ) ) {
-    found = 0;
-    for ( loop = 0; loop < num_seltasks; loop++ ) {
-      if ( seltasks[loop]->weekly_total ||
-        seltasks[loop]->weekly_annotations ) {
-        if ( ! found ) {
-          switch ( format ) {
-            case REPORT_OUTPUT_TEXT:
-              fprintf ( fp, "\n%s %s %s %s\n", gettext("Week"),
-                seltasks[loop]->week_start, gettext("to"), daystring );
-              fprintf ( fp, "-------------------------------------\n" );
-              break;
-            case REPORT_OUTPUT_HTML:
-              fprintf ( fp, "<tr><th colspan=\"%d\">", ncols + 1 );
-              fprintf ( fp, "%s %s %s %s", gettext("Week"),
-                seltasks[loop]->week_start, gettext("to"), daystring );
-              fprintf ( fp, "</th></tr>\n" );
-              break;
-          }
-          found = 1;
-        }
-        if ( include_hours ) {
-          h = seltasks[loop]->weekly_total / 3600;
-          m = ( seltasks[loop]->weekly_total - h * 3600 ) / 60;
-          s = seltasks[loop]->weekly_total % 60;
-          switch ( format ) {
-            case REPORT_OUTPUT_TEXT:
-              fprintf ( fp, "%3d:%02d:%02d - [%s] %s\n", h, m, s,
-                seltasks[loop]->taskdata->task->project_id < 0 ?
-                "none" : seltasks[loop]->taskdata->project_name,
-                seltasks[loop]->taskdata->task->name );
-              break;
-            case REPORT_OUTPUT_HTML:
-              fprintf ( fp,
-                "<tr><td valign=\"top\" align=\"right\">%d:%02d:%02d</td>",
-                h, m, s );
-              fprintf ( fp, "<td valign=\"top\">[%s] %s</td>",
-                seltasks[loop]->taskdata->task->project_id < 0 ?
-                "none" : seltasks[loop]->taskdata->project_name,
-                seltasks[loop]->taskdata->task->name );
-              break;
-          }
-          seltasks[loop]->weekly_total = 0;
-        } else {
-          switch ( format ) {
-            case REPORT_OUTPUT_TEXT:
-              fprintf ( fp, "[%s] %s\n",
-                seltasks[loop]->taskdata->task->project_id < 0 ?
-                "none" : seltasks[loop]->taskdata->project_name,
-                seltasks[loop]->taskdata->task->name );
-              break;
-            case REPORT_OUTPUT_HTML:
-              fprintf ( fp, "<td valign=\"top\">[%s] %s</td>",
-                seltasks[loop]->taskdata->task->project_id < 0 ?
-                "none" : seltasks[loop]->taskdata->project_name,
-                seltasks[loop]->taskdata->task->name );
-              break;
-          }
-        }
-        if ( seltasks[loop]->weekly_annotations ) {
-          switch ( format ) {
-            case REPORT_OUTPUT_TEXT:
-              fprintf ( fp, "%s", seltasks[loop]->weekly_annotations );
-              break;
-            case REPORT_OUTPUT_HTML:
-              fprintf ( fp, "<td>%s</td>", seltasks[loop]->weekly_annotations );
-              break;
-          }
-          free ( seltasks[loop]->weekly_annotations );
-          seltasks[loop]->weekly_annotations = NULL;
-        }
-        if ( format == REPORT_OUTPUT_HTML )
-          fprintf ( fp, "</tr>\n" );
-      }
-    }
-  }
-
-  if ( ( type == REPORT_TYPE_MONTHLY ) &&
-    ( is_last ||
-    ( ( ( tm->tm_year % 4 == 0 ) &&
-      ( lmonth_days[tm->tm_mon] == tm->tm_mday ) ) ||
-    ( ( tm->tm_year % 4 != 0 ) &&
-      ( month_days[tm->tm_mon] == tm->tm_mday ) ) ) ) ) {
-    found = 0;
-    for ( loop = 0; loop < num_seltasks; loop++ ) {
-      if ( seltasks[loop]->monthly_total ||
-        seltasks[loop]->monthly_annotations ) {
-        if ( ! found ) {
-          switch ( format ) {
-            case REPORT_OUTPUT_TEXT:
-              fprintf ( fp, "\n%s %02d/%d\n", gettext("Month"), mon, year );
-              fprintf ( fp, "-------------------------------------\n" );
-              break;
-            case REPORT_OUTPUT_HTML:
-              fprintf ( fp, "<tr><th colspan=\"%d\">%s %02d/%d</th></tr>",
-                ncols + 1, gettext("Month"), mon, year );
-              break;
-          }
-          found = 1;
-        }
-        if ( include_hours ) {
-          h = seltasks[loop]->monthly_total / 3600;
-          m = ( seltasks[loop]->monthly_total - h * 3600 ) / 60;
-          s = seltasks[loop]->monthly_total % 60;
-          switch ( format ) {
-            case REPORT_OUTPUT_TEXT:
-              fprintf ( fp, "%3d:%02d:%02d - [%s] %s\n", h, m, s,
-                seltasks[loop]->taskdata->task->project_id < 0 ?
-                "none" : seltasks[loop]->taskdata->project_name,
-                seltasks[loop]->taskdata->task->name );
-              break;
-            case REPORT_OUTPUT_HTML:
-              fprintf ( fp, "<td valign=\"top\">%d:%02d:%02d</td>",
-                h, m, s );
-              fprintf ( fp, "<td valign=\"top\">[%s] %s</td>",
-                seltasks[loop]->taskdata->task->project_id < 0 ?
-                "none" : seltasks[loop]->taskdata->project_name,
-                seltasks[loop]->taskdata->task->name );
-              break;
-          }
-          seltasks[loop]->monthly_total = 0;
-        }
-        else {
-          switch ( format ) {
-            case REPORT_OUTPUT_TEXT:
-              fprintf ( fp, "[%s] %s\n",
-                seltasks[loop]->taskdata->task->project_id < 0 ?
-                "none" : seltasks[loop]->taskdata->project_name,
-                seltasks[loop]->taskdata->task->name );
-              break;
-            case REPORT_OUTPUT_HTML:
-              fprintf ( fp, "<td valign=\"top\">[%s] %s</td>",
-                seltasks[loop]->taskdata->task->project_id < 0 ?
-                "none" : seltasks[loop]->taskdata->project_name,
-                seltasks[loop]->taskdata->task->name );
-              break;
-          }
-        }
-        if ( seltasks[loop]->monthly_annotations ) {
-          switch ( format ) {
-            case REPORT_OUTPUT_TEXT:
-              fprintf ( fp, "%s", seltasks[loop]->monthly_annotations );
-              break;
-            case REPORT_OUTPUT_HTML:
-              fprintf ( fp, "<td>%s</td>",
-                seltasks[loop]->monthly_annotations );
-              break;
-          }
-          free ( seltasks[loop]->monthly_annotations );
-          seltasks[loop]->monthly_annotations = NULL;
-        }
-        if ( format == REPORT_OUTPUT_HTML )
-          fprintf ( fp, "</tr>\n" );
-      }
-    }
-  }
-
-  if ( ( type == REPORT_TYPE_YEARLY ) &&
-    ( is_last || ( tm->tm_mon == 12 && tm->tm_mday == 31 ) ) ) {
-    found = 0;
-    for ( loop = 0; loop < num_seltasks; loop++ ) {
-      if ( seltasks[loop]->yearly_total ||
-        seltasks[loop]->yearly_annotations ) {
-        if ( ! found ) {
-          switch ( format ) {
-            case REPORT_OUTPUT_TEXT:
-              fprintf ( fp, "\n%s %d\n", gettext("Year"), year );
-              fprintf ( fp, "-------------------------------------\n" );
-              break;
-            case REPORT_OUTPUT_HTML:
-              fprintf ( fp, "<tr><th colspan=\"%d\">%s %d</th></tr>\n",
-                ncols + 1, gettext("Year"), year );
-              break;
-          }
-          found = 1;
-        }
-        if ( include_hours ) {
-          h = seltasks[loop]->yearly_total / 3600;
-          m = ( seltasks[loop]->yearly_total - h * 3600 ) / 60;
-          s = seltasks[loop]->yearly_total % 60;
-          switch ( format ) {
-            case REPORT_OUTPUT_TEXT:
-              fprintf ( fp, "%3d:%02d:%02d - [%s] %s\n", h, m, s,
-                seltasks[loop]->taskdata->task->project_id < 0 ?
-                "none" : seltasks[loop]->taskdata->project_name,
-                seltasks[loop]->taskdata->task->name );
-              break;
-            case REPORT_OUTPUT_HTML:
-              fprintf ( fp, "<td valign=\"top\">%d:%02d:%02d</td>",
-                h, m, s );
-              fprintf ( fp, "<td valign=\"top\">[%s] %s</td>",
-                seltasks[loop]->taskdata->task->project_id < 0 ?
-                "none" : seltasks[loop]->taskdata->project_name,
-                seltasks[loop]->taskdata->task->name );
-              break;
-          }
-          seltasks[loop]->yearly_total = 0;
-        }
-        else {
-          switch ( format ) {
-            case REPORT_OUTPUT_TEXT:
-              fprintf ( fp, "[%s] %s\n",
-                seltasks[loop]->taskdata->task->project_id < 0 ?
-                "none" : seltasks[loop]->taskdata->project_name,
-                seltasks[loop]->taskdata->task->name );
-              break;
-            case REPORT_OUTPUT_HTML:
-              fprintf ( fp, "<td valign=\"top\">[%s] %s</td>",
-                seltasks[loop]->taskdata->task->project_id < 0 ?
-                "none" : seltasks[loop]->taskdata->project_name,
-                seltasks[loop]->taskdata->task->name );
-              break;
-          }
-        }
-        if ( seltasks[loop]->yearly_annotations ) {
-          switch ( format ) {
-            case REPORT_OUTPUT_TEXT:
-              fprintf ( fp, "%s", seltasks[loop]->yearly_annotations );
-              break;
-            case REPORT_OUTPUT_HTML:
-              fprintf ( fp, "<td>%s</td>",
-                seltasks[loop]->yearly_annotations );
-              break;
-          }
-          free ( seltasks[loop]->yearly_annotations );
-          seltasks[loop]->yearly_annotations = NULL;
-        }
-        if ( format == REPORT_OUTPUT_HTML )
-          fprintf ( fp, "</tr>\n" );
-      }
-    }
-  }
-
-  if ( ( type == REPORT_TYPE_TOTAL ) && is_last ) {
-    found = 0;
-    for ( loop = 0; loop < num_seltasks; loop++ ) {
-      if ( seltasks[loop]->yearly_total ) {
-        if ( ! found ) {
-          switch ( format ) {
-            case REPORT_OUTPUT_TEXT:
-              fprintf ( fp, "\n%s\n", gettext("Totals") );
-              fprintf ( fp, "-------------------------------------\n" );
-              break;
-            case REPORT_OUTPUT_HTML:
-              fprintf ( fp, "<tr><th COLSPAN=\"%d\">%s</th></tr>\n",
-                ncols + 1, gettext("Totals") );
-              break;
-          }
-          found = 1;
-        }
-        if ( include_hours ) {
-          h = seltasks[loop]->total / 3600;
-          m = ( seltasks[loop]->total - h * 3600 ) / 60;
-          s = seltasks[loop]->total % 60;
-          switch ( format ) {
-            case REPORT_OUTPUT_TEXT:
-              fprintf ( fp, "%3d:%02d:%02d - [%s] %s\n", h, m, s,
-                seltasks[loop]->taskdata->task->project_id < 0 ?
-                "none" : seltasks[loop]->taskdata->project_name,
-                seltasks[loop]->taskdata->task->name );
-              break;
-            case REPORT_OUTPUT_HTML:
-              fprintf ( fp, "<td valign=\"top\">%d:%02d:%02d</td>", h, m, s );
-              fprintf ( fp, "<td valign=\"top\">[%s] %s</td>",
-                seltasks[loop]->taskdata->task->project_id < 0 ?
-                "none" : seltasks[loop]->taskdata->project_name,
-                seltasks[loop]->taskdata->task->name );
-              break;
-          }
-          seltasks[loop]->total = 0;
-        }
-        else {
-          switch ( format ) {
-            case REPORT_OUTPUT_TEXT:
-              fprintf ( fp, "[%s] %s\n",
-                seltasks[loop]->taskdata->task->project_id < 0 ?
-                "none" : seltasks[loop]->taskdata->project_name,
-                seltasks[loop]->taskdata->task->name );
-              break;
-            case REPORT_OUTPUT_HTML:
-              fprintf ( fp, "<td valign=\"top\">[%s] %s</td>",
-                seltasks[loop]->taskdata->task->project_id < 0 ?
-                "none" : seltasks[loop]->taskdata->project_name,
-                seltasks[loop]->taskdata->task->name );
-              break;
-          }
-        }
-        if ( seltasks[loop]->total_annotations ) {
-          switch ( format ) {
-            case REPORT_OUTPUT_TEXT:
-              fprintf ( fp, "%s", seltasks[loop]->total_annotations );
-              break;
-            case REPORT_OUTPUT_HTML:
-              fprintf ( fp, "<td>%s</td>",
-                seltasks[loop]->total_annotations );
-              break;
-          }
-          free ( seltasks[loop]->total_annotations );
-          seltasks[loop]->total_annotations = NULL;
-        }
-        if ( format == REPORT_OUTPUT_HTML )
-          fprintf ( fp, "</tr>\n" );
-      }
-    }
-  }
-
-  if ( is_last ) {
-    for ( loop = 0; loop < num_seltasks; loop++ ) {
-      if ( seltasks[loop]->todays_annotations )
-        free ( seltasks[loop]->todays_annotations );
-      if ( seltasks[loop]->weekly_annotations )
-        free ( seltasks[loop]->weekly_annotations );
-      if ( seltasks[loop]->monthly_annotations )
-        free ( seltasks[loop]->monthly_annotations );
-      if ( seltasks[loop]->yearly_annotations )
-        free ( seltasks[loop]->yearly_annotations );
-      if ( seltasks[loop]->total_annotations )
-        free ( seltasks[loop]->total_annotations );
-      seltasks[loop]->todays_annotations = NULL;
-      seltasks[loop]->weekly_annotations = NULL;
-      seltasks[loop]->monthly_annotations = NULL;
-      seltasks[loop]->yearly_annotations = NULL;
-      seltasks[loop]->total_annotations = NULL;
-    }
-  }
-
-  return ( ret );
-}
-
-
-
-
-static void display_html_results ( text )
-char *text;
+/*
+** Show the HTML report that has been written to tempfile in the
+** user's browser.
+*/
+static void display_html_results ( tempfile )
+char *tempfile;
 {
   char *path;
-  int fd = -1;
-  char tempfile[L_tmpnam];
   char *command;
 
-  if (tmpnam(tempfile))
-    fd = open ( tempfile, O_WRONLY | O_CREAT | O_EXCL, 0600 );
-  if (fd == -1) {
-    create_confirm_window ( CONFIRM_ERROR,
-        gettext("Error"),
-        gettext("Error opening temporary file"),
-        gettext("Ok"), NULL, NULL,
-        NULL, NULL, NULL, NULL );
-    return;
-  }
-  write ( fd, text, strlen ( text ) );
-  close ( fd );
-  free ( text );
-
   if ( configGetAttribute ( CONFIG_BROWSER, &path ) < 0 )
     path = "mozilla";
 
@@ -1352,26 +875,20 @@ gpointer data;
 #else
   int loop;
 #endif
-  ReportTaskData **seltasks;
+  Task **seltasks;
   int num_selected = 0;
   int range = REPORT_RANGE_TODAY;
   int format = REPORT_OUTPUT_TEXT;
   int round_incr = REPORT_ROUND_NONE;
-  FILE *fp;
-  time_t now, time_start, time_end, time_loop, total;
-  struct tm *tm;
-  struct stat buf;
-  char *text = NULL;
-  int ret, ncols, h, m, s;
-  size_t len;
+  ReportOptions options;
+  ReportSink sink;
+  DisplayReportData *drd = NULL;
+  char tempfile[L_tmpnam];
+  int fd = -1;
   // PV:
   GtkTreeSelection *select;
-#if PV_DEBUG
-  volatile const char *s1;
-  volatile const char *s2;
-#else
-  const char *s1, *s2;
-#endif
+  CustomList *customlist;
+  int index;
 
 //  selected = GTK_LIST ( rd->task_list ) ->selection;
 
@@ -1422,6 +939,8 @@ gpointer data;
       gettext("Ok"), NULL, NULL,
       NULL, NULL, NULL,
       NULL );
+    g_list_foreach ( selected, (GFunc) gtk_tree_path_free, NULL );
+    g_list_free ( selected );
     return;
   }
 
@@ -1430,22 +949,17 @@ gpointer data;
 #endif
 
   /* which tasks were selected... */
-  seltasks = (ReportTaskData **) malloc
-    ( sizeof ( ReportTaskData * ) * rd->num_tasks );
-  for ( loop = 0; loop < rd->num_tasks; loop++ )
-    seltasks[loop] = NULL;
+  /* each row in the list carries the index of its task in rd->tasks */
+  customlist = CUSTOM_LIST ( gtk_tree_view_get_model (
+    GTK_TREE_VIEW ( rd->task_list ) ) );
+  seltasks = (Task **) malloc ( sizeof ( Task * ) * rd->num_tasks );
   for ( item = selected; item != NULL; item = item->next ) {
-    s1 = gtk_tree_path_to_string(item->data);
-    for ( loop = 0; loop < rd->num_tasks; loop++ ) {
-       s2 = gtk_tree_path_to_string(rd->list_items[loop]);
-        if ( ! strcmp(s1, s2) ) {
-        seltasks[num_selected] = (ReportTaskData *) malloc
-          ( sizeof ( ReportTaskData ) );
-        memset ( seltasks[num_selected], '\0', sizeof ( ReportTaskData ) );
-        seltasks[num_selected++]->taskdata = rd->tasks[loop];
-      }
-    }
+    index = custom_list_get_index ( customlist, (GtkTreePath *) item->data );
+    if ( index >= 0 && index < rd->num_tasks )
+      seltasks[num_selected++] = rd->tasks[index]->task;
   }
+  g_list_foreach ( selected, (GFunc) gtk_tree_path_free, NULL );
+  g_list_free ( selected );
 
 #if PV_DEBUG
   g_message("Report checkpoint 2");
@@ -1459,6 +973,34 @@ gpointer data;
       range = loop;
     }
   }
+  if ( range == REPORT_RANGE_CUSTOM ) {
+    if ( civilParseDate ( (char *) gtk_entry_get_text (
+      GTK_ENTRY ( rd->from_entry ) ), &options.first_day ) ||
+      civilParseDate ( (char *) gtk_entry_get_text (
+      GTK_ENTRY ( rd->to_entry ) ), &options.last_day ) ) {
+      create_confirm_window ( CONFIRM_ERROR,
+        gettext("Error"),
+        gettext("Dates must be entered as YYYY-MM-DD"),
+        gettext("Ok"), NULL, NULL,
+        NULL, NULL, NULL,
+        NULL );
+      free ( seltasks );
+      return;
+    }
+    if ( options.first_day > options.last_day ) {
+      create_confirm_window ( CONFIRM_ERROR,
+        gettext("Error"),
+        gettext("The start date is after the end date"),
+        gettext("Ok"), NULL, NULL,
+        NULL, NULL, NULL,
+        NULL );
+      free ( seltasks );
+      return;
+    }
+  } else {
+    reportGetRange ( range, config_midnight_offset, &options.first_day,
+      &options.last_day );
+  }
 
 #if PV_DEBUG
   g_message("Report checkpoint 3");
@@ -1489,139 +1031,72 @@ gpointer data;
   gtk_grab_remove ( rd->window );
   gtk_widget_destroy ( rd->window );
 
-  /* Generate the report... */
-  fp = tmpfile();
-  if ( ! fp ) {
+  /*
+  ** Generate the report straight into where it is going: memory for
+  ** the text window or the file the browser will read.
+  */
+  if ( format == REPORT_OUTPUT_HTML ) {
+    if ( tmpnam ( tempfile ) )
+      fd = open ( tempfile, O_WRONLY | O_CREAT | O_EXCL, 0600 );
+  } else {
+    drd = (DisplayReportData *) malloc ( sizeof ( DisplayReportData ) );
+    memset ( drd, '\0', sizeof ( DisplayReportData ) );
+  }
+  if ( format == REPORT_OUTPUT_HTML && fd == -1 ) {
     create_confirm_window ( CONFIRM_ERROR,
       gettext("Error"),
       gettext("Error opening temporary file"),
       gettext("Ok"), NULL, NULL,
       NULL, NULL, NULL,
       NULL );
-    for ( loop = 0; loop < num_visible_tasks; loop++ )
-      free ( seltasks[loop] );
     free ( seltasks );
     free ( rd->tasks );
-    free ( rd->list_items );
     free ( rd );
     return;
   }
-  time ( &now );
-  now -= config_midnight_offset;
-  tm = localtime ( &now );
-  switch ( range ) {
-    case REPORT_RANGE_TODAY:
-      time_start = time_end = now;
-      break;
-    case REPORT_RANGE_LAST_WEEK:
-      time_start = now - ONE_DAY * tm->tm_wday - ONE_DAY * 7;
-      time_end = now - ONE_DAY * tm->tm_wday - ONE_DAY;
-      break;
-    case REPORT_RANGE_THIS_AND_LAST_WEEK:
-      time_start = now - ONE_DAY * tm->tm_wday - ONE_DAY * 7;
-      time_end = time_start + ONE_DAY * 14;
-      break;
-    case REPORT_RANGE_LAST_TWO_WEEKS:
-      time_start = now - ONE_DAY * tm->tm_wday - ONE_DAY * 14;
-      time_end = now - ONE_DAY * tm->tm_wday - ONE_DAY;
-      break;
-    case REPORT_RANGE_THIS_MONTH:
-      time_start = now - ( ONE_DAY * ( tm->tm_mday - 1 ) );
-      time_end = now;
-      break;
-    case REPORT_RANGE_LAST_MONTH:
-      if ( tm->tm_mon == 0 )
-        time_start = now - ( ONE_DAY * ( tm->tm_mday - 1 ) ) - ONE_DAY * 31;
-      else if ( tm->tm_year % 4 == 0 )
-        time_start = now - ( ONE_DAY * ( tm->tm_mday - 1 ) ) -
-          ONE_DAY * lmonth_days[tm->tm_mon-1];
-      else
-        time_start = now - ( ONE_DAY * ( tm->tm_mday - 1 ) ) -
-          ONE_DAY * month_days[tm->tm_mon-1];
-      time_end = now - ONE_DAY * tm->tm_mday;
-      break;
-    case REPORT_RANGE_THIS_YEAR:
-      time_start = now - ONE_DAY * tm->tm_yday;
-      time_end = now;
-      break;
-    case REPORT_RANGE_LAST_YEAR:
-      if ( (tm->tm_year - 1) % 4 == 0 )
-        time_start = now - ONE_DAY * ( tm->tm_yday + 366 );
-      else
-        time_start = now - ONE_DAY * ( tm->tm_yday + 365 );
-      time_end = now - ONE_DAY * ( tm->tm_yday + 1 );
-      break;
-    default:
-    case REPORT_RANGE_THIS_WEEK:
-      time_start = now - ONE_DAY * tm->tm_wday;
-      time_end = now;
-      break;
-  }
-
-  if ( format == REPORT_OUTPUT_HTML ) {
-    fprintf ( fp, "<html><head><title>GTimer %s</title></head>\n",
-      gettext("Report") );
-    fprintf ( fp, "%s", CSS_STYLE );
-    fprintf ( fp, "<body>\n" );
-    fprintf ( fp, "<table>\n" );
-    ncols = 1;
-    if ( rd->include_hours )
-      ncols++;
-    if ( rd->include_annotations )
-      ncols++;
-  }
-
+  options.type = rd->type;
+  options.format = format;
+  options.include_hours = rd->include_hours;
+  options.include_annotations = rd->include_annotations;
+  options.round_incr = round_incr;
+  options.midnight_offset = config_midnight_offset;
+  options.start_of_week = config_start_of_week;
+  if ( configGetAttributeInt ( CONFIG_REPORT_THREADS,
+    &options.num_threads ) != 0 )
+    options.num_threads = 1;
 #if PV_DEBUG
   g_message("Report checkpoint \"total\"");
 #endif
 
-
-  total = 0;
-  for ( time_loop = time_start; time_loop <= time_end; time_loop += ONE_DAY ) {
-    total += summarize_day ( fp, seltasks, num_selected, time_loop, rd->type,
-      format, rd->include_hours, rd->include_annotations, round_incr,
-      ( time_loop == time_end ) );
-  }
-
-  h = total / 3600;
-  m = ( total - h * 3600 ) / 60;
-  s = total % 60;
-
-  switch ( format ) {
-    case REPORT_OUTPUT_TEXT:
-      fprintf ( fp, "\n%s\n-------------------------------------\n",
-        gettext("Grand Total") );
-      fprintf ( fp, "%3d:%02d:%02d\n", h, m, s );
-      break;
-    case REPORT_OUTPUT_HTML:
-      fprintf ( fp, "<tr><th colspan=\"%d\">%s</th></tr>",
-        1 + ncols, gettext("Grand Total") );
-      fprintf ( fp, "<tr><td align=\"right\"><b>%d:%02d:%02d</b></td></tr>",
-        h, m, s );
-      fprintf ( fp, "</table><p><hr><font size=\"-1\">%s ",
-        gettext("Generated by") );
-      fprintf ( fp, "<a href=\"%s\">GTimer v%s (%s)</a>.\n",
-        GTIMER_URL, GTIMER_VERSION, GTIMER_VERSION_DATE );
-      fprintf ( fp, "</body></html>\n" );
-      break;
+  if ( format == REPORT_OUTPUT_HTML ) {
+    reportSinkFd ( &sink, fd );
+    reportWriteCached ( &sink, &options, seltasks, num_selected );
+  } else {
+    reportSinkText ( &drd->sink );
+    reportWriteCached ( &drd->sink, &options, seltasks, num_selected );
+    drd->text = reportSinkTextGet ( &drd->sink, &drd->len );
   }
 
 #if PV_DEBUG
   g_message("Report checkpoint (total printed)");
 #endif
 
-
-  len = ftell(fp);
-  rewind ( fp );
-  text = (char *) calloc ( len + 1, sizeof(char) );
-  fread ( text, len, sizeof(char), fp );
-  fclose ( fp );
   switch ( format ) {
     case REPORT_OUTPUT_TEXT:
-      display_text_results ( text );
+      display_text_results ( drd );
       break;
     case REPORT_OUTPUT_HTML:
-      display_html_results ( text );
+      if ( close ( fd ) != 0 && ! sink.error )
+        sink.error = errno;
+      if ( sink.error )
+        create_confirm_window ( CONFIRM_ERROR,
+          gettext("Error"),
+          gettext("Error writing temporary file"),
+          gettext("Ok"), NULL, NULL,
+          NULL, NULL, NULL,
+          NULL );
+      else
+        display_html_results ( tempfile );
       break;
   }
 #if PV_DEBUG
@@ -1629,11 +1104,8 @@ gpointer data;
 #endif
 
   /* Free resources */
-  for ( loop = 0; loop < num_selected; loop++ )
-    free ( seltasks[loop] );
   free ( seltasks );
   free ( rd->tasks );
-  free ( rd->list_items );
   free ( rd );
 #if PV_DEBUG
   g_message("Report end");
@@ -1650,7 +1122,6 @@ gpointer data;
   gtk_grab_remove ( rd->window );
   gtk_widget_destroy ( rd->window );
   free ( rd->tasks );
-  free ( rd->list_items );
   free ( rd );
 }
 
@@ -1689,6 +1160,49 @@ gpointer data;
 
 
 
+/*
+** Show the dates of the selected time range in the From and To
+** fields.  They can only be edited for a custom range.
+*/
+static void show_range ( rd, range )
+ReportData *rd;
+int range;
+{
+  int first_day, last_day, year, mon, mday;
+  char temp[20];
+
+  if ( range == REPORT_RANGE_CUSTOM ) {
+    gtk_widget_set_sensitive ( rd->from_entry, TRUE );
+    gtk_widget_set_sensitive ( rd->to_entry, TRUE );
+    return;
+  }
+
+  reportGetRange ( range, config_midnight_offset, &first_day, &last_day );
+  civilDate ( first_day, &year, &mon, &mday );
+  snprintf ( temp, sizeof ( temp ), "%04d-%02d-%02d", year, mon, mday );
+  gtk_entry_set_text ( GTK_ENTRY ( rd->from_entry ), temp );
+  civilDate ( last_day, &year, &mon, &mday );
+  snprintf ( temp, sizeof ( temp ), "%04d-%02d-%02d", year, mon, mday );
+  gtk_entry_set_text ( GTK_ENTRY ( rd->to_entry ), temp );
+  gtk_widget_set_sensitive ( rd->from_entry, FALSE );
+  gtk_widget_set_sensitive ( rd->to_entry, FALSE );
+}
+
+
+static void time_menu_callback ( widget, data )
+GtkWidget *widget;
+gpointer data;
+{
+  ReportData *rd = (ReportData *) data;
+  int loop;
+
+  for ( loop = 0; time_options[loop]; loop++ ) {
+    if ( widget == rd->time_menu_items[loop] )
+      show_range ( rd, loop );
+  }
+}
+
+
 static GtkWidget *create_time_menu ( rd )
 ReportData *rd;
 {
@@ -1700,6 +1214,8 @@ ReportData *rd;
   for ( loop = 0; time_options[loop]; loop++ ) {
     rd->time_menu_items[loop] =
       gtk_menu_item_new_with_label ( gettext(time_options[loop]) );
+    gtk_signal_connect ( GTK_OBJECT ( rd->time_menu_items[loop] ), "activate",
+      GTK_SIGNAL_FUNC ( time_menu_callback ), rd );
     gtk_menu_append ( GTK_MENU ( menu ), rd->time_menu_items[loop] );
     gtk_widget_show ( rd->time_menu_items[loop] );
   }
@@ -1779,7 +1295,6 @@ report_type type;
   GtkWidget *label, *button, *time_menu, *output_menu,
     *data_menu, *round_menu, *scrolled;
   ReportData *rd;
-  GList *items = NULL;
   int loop;
   char msg[100], temp[512];
   // PV:
@@ -1789,7 +1304,6 @@ report_type type;
   GtkTreeViewColumn *col;
 //  GtkTreePath *path;
   GtkTreeSelection *select;
-  gchar *xtaskname;
 
 #if PV_DEBUG
   g_message("Report window: start");
@@ -1819,7 +1333,7 @@ report_type type;
 #endif
 
 
-  table = gtk_table_new ( 4, 2, FALSE );
+  table = gtk_table_new ( 6, 2, FALSE );
   gtk_table_set_row_spacings (GTK_TABLE (table), 4);
   gtk_table_set_col_spacings (GTK_TABLE (table), 8);
   gtk_container_border_width (GTK_CONTAINER (table), 6);
@@ -1838,13 +1352,31 @@ report_type type;
   gtk_table_attach_defaults ( GTK_TABLE (table), rd->time_menu, 1, 2, 0, 1 );
   gtk_widget_show ( rd->time_menu );
 
+  label = gtk_label_new ( gettext("From: ") );
+  gtk_table_attach_defaults ( GTK_TABLE (table), label, 0, 1, 1, 2 );
+  gtk_widget_show ( label );
+
+  rd->from_entry = gtk_entry_new ();
+  gtk_table_attach_defaults ( GTK_TABLE (table), rd->from_entry, 1, 2, 1, 2 );
+  gtk_widget_show ( rd->from_entry );
+
+  label = gtk_label_new ( gettext("To: ") );
+  gtk_table_attach_defaults ( GTK_TABLE (table), label, 0, 1, 2, 3 );
+  gtk_widget_show ( label );
+
+  rd->to_entry = gtk_entry_new ();
+  gtk_table_attach_defaults ( GTK_TABLE (table), rd->to_entry, 1, 2, 2, 3 );
+  gtk_widget_show ( rd->to_entry );
+
+  show_range ( rd, REPORT_RANGE_THIS_MONTH );
+
 
 #if PV_DEBUG
   g_message("Report window: CP 2");
 #endif
 
   label = gtk_label_new ( gettext("Format: ") );
-  gtk_table_attach_defaults ( GTK_TABLE (table), label, 0, 1, 1, 2 );
+  gtk_table_attach_defaults ( GTK_TABLE (table), label, 0, 1, 3, 4 );
   gtk_widget_show ( label );
 
   rd->output_menu = gtk_option_menu_new ();
@@ -1852,11 +1384,11 @@ report_type type;
   gtk_option_menu_set_menu ( GTK_OPTION_MENU ( rd->output_menu ), output_menu );
   gtk_option_menu_set_history ( GTK_OPTION_MENU ( rd->output_menu ),
     REPORT_OUTPUT_TEXT );
-  gtk_table_attach_defaults ( GTK_TABLE (table), rd->output_menu, 1, 2, 1, 2 );
+  gtk_table_attach_defaults ( GTK_TABLE (table), rd->output_menu, 1, 2, 3, 4 );
   gtk_widget_show ( rd->output_menu );
 
   label = gtk_label_new ( gettext("Data: ") );
-  gtk_table_attach_defaults ( GTK_TABLE (table), label, 0, 1, 2, 3 );
+  gtk_table_attach_defaults ( GTK_TABLE (table), label, 0, 1, 4, 5 );
   gtk_widget_show ( label );
 
   rd->data_menu = gtk_option_menu_new ();
@@ -1864,11 +1396,11 @@ report_type type;
   gtk_option_menu_set_menu ( GTK_OPTION_MENU ( rd->data_menu ), data_menu );
   gtk_option_menu_set_history ( GTK_OPTION_MENU ( rd->data_menu ),
     REPORT_OUTPUT_TEXT );
-  gtk_table_attach_defaults ( GTK_TABLE (table), rd->data_menu, 1, 2, 2, 3 );
+  gtk_table_attach_defaults ( GTK_TABLE (table), rd->data_menu, 1, 2, 4, 5 );
   gtk_widget_show ( rd->data_menu );
 
   label = gtk_label_new ( gettext("Rounding: ") );
-  gtk_table_attach_defaults ( GTK_TABLE (table), label, 0, 1, 3, 4 );
+  gtk_table_attach_defaults ( GTK_TABLE (table), label, 0, 1, 5, 6 );
   gtk_widget_show ( label );
 
   rd->round_menu = gtk_option_menu_new ();
@@ -1876,7 +1408,7 @@ report_type type;
   gtk_option_menu_set_menu ( GTK_OPTION_MENU ( rd->round_menu ), round_menu );
   gtk_option_menu_set_history ( GTK_OPTION_MENU ( rd->round_menu ),
     REPORT_OUTPUT_TEXT );
-  gtk_table_attach_defaults ( GTK_TABLE (table), rd->round_menu, 1, 2, 3, 4 );
+  gtk_table_attach_defaults ( GTK_TABLE (table), rd->round_menu, 1, 2, 5, 6 );
   gtk_widget_show ( rd->round_menu );
 
   gtk_widget_show ( table );
@@ -1905,8 +1437,6 @@ report_type type;
 // PV: -  rd->task_list = gtk_list_new ();
   rd->tasks = (TaskData **) malloc ( sizeof ( TaskData * ) *
     num_visible_tasks );
-  rd->list_items = (GtkTreePath **) malloc ( sizeof ( GtkTreePath * ) *
-    num_visible_tasks );
   rd->num_tasks = num_visible_tasks;
 
   for ( loop = 0; loop < num_visible_tasks; loop++ ) {
@@ -1917,10 +1447,8 @@ report_type type;
       snprintf ( temp, sizeof ( temp ),
         "[%s] %s", visible_tasks[loop]->project_name,
         visible_tasks[loop]->task->name );
-    items = g_list_append ( items, rd->list_items[loop] );
     rd->tasks[loop] = visible_tasks[loop];
-    xtaskname = g_strdup_printf ("%s", temp);
-    rd->list_items[loop] = custom_list_append_record (customlist, xtaskname);
+    custom_list_append_record ( customlist, temp, loop );
   }
 
 
@@ -0,0 +1,1476 @@
+/*
+ * Report generation (independent of the user interface)
+ *
+ * Copyright:
+ *	(C) 1998-2023 Craig Knudsen, craig@k5n.us
+ *	See accompanying file "COPYING".
+ *
+ *	This program is free software; you can redistribute it and/or
+ *	modify it under the terms of the GNU General Public License
+ *	as published by the Free Software Foundation; either version 2
+ *	of the License, or (at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program; if not, write to the
+ *	Free Software Foundation, Inc., 59 Temple Place,
+ *	Suite 330, Boston, MA  02111-1307, USA
+ *
+ * Description:
+ *	Writes text and HTML reports.  This was split out of report.c
+ *	so that reports can be generated without a display (see the
+ *	--report command line option).
+ *
+ * History:
+ *	17-Oct-2026	Added reportSinkText().  reportWriteCached() shares
+ *			the text of such a sink instead of copying it.
+ *	16-Oct-2026	Step through the days of a report and find the ends
+ *			of weeks, months and years with the date arithmetic
+ *			in civil.c instead of localtime().  Yearly totals
+ *			now end on 31 December.
+ *	16-Oct-2026	Added reportWriteCached(), which remembers the last
+ *			few reports until the data they cover changes.
+ *	16-Oct-2026	Get unrounded weekly, monthly, yearly and total
+ *			figures from each task's running sums rather than
+ *			adding up every day.
+ *	16-Oct-2026	Fill in the report matrix with several threads.
+ *	16-Oct-2026	Collect pointers to annotations for each period and
+ *			format them as they are written rather than
+ *			appending them to a string one at a time.
+ *	16-Oct-2026	Write reports to a ReportSink so they can be streamed
+ *			to a file, a pipe or a text widget.
+ *	16-Oct-2026	Created from the report code in report.c.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+#if HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#include <errno.h>
+#if HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+#include "project.h"
+#include "task.h"
+#include "gtimer.h"
+#include "reportgen.h"
+#include "civil.h"
+
+#ifdef GTIMER_MEMDEBUG
+#include "memdebug/memdebug.h"
+#endif
+
+/* CSS stylesheet */
+#define CSS_STYLE "\
+<style>\n\
+body {\n\
+  background: #ffffff;\n\
+}\n\
+th {\n\
+  background: #c0c0c0;\n\
+}\n\
+td {\n\
+  background: #ffffff;\n\
+}\n\
+</style>\n"
+
+/* Reports kept by reportWriteCached() and the largest one kept */
+#define REPORT_CACHE_SIZE	4
+#define REPORT_CACHE_MAX_TEXT	(1024*1024)
+
+/*
+** The annotations for a task in the period being summarized.  Only
+** pointers to the task's annotations are kept; the text is formatted
+** when the period is written out.
+*/
+typedef struct {
+  TaskAnnotation **anns;
+  int num_anns;
+  int max_anns;
+} AnnotationList;
+
+typedef struct {
+  Task *task;
+  char *project_name;		/* name of parent project */
+  time_t period_total;		/* time for the period being summarized */
+  AnnotationList todays_annotations;
+  AnnotationList weekly_annotations;
+  AnnotationList monthly_annotations;
+  AnnotationList yearly_annotations;
+  AnnotationList total_annotations;
+  char week_start[20];
+} ReportTaskData;
+
+/*
+** Write formatted output to a report sink.  Most output is short, so
+** it is formatted into a buffer on the stack; longer output (usually
+** annotations) is formatted into an allocated buffer of the right size.
+*/
+static void report_printf ( ReportSink *sink, const char *fmt, ... )
+{
+  char buf[1024], *text = buf;
+  va_list ap;
+  int len;
+
+  if ( sink->error )
+    return;
+
+  va_start ( ap, fmt );
+  len = vsnprintf ( buf, sizeof ( buf ), fmt, ap );
+  va_end ( ap );
+  if ( len < 0 ) {
+    sink->error = EINVAL;
+    return;
+  }
+  if ( len >= sizeof ( buf ) ) {
+    text = (char *) malloc ( len + 1 );
+    va_start ( ap, fmt );
+    vsnprintf ( text, len + 1, fmt, ap );
+    va_end ( ap );
+  }
+
+  errno = 0;
+  if ( sink->write ( sink, text, len ) )
+    sink->error = errno ? errno : EIO;
+
+  if ( text != buf )
+    free ( text );
+}
+
+
+static int file_sink_write ( sink, text, len )
+ReportSink *sink;
+const char *text;
+int len;
+{
+  return ( fwrite ( text, 1, len, (FILE *) sink->data ) == len ? 0 : -1 );
+}
+
+
+static int fd_sink_write ( sink, text, len )
+ReportSink *sink;
+const char *text;
+int len;
+{
+  int ret;
+
+  while ( len > 0 ) {
+    ret = write ( sink->fd, text, len );
+    if ( ret < 0 ) {
+      if ( errno == EINTR )
+        continue;
+      return ( -1 );
+    }
+    text += ret;
+    len -= ret;
+  }
+  return ( 0 );
+}
+
+
+/*
+** Set up a sink that writes to a stdio stream (a file, stdout or a
+** pipe from popen()).
+*/
+void reportSinkFile ( sink, fp )
+ReportSink *sink;
+FILE *fp;
+{
+  memset ( sink, '\0', sizeof ( ReportSink ) );
+  sink->write = file_sink_write;
+  sink->data = fp;
+  sink->fd = -1;
+}
+
+
+/*
+** Set up a sink that writes directly to a file descriptor.
+*/
+void reportSinkFd ( sink, fd )
+ReportSink *sink;
+int fd;
+{
+  memset ( sink, '\0', sizeof ( ReportSink ) );
+  sink->write = fd_sink_write;
+  sink->fd = fd;
+}
+
+
+/*
+** Text collected by a sink set up with reportSinkText().  The report
+** cache may share it with the sink rather than keep its own copy, so
+** it is copied before being changed if anything else is using it.
+*/
+typedef struct {
+  char *text;			/* the report (not nul-terminated) */
+  int len;
+  int max;
+  int refs;			/* sinks and cache entries using it */
+} ReportText;
+
+
+static ReportText *report_text_new ()
+{
+  ReportText *rt;
+
+  rt = (ReportText *) malloc ( sizeof ( ReportText ) );
+  memset ( rt, '\0', sizeof ( ReportText ) );
+  rt->refs = 1;
+  return ( rt );
+}
+
+
+static void report_text_release ( rt )
+ReportText *rt;
+{
+  if ( --rt->refs > 0 )
+    return;
+  if ( rt->text )
+    free ( rt->text );
+  free ( rt );
+}
+
+
+static int text_sink_write ( sink, text, len )
+ReportSink *sink;
+const char *text;
+int len;
+{
+  ReportText *rt = (ReportText *) sink->data, *copy;
+
+  if ( rt->refs > 1 ) {
+    copy = report_text_new ();
+    copy->max = rt->len + len;
+    copy->text = (char *) malloc ( copy->max );
+    memcpy ( copy->text, rt->text, rt->len );
+    copy->len = rt->len;
+    report_text_release ( rt );
+    sink->data = rt = copy;
+  }
+  if ( rt->len + len > rt->max ) {
+    rt->max = rt->max ? rt->max * 2 : 4096;
+    while ( rt->max < rt->len + len )
+      rt->max *= 2;
+    rt->text = (char *) realloc ( rt->text, rt->max );
+  }
+  memcpy ( rt->text + rt->len, text, len );
+  rt->len += len;
+  return ( 0 );
+}
+
+
+/*
+** Set up a sink that keeps the report in memory.  Get the text with
+** reportSinkTextGet() and free it with reportSinkTextFree().
+*/
+void reportSinkText ( sink )
+ReportSink *sink;
+{
+  memset ( sink, '\0', sizeof ( ReportSink ) );
+  sink->write = text_sink_write;
+  sink->data = report_text_new ();
+  sink->fd = -1;
+}
+
+
+/*
+** Get the text written to a sink set up with reportSinkText().  It is
+** not nul-terminated and is valid until the sink is written to again
+** or freed.
+*/
+const char *reportSinkTextGet ( sink, len )
+ReportSink *sink;
+int *len;
+{
+  ReportText *rt = (ReportText *) sink->data;
+
+  *len = rt->len;
+  return ( rt->text );
+}
+
+
+void reportSinkTextFree ( sink )
+ReportSink *sink;
+{
+  if ( sink->data )
+    report_text_release ( (ReportText *) sink->data );
+  sink->data = NULL;
+}
+
+
+
+/*
+** The time of each selected task for each day of the report, gathered
+** before anything is formatted.  Each task has a row of num_days values
+** so the total for a week, month or year is the sum of a run of days.
+** When no rounding is done and no daily figures are printed, the rows
+** are left empty and period totals are read from the task's running
+** sums with taskSumRange() instead, so a period costs the same however
+** many days it has.
+*/
+typedef struct {
+  int num_tasks;
+  int num_days;
+  int *seconds;		/* time for each task (row) and day (column) */
+  int *rounded;		/* seconds rounded to the report's increment */
+  int *dates;		/* TASK_DATE() of each day */
+  int use_sums;		/* period totals from taskSumRange() */
+  int period_start;	/* first day of the period being summarized */
+} ReportMatrix;
+
+/*
+** Reports with fewer cells than this in their matrix are filled in by
+** the calling thread alone; starting threads would cost more than
+** they save.
+*/
+#define MATRIX_MIN_PARALLEL	20000
+
+/*
+** The rows of a ReportMatrix still to be filled in.  Each row belongs
+** to one task and is written by one thread only.
+*/
+typedef struct {
+  ReportTaskData **seltasks;
+  ReportMatrix *matrix;
+  int round_incr;
+#if HAVE_PTHREAD
+  pthread_mutex_t lock;		/* protects next */
+#endif
+  int next;			/* next row to fill in */
+} MatrixQueue;
+
+
+
+
+/*
+** Add an annotation to a list.  The list grows by doubling so adding
+** n annotations takes O(n) time in total.
+*/
+static void add_annotation ( list, annotation )
+AnnotationList *list;
+TaskAnnotation *annotation;
+{
+  if ( list->num_anns == list->max_anns ) {
+    list->max_anns = list->max_anns ? list->max_anns * 2 : 16;
+    list->anns = (TaskAnnotation **) realloc ( list->anns,
+      list->max_anns * sizeof ( TaskAnnotation * ) );
+  }
+  list->anns[list->num_anns++] = annotation;
+}
+
+
+/*
+** Write one annotation, optionally including the date and time and
+** indenting all lines to make it look nice.  Blank lines in the
+** annotation are skipped.
+*/
+static void write_annotation ( sink, annotation, include_date,
+  include_time, indentation, newline )
+ReportSink *sink;
+TaskAnnotation *annotation;
+int include_date, include_time;
+char *indentation;
+char *newline;
+{
+  struct tm *tm;
+  char date_time_str[30];
+  char padding[30], *p, *eol;
+  int first;
+
+  strcpy ( date_time_str, indentation );
+  if ( include_date || include_time )
+    tm = localtime ( &annotation->text_time );
+  if ( include_date )
+    sprintf ( date_time_str + strlen ( date_time_str ),
+      "%02d/%02d/%02d ", tm->tm_mon + 1,
+      tm->tm_mday, tm->tm_year % 100 );
+
+  if ( include_time )
+    sprintf ( date_time_str + strlen ( date_time_str ),
+      "%02d:%02d ", tm->tm_hour, tm->tm_min );
+
+  strcpy ( padding, date_time_str );
+  for ( p = padding; *p != '\0'; p++ )
+    *p = ' ';
+
+  first = 1;
+  for ( p = annotation->text; *p != '\0'; p = eol ) {
+    eol = strchr ( p, '\n' );
+    if ( ! eol )
+      eol = p + strlen ( p );
+    if ( eol > p ) {
+      report_printf ( sink, "%s%.*s%s", first ? date_time_str : padding,
+        (int) ( eol - p ), p, newline );
+      first = 0;
+    }
+    if ( *eol == '\n' )
+      eol++;
+  }
+}
+
+
+/*
+** Write all the annotations in a list (in a table cell for HTML) and
+** empty the list for the next period.
+*/
+static void write_annotations ( sink, list, format, indentation, newline )
+ReportSink *sink;
+AnnotationList *list;
+int format;
+char *indentation;
+char *newline;
+{
+  int loop;
+
+  if ( ! list->num_anns )
+    return;
+
+  if ( format == REPORT_OUTPUT_HTML )
+    report_printf ( sink, "<td>" );
+  for ( loop = 0; loop < list->num_anns; loop++ )
+    write_annotation ( sink, list->anns[loop], 0, 0, indentation, newline );
+  if ( format == REPORT_OUTPUT_HTML )
+    report_printf ( sink, "</td>" );
+
+  list->num_anns = 0;
+}
+
+
+static void free_annotations ( list )
+AnnotationList *list;
+{
+  if ( list->anns )
+    free ( list->anns );
+  memset ( list, '\0', sizeof ( AnnotationList ) );
+}
+
+
+
+static time_t do_round ( time_in, round_incr )
+time_t time_in;
+int round_incr;
+{
+  int t, n, r;
+
+  if ( round_incr == 0 )
+    return ( time_in );
+
+  t = (int) time_in;
+  r = t % round_incr;
+  t -= r;
+  if ( r > ( round_incr / 2 ) )
+    t += round_incr;
+
+  return ( (time_t) t );
+}
+
+
+
+/*
+** Fill in the matrix rows of each task in a MatrixQueue until there are
+** no more rows.  Each task's entries for the range are walked once
+** alongside the days.  Only the task's time entries are read, so any
+** number of threads can do this at once.
+*/
+static void *matrix_worker ( arg )
+void *arg;
+{
+  MatrixQueue *queue = (MatrixQueue *) arg;
+  ReportMatrix *matrix = queue->matrix;
+  TaskTimeEntry **entries;
+  int *row, *rounded;
+  int loop, day, num, n;
+
+  for ( ;; ) {
+#if HAVE_PTHREAD
+    pthread_mutex_lock ( &queue->lock );
+#endif
+    loop = queue->next++;
+#if HAVE_PTHREAD
+    pthread_mutex_unlock ( &queue->lock );
+#endif
+    if ( loop >= matrix->num_tasks )
+      break;
+
+    num = taskGetTimeEntryRange ( queue->seltasks[loop]->task,
+      matrix->dates[0], matrix->dates[matrix->num_days - 1], &entries );
+    row = matrix->seconds + loop * matrix->num_days;
+    rounded = matrix->rounded + loop * matrix->num_days;
+    for ( day = 0, n = 0; day < matrix->num_days && n < num; day++ ) {
+      while ( n < num && entries[n]->date < matrix->dates[day] )
+        n++;
+      if ( n < num && entries[n]->date == matrix->dates[day] )
+        row[day] = entries[n]->seconds;
+    }
+    for ( day = 0; day < matrix->num_days; day++ )
+      rounded[day] = (int) do_round ( row[day], queue->round_incr );
+  }
+
+  return ( NULL );
+}
+
+
+/*
+** Gather the time of each selected task for each day of the report.
+** Each task's row is independent of the others, so with num_threads
+** greater than one the rows are shared out among that many threads.
+** The result is the same however many threads are used.  If use_sums
+** is set, only the dates are filled in (see ReportMatrix).
+*/
+static ReportMatrix *build_matrix ( seltasks, num_seltasks, first_day,
+  last_day, include_hours, round_incr, use_sums, num_threads )
+ReportTaskData **seltasks;
+int num_seltasks;
+int first_day, last_day;
+int include_hours;
+int round_incr;
+int use_sums;
+int num_threads;
+{
+  ReportMatrix *matrix;
+  MatrixQueue queue;
+  int day, size, year, mon, mday;
+#if HAVE_PTHREAD
+  pthread_t *threads;
+  int loop;
+#endif
+
+  matrix = (ReportMatrix *) malloc ( sizeof ( ReportMatrix ) );
+  memset ( matrix, '\0', sizeof ( ReportMatrix ) );
+  matrix->num_tasks = num_seltasks;
+  if ( last_day >= first_day )
+    matrix->num_days = last_day - first_day + 1;
+  size = matrix->num_tasks * matrix->num_days;
+  matrix->seconds = (int *) malloc ( ( size + 1 ) * sizeof ( int ) );
+  matrix->rounded = (int *) malloc ( ( size + 1 ) * sizeof ( int ) );
+  memset ( matrix->seconds, '\0', ( size + 1 ) * sizeof ( int ) );
+  if ( ! include_hours || ! matrix->num_days ) {
+    memset ( matrix->rounded, '\0', ( size + 1 ) * sizeof ( int ) );
+    return ( matrix );
+  }
+
+  matrix->dates = (int *) malloc ( matrix->num_days * sizeof ( int ) );
+  for ( day = 0; day < matrix->num_days; day++ ) {
+    civilDate ( first_day + day, &year, &mon, &mday );
+    matrix->dates[day] = TASK_DATE ( year, mon, mday );
+  }
+  if ( use_sums ) {
+    memset ( matrix->rounded, '\0', ( size + 1 ) * sizeof ( int ) );
+    matrix->use_sums = 1;
+    return ( matrix );
+  }
+
+  memset ( &queue, '\0', sizeof ( queue ) );
+  queue.seltasks = seltasks;
+  queue.matrix = matrix;
+  queue.round_incr = round_incr;
+
+#if HAVE_PTHREAD
+  if ( num_threads > num_seltasks )
+    num_threads = num_seltasks;
+  if ( size < MATRIX_MIN_PARALLEL )
+    num_threads = 1;
+  if ( num_threads > 1 ) {
+    threads = (pthread_t *) malloc ( num_threads * sizeof ( pthread_t ) );
+    pthread_mutex_init ( &queue.lock, NULL );
+    /* the calling thread does its share of the work too */
+    for ( loop = 1; loop < num_threads; loop++ ) {
+      if ( pthread_create ( &threads[loop], NULL, matrix_worker, &queue ) )
+        break;
+    }
+    num_threads = loop;
+    matrix_worker ( &queue );
+    for ( loop = 1; loop < num_threads; loop++ )
+      pthread_join ( threads[loop], NULL );
+    pthread_mutex_destroy ( &queue.lock );
+    free ( threads );
+  } else {
+    matrix_worker ( &queue );
+  }
+#else
+  matrix_worker ( &queue );
+#endif
+
+  return ( matrix );
+}
+
+
+static void free_matrix ( matrix )
+ReportMatrix *matrix;
+{
+  free ( matrix->seconds );
+  free ( matrix->rounded );
+  if ( matrix->dates )
+    free ( matrix->dates );
+  free ( matrix );
+}
+
+
+/*
+** Set the period_total of each selected task to the sum of its time
+** from the start of the current period up to and including last_day,
+** and start the next period on the following day.
+** Returns the total of all tasks for the period.
+*/
+static time_t rollup_period ( matrix, seltasks, num_seltasks, last_day )
+ReportMatrix *matrix;
+ReportTaskData **seltasks;
+int num_seltasks;
+int last_day;
+{
+  int loop, day, *row;
+  time_t total, ret = 0;
+
+  for ( loop = 0; loop < num_seltasks; loop++ ) {
+    if ( matrix->use_sums ) {
+      total = taskSumRange ( seltasks[loop]->task,
+        matrix->dates[matrix->period_start], matrix->dates[last_day] );
+    } else {
+      row = matrix->rounded + loop * matrix->num_days;
+      total = 0;
+      for ( day = matrix->period_start; day <= last_day; day++ )
+        total += row[day];
+    }
+    seltasks[loop]->period_total = total;
+    ret += total;
+  }
+  matrix->period_start = last_day + 1;
+
+  return ( ret );
+}
+
+
+
+/*
+** Write the report output for one day, including the totals for a
+** week, month or year if this day ends one.
+** Returns the total time of all tasks for the day (daily reports) or
+** for the week, month, year or whole report that ends on this day.
+*/
+static time_t summarize_day ( sink, seltasks, num_seltasks, matrix, day, days,
+  options, is_last )
+ReportSink *sink;
+ReportTaskData **seltasks;
+int num_seltasks;
+ReportMatrix *matrix;
+int day;			/* column in matrix */
+int days;			/* civilDays() of the day */
+ReportOptions *options;
+int is_last;
+{
+  report_type type = options->type;
+  int format = options->format;
+  int include_hours = options->include_hours;
+  int include_annotations = options->include_annotations;
+  struct tm tm;
+  int found = 0;
+  int loop, loop2;
+  int mon, mday, year, wday;
+  TaskAnnotation **anns;
+  int num_anns = 0;
+  int h, m, s, seconds, rounded;
+  time_t ret = 0;
+  char indentation[30];
+  int ncols = 0;
+  char *newline = "\n";
+  char daystring[20];
+
+  switch ( format ) {
+    case REPORT_OUTPUT_TEXT:
+      newline = "\n";
+      break;
+    case REPORT_OUTPUT_HTML:
+      newline = "<br>\n";
+      break;
+  }
+
+  if ( include_hours )
+    ncols++;
+  if ( include_annotations )
+    ncols++;
+
+  civilDate ( days, &year, &mon, &mday );
+  wday = civilWeekday ( days );
+
+  if ( include_hours )
+    strcpy ( indentation, "            " );
+  else
+    strcpy ( indentation, "  " );
+
+  civilToTm ( days, &tm );
+  strftime ( daystring, sizeof(daystring), "%x %a", &tm );
+
+  for ( loop = 0; loop < num_seltasks; loop++ ) {
+    if ( ( seltasks[loop]->week_start[0] == '\0' ) ||
+      ( wday == options->start_of_week ) )
+      strcpy ( seltasks[loop]->week_start, daystring );
+    seconds = matrix->seconds[loop * matrix->num_days + day];
+    rounded = matrix->rounded[loop * matrix->num_days + day];
+    if ( include_annotations ) {
+      anns = TaskGetAnnotationEntries ( seltasks[loop]->task,
+        year, mon, mday, options->midnight_offset, &num_anns );
+      for ( loop2 = 0; loop2 < num_anns; loop2++ ) {
+        if ( type == REPORT_TYPE_DAILY )
+          add_annotation ( &seltasks[loop]->todays_annotations,
+            anns[loop2] );
+        else if ( type == REPORT_TYPE_WEEKLY )
+          add_annotation ( &seltasks[loop]->weekly_annotations,
+            anns[loop2] );
+        else if ( type == REPORT_TYPE_MONTHLY )
+          add_annotation ( &seltasks[loop]->monthly_annotations,
+            anns[loop2] );
+        else if ( type == REPORT_TYPE_YEARLY )
+          add_annotation ( &seltasks[loop]->yearly_annotations,
+            anns[loop2] );
+        else if ( type == REPORT_TYPE_TOTAL )
+          add_annotation ( &seltasks[loop]->total_annotations,
+            anns[loop2] );
+      }
+    }
+    if ( seconds || seltasks[loop]->todays_annotations.num_anns ) {
+      h = rounded / 3600;
+      m = ( rounded - h * 3600 ) / 60;
+      s = rounded % 60;
+      if ( type == REPORT_TYPE_DAILY ) {
+        if ( ! found ) {
+          switch ( format ) {
+            case REPORT_OUTPUT_TEXT:
+              report_printf ( sink, "\n%s\n", daystring );
+              report_printf ( sink,
+                "-------------------------------------\n" );
+              break;
+            case REPORT_OUTPUT_HTML:
+              report_printf ( sink, "<tr><th colspan=\"%d\">",
+                ncols + 1 );
+              report_printf ( sink, "\n%s\n", daystring );
+              report_printf ( sink, "</th></tr>\n" );
+              break;
+          }
+          found = 1;
+        }
+        if ( format == REPORT_OUTPUT_HTML )
+          report_printf ( sink, "<tr>" );
+        if ( include_hours ) {
+          switch ( format ) {
+            case REPORT_OUTPUT_TEXT:
+              report_printf ( sink, "%3d:%02d:%02d - [%s] %s\n", h, m, s,
+                seltasks[loop]->task->project_id < 0 ?
+                "none" : seltasks[loop]->project_name,
+                seltasks[loop]->task->name );
+              break;
+            case REPORT_OUTPUT_HTML:
+              report_printf ( sink,
+                "<td align=\"right\" valign=\"top\">%d:%02d:%02d</td>",
+                h, m, s );
+              report_printf ( sink, "<td valign=\"top\">[%s] %s</td>",
+                seltasks[loop]->task->project_id < 0 ?
+                "none" : seltasks[loop]->project_name,
+                seltasks[loop]->task->name );
+              break;
+          }
+        } else {
+          switch ( format ) {
+            case REPORT_OUTPUT_TEXT:
+              report_printf ( sink, "[%s] %s\n",
+                seltasks[loop]->task->project_id < 0 ?
+                "none" : seltasks[loop]->project_name,
+                seltasks[loop]->task->name );
+              break;
+            case REPORT_OUTPUT_HTML:
+              report_printf ( sink, "<td valign=\"top\">[%s] %s</td>",
+                seltasks[loop]->task->project_id < 0 ?
+                "none" : seltasks[loop]->project_name,
+                seltasks[loop]->task->name );
+              break;
+          }
+        }
+      }
+      if ( type == REPORT_TYPE_DAILY )
+        ret += rounded;
+      write_annotations ( sink, &seltasks[loop]->todays_annotations,
+        format, indentation, newline );
+      if ( type == REPORT_TYPE_DAILY && format == REPORT_OUTPUT_HTML )
+        report_printf ( sink, "</tr>\n" );
+    }
+  }
+
+  if ( type == REPORT_TYPE_DAILY && ret ) {
+    h = ret / 3600;
+    m = ( ret - h * 3600 ) / 60;
+    s = ret % 60;
+    switch ( format ) {
+      case REPORT_OUTPUT_TEXT:
+        report_printf ( sink, "---------\n" );
+        report_printf ( sink, "%3d:%02d:%02d - %s\n", h, m, s,
+          gettext("Total") );
+        break;
+      case REPORT_OUTPUT_HTML:
+        report_printf ( sink,
+          "<tr><td align=\"right\"><b>%d:%02d:%02d</b></td>",
+          h, m, s );
+        report_printf ( sink, "<td><b>%s</b></td></tr>\n", gettext("Total") );
+        break;
+    }
+  }
+
+  if ( ( type == REPORT_TYPE_WEEKLY ) &&
+    ( civilIsLastDayOfWeek ( days, options->start_of_week ) || is_last ) ) {
+    ret += rollup_period ( matrix, seltasks, num_seltasks, day );
+    found = 0;
+    for ( loop = 0; loop < num_seltasks; loop++ ) {
+      if ( seltasks[loop]->period_total ||
+        seltasks[loop]->weekly_annotations.num_anns ) {
+        if ( ! found ) {
+          switch ( format ) {
+            case REPORT_OUTPUT_TEXT:
+              report_printf ( sink, "\n%s %s %s %s\n", gettext("Week"),
+                seltasks[loop]->week_start, gettext("to"), daystring );
+              report_printf ( sink,
+                "-------------------------------------\n" );
+              break;
+            case REPORT_OUTPUT_HTML:
+              report_printf ( sink, "<tr><th colspan=\"%d\">", ncols + 1 );
+              report_printf ( sink, "%s %s %s %s", gettext("Week"),
+                seltasks[loop]->week_start, gettext("to"), daystring );
+              report_printf ( sink, "</th></tr>\n" );
+              break;
+          }
+          found = 1;
+        }
+        if ( include_hours ) {
+          h = seltasks[loop]->period_total / 3600;
+          m = ( seltasks[loop]->period_total - h * 3600 ) / 60;
+          s = seltasks[loop]->period_total % 60;
+          switch ( format ) {
+            case REPORT_OUTPUT_TEXT:
+              report_printf ( sink, "%3d:%02d:%02d - [%s] %s\n", h, m, s,
+                seltasks[loop]->task->project_id < 0 ?
+                "none" : seltasks[loop]->project_name,
+                seltasks[loop]->task->name );
+              break;
+            case REPORT_OUTPUT_HTML:
+              report_printf ( sink,
+                "<tr><td valign=\"top\" align=\"right\">%d:%02d:%02d</td>",
+                h, m, s );
+              report_printf ( sink, "<td valign=\"top\">[%s] %s</td>",
+                seltasks[loop]->task->project_id < 0 ?
+                "none" : seltasks[loop]->project_name,
+                seltasks[loop]->task->name );
+              break;
+          }
+        } else {
+          switch ( format ) {
+            case REPORT_OUTPUT_TEXT:
+              report_printf ( sink, "[%s] %s\n",
+                seltasks[loop]->task->project_id < 0 ?
+                "none" : seltasks[loop]->project_name,
+                seltasks[loop]->task->name );
+              break;
+            case REPORT_OUTPUT_HTML:
+              report_printf ( sink, "<td valign=\"top\">[%s] %s</td>",
+                seltasks[loop]->task->project_id < 0 ?
+                "none" : seltasks[loop]->project_name,
+                seltasks[loop]->task->name );
+              break;
+          }
+        }
+        write_annotations ( sink, &seltasks[loop]->weekly_annotations,
+          format, indentation, newline );
+        if ( format == REPORT_OUTPUT_HTML )
+          report_printf ( sink, "</tr>\n" );
+      }
+    }
+  }
+
+  if ( ( type == REPORT_TYPE_MONTHLY ) &&
+    ( is_last || civilIsLastDayOfMonth ( days ) ) ) {
+    ret += rollup_period ( matrix, seltasks, num_seltasks, day );
+    found = 0;
+    for ( loop = 0; loop < num_seltasks; loop++ ) {
+      if ( seltasks[loop]->period_total ||
+        seltasks[loop]->monthly_annotations.num_anns ) {
+        if ( ! found ) {
+          switch ( format ) {
+            case REPORT_OUTPUT_TEXT:
+              report_printf ( sink, "\n%s %02d/%d\n", gettext("Month"),
+                mon, year );
+              report_printf ( sink,
+                "-------------------------------------\n" );
+              break;
+            case REPORT_OUTPUT_HTML:
+              report_printf ( sink,
+                "<tr><th colspan=\"%d\">%s %02d/%d</th></tr>",
+                ncols + 1, gettext("Month"), mon, year );
+              break;
+          }
+          found = 1;
+        }
+        if ( include_hours ) {
+          h = seltasks[loop]->period_total / 3600;
+          m = ( seltasks[loop]->period_total - h * 3600 ) / 60;
+          s = seltasks[loop]->period_total % 60;
+          switch ( format ) {
+            case REPORT_OUTPUT_TEXT:
+              report_printf ( sink, "%3d:%02d:%02d - [%s] %s\n", h, m, s,
+                seltasks[loop]->task->project_id < 0 ?
+                "none" : seltasks[loop]->project_name,
+                seltasks[loop]->task->name );
+              break;
+            case REPORT_OUTPUT_HTML:
+              report_printf ( sink, "<td valign=\"top\">%d:%02d:%02d</td>",
+                h, m, s );
+              report_printf ( sink, "<td valign=\"top\">[%s] %s</td>",
+                seltasks[loop]->task->project_id < 0 ?
+                "none" : seltasks[loop]->project_name,
+                seltasks[loop]->task->name );
+              break;
+          }
+        }
+        else {
+          switch ( format ) {
+            case REPORT_OUTPUT_TEXT:
+              report_printf ( sink, "[%s] %s\n",
+                seltasks[loop]->task->project_id < 0 ?
+                "none" : seltasks[loop]->project_name,
+                seltasks[loop]->task->name );
+              break;
+            case REPORT_OUTPUT_HTML:
+              report_printf ( sink, "<td valign=\"top\">[%s] %s</td>",
+                seltasks[loop]->task->project_id < 0 ?
+                "none" : seltasks[loop]->project_name,
+                seltasks[loop]->task->name );
+              break;
+          }
+        }
+        write_annotations ( sink, &seltasks[loop]->monthly_annotations,
+          format, indentation, newline );
+        if ( format == REPORT_OUTPUT_HTML )
+          report_printf ( sink, "</tr>\n" );
+      }
+    }
+  }
+
+  if ( ( type == REPORT_TYPE_YEARLY ) &&
+    ( is_last || civilIsLastDayOfYear ( days ) ) ) {
+    ret += rollup_period ( matrix, seltasks, num_seltasks, day );
+    found = 0;
+    for ( loop = 0; loop < num_seltasks; loop++ ) {
+      if ( seltasks[loop]->period_total ||
+        seltasks[loop]->yearly_annotations.num_anns ) {
+        if ( ! found ) {
+          switch ( format ) {
+            case REPORT_OUTPUT_TEXT:
+              report_printf ( sink, "\n%s %d\n", gettext("Year"), year );
+              report_printf ( sink,
+                "-------------------------------------\n" );
+              break;
+            case REPORT_OUTPUT_HTML:
+              report_printf ( sink, "<tr><th colspan=\"%d\">%s %d</th></tr>\n",
+                ncols + 1, gettext("Year"), year );
+              break;
+          }
+          found = 1;
+        }
+        if ( include_hours ) {
+          h = seltasks[loop]->period_total / 3600;
+          m = ( seltasks[loop]->period_total - h * 3600 ) / 60;
+          s = seltasks[loop]->period_total % 60;
+          switch ( format ) {
+            case REPORT_OUTPUT_TEXT:
+              report_printf ( sink, "%3d:%02d:%02d - [%s] %s\n", h, m, s,
+                seltasks[loop]->task->project_id < 0 ?
+                "none" : seltasks[loop]->project_name,
+                seltasks[loop]->task->name );
+              break;
+            case REPORT_OUTPUT_HTML:
+              report_printf ( sink, "<td valign=\"top\">%d:%02d:%02d</td>",
+                h, m, s );
+              report_printf ( sink, "<td valign=\"top\">[%s] %s</td>",
+                seltasks[loop]->task->project_id < 0 ?
+                "none" : seltasks[loop]->project_name,
+                seltasks[loop]->task->name );
+              break;
+          }
+        }
+        else {
+          switch ( format ) {
+            case REPORT_OUTPUT_TEXT:
+              report_printf ( sink, "[%s] %s\n",
+                seltasks[loop]->task->project_id < 0 ?
+                "none" : seltasks[loop]->project_name,
+                seltasks[loop]->task->name );
+              break;
+            case REPORT_OUTPUT_HTML:
+              report_printf ( sink, "<td valign=\"top\">[%s] %s</td>",
+                seltasks[loop]->task->project_id < 0 ?
+                "none" : seltasks[loop]->project_name,
+                seltasks[loop]->task->name );
+              break;
+          }
+        }
+        write_annotations ( sink, &seltasks[loop]->yearly_annotations,
+          format, indentation, newline );
+        if ( format == REPORT_OUTPUT_HTML )
+          report_printf ( sink, "</tr>\n" );
+      }
+    }
+  }
+
+  if ( ( type == REPORT_TYPE_TOTAL ) && is_last ) {
+    ret += rollup_period ( matrix, seltasks, num_seltasks, day );
+    found = 0;
+    for ( loop = 0; loop < num_seltasks; loop++ ) {
+      if ( seltasks[loop]->period_total ) {
+        if ( ! found ) {
+          switch ( format ) {
+            case REPORT_OUTPUT_TEXT:
+              report_printf ( sink, "\n%s\n", gettext("Totals") );
+              report_printf ( sink,
+                "-------------------------------------\n" );
+              break;
+            case REPORT_OUTPUT_HTML:
+              report_printf ( sink, "<tr><th COLSPAN=\"%d\">%s</th></tr>\n",
+                ncols + 1, gettext("Totals") );
+              break;
+          }
+          found = 1;
+        }
+        if ( include_hours ) {
+          h = seltasks[loop]->period_total / 3600;
+          m = ( seltasks[loop]->period_total - h * 3600 ) / 60;
+          s = seltasks[loop]->period_total % 60;
+          switch ( format ) {
+            case REPORT_OUTPUT_TEXT:
+              report_printf ( sink, "%3d:%02d:%02d - [%s] %s\n", h, m, s,
+                seltasks[loop]->task->project_id < 0 ?
+                "none" : seltasks[loop]->project_name,
+                seltasks[loop]->task->name );
+              break;
+            case REPORT_OUTPUT_HTML:
+              report_printf ( sink, "<td valign=\"top\">%d:%02d:%02d</td>",
+                h, m, s );
+              report_printf ( sink, "<td valign=\"top\">[%s] %s</td>",
+                seltasks[loop]->task->project_id < 0 ?
+                "none" : seltasks[loop]->project_name,
+                seltasks[loop]->task->name );
+              break;
+          }
+        }
+        else {
+          switch ( format ) {
+            case REPORT_OUTPUT_TEXT:
+              report_printf ( sink, "[%s] %s\n",
+                seltasks[loop]->task->project_id < 0 ?
+                "none" : seltasks[loop]->project_name,
+                seltasks[loop]->task->name );
+              break;
+            case REPORT_OUTPUT_HTML:
+              report_printf ( sink, "<td valign=\"top\">[%s] %s</td>",
+                seltasks[loop]->task->project_id < 0 ?
+                "none" : seltasks[loop]->project_name,
+                seltasks[loop]->task->name );
+              break;
+          }
+        }
+        write_annotations ( sink, &seltasks[loop]->total_annotations,
+          format, indentation, newline );
+        if ( format == REPORT_OUTPUT_HTML )
+          report_printf ( sink, "</tr>\n" );
+      }
+    }
+  }
+
+  if ( is_last ) {
+    for ( loop = 0; loop < num_seltasks; loop++ ) {
+      free_annotations ( &seltasks[loop]->todays_annotations );
+      free_annotations ( &seltasks[loop]->weekly_annotations );
+      free_annotations ( &seltasks[loop]->monthly_annotations );
+      free_annotations ( &seltasks[loop]->yearly_annotations );
+      free_annotations ( &seltasks[loop]->total_annotations );
+    }
+  }
+
+  return ( ret );
+}
+
+
+
+
+/*
+** Write a report on the specified tasks to a sink.  Output is passed
+** to the sink as it is generated rather than being built up in memory.
+** Returns the total time of all tasks for the whole report.  If the
+** sink reports an error, the rest of the output is discarded and
+** sink->error is set to the errno value.
+*/
+time_t reportWrite ( sink, options, tasks, num_tasks )
+ReportSink *sink;
+ReportOptions *options;
+Task **tasks;
+int num_tasks;
+{
+  ReportTaskData **seltasks;
+  ReportMatrix *matrix;
+  Project *project;
+  time_t total = 0;
+  int loop, day, days, ncols, h, m, s;
+
+  seltasks = (ReportTaskData **) malloc
+    ( ( num_tasks + 1 ) * sizeof ( ReportTaskData * ) );
+  for ( loop = 0; loop < num_tasks; loop++ ) {
+    seltasks[loop] = (ReportTaskData *) malloc ( sizeof ( ReportTaskData ) );
+    memset ( seltasks[loop], '\0', sizeof ( ReportTaskData ) );
+    seltasks[loop]->task = tasks[loop];
+    seltasks[loop]->project_name = "";
+    if ( tasks[loop]->project_id >= 0 ) {
+      project = projectGet ( tasks[loop]->project_id );
+      if ( project )
+        seltasks[loop]->project_name = project->name;
+    }
+  }
+
+  ncols = 1;
+  if ( options->include_hours )
+    ncols++;
+  if ( options->include_annotations )
+    ncols++;
+  if ( options->format == REPORT_OUTPUT_HTML ) {
+    report_printf ( sink, "<html><head><title>GTimer %s</title></head>\n",
+      gettext("Report") );
+    report_printf ( sink, "%s", CSS_STYLE );
+    report_printf ( sink, "<body>\n" );
+    report_printf ( sink, "<table>\n" );
+  }
+
+  matrix = build_matrix ( seltasks, num_tasks, options->first_day,
+    options->last_day, options->include_hours, options->round_incr,
+    options->type != REPORT_TYPE_DAILY && options->round_incr == 0,
+    options->num_threads );
+  for ( day = 0, days = options->first_day; days <= options->last_day;
+    day++, days++ ) {
+    total += summarize_day ( sink, seltasks, num_tasks, matrix, day,
+      days, options, ( days == options->last_day ) );
+  }
+  free_matrix ( matrix );
+
+  h = total / 3600;
+  m = ( total - h * 3600 ) / 60;
+  s = total % 60;
+
+  switch ( options->format ) {
+    case REPORT_OUTPUT_TEXT:
+      report_printf ( sink, "\n%s\n-------------------------------------\n",
+        gettext("Grand Total") );
+      report_printf ( sink, "%3d:%02d:%02d\n", h, m, s );
+      break;
+    case REPORT_OUTPUT_HTML:
+      report_printf ( sink, "<tr><th colspan=\"%d\">%s</th></tr>",
+        1 + ncols, gettext("Grand Total") );
+      report_printf ( sink,
+        "<tr><td align=\"right\"><b>%d:%02d:%02d</b></td></tr>",
+        h, m, s );
+      report_printf ( sink, "</table><p><hr><font size=\"-1\">%s ",
+        gettext("Generated by") );
+      report_printf ( sink, "<a href=\"%s\">GTimer v%s (%s)</a>.\n",
+        GTIMER_URL, GTIMER_VERSION, GTIMER_VERSION_DATE );
+      report_printf ( sink, "</body></html>\n" );
+      break;
+  }
+
+  for ( loop = 0; loop < num_tasks; loop++ )
+    free ( seltasks[loop] );
+  free ( seltasks );
+
+  return ( total );
+}
+
+
+/*
+** A report remembered by reportWriteCached().  It can be used again
+** for the same options and tasks as long as projectDataVersion() is
+** unchanged and taskChangedSince() says nothing between from_date and
+** to_date has changed since task_version.
+*/
+typedef struct {
+  ReportOptions options;
+  int from_date, to_date;	/* TASK_DATE() of first and last day */
+  int *task_numbers;		/* tasks in the report, in order */
+  int num_tasks;
+  unsigned long task_version;	/* taskDataVersion() when written */
+  unsigned long project_version; /* projectDataVersion() when written */
+  ReportText *text;		/* the report */
+  time_t total;			/* return value of reportWrite() */
+} ReportCacheEntry;
+
+/*
+** Sink used while a report is written for the cache: output goes on to
+** the real sink and a copy is kept (unless it gets too big to keep).
+*/
+typedef struct {
+  ReportSink *target;
+  char *text;
+  int len;
+  int max;
+  int too_big;
+} ReportCacheCopy;
+
+/* most recently used first */
+static ReportCacheEntry *report_cache[REPORT_CACHE_SIZE];
+static int num_cached = 0;
+
+
+static int cache_sink_write ( sink, text, len )
+ReportSink *sink;
+const char *text;
+int len;
+{
+  ReportCacheCopy *copy = (ReportCacheCopy *) sink->data;
+
+  if ( copy->target->write ( copy->target, text, len ) )
+    return ( -1 );
+
+  if ( copy->too_big )
+    return ( 0 );
+  if ( copy->len + len > REPORT_CACHE_MAX_TEXT ) {
+    copy->too_big = 1;
+    if ( copy->text )
+      free ( copy->text );
+    copy->text = NULL;
+    return ( 0 );
+  }
+  if ( copy->len + len > copy->max ) {
+    copy->max = copy->max ? copy->max * 2 : 4096;
+    while ( copy->max < copy->len + len )
+      copy->max *= 2;
+    copy->text = (char *) realloc ( copy->text, copy->max );
+  }
+  memcpy ( copy->text + copy->len, text, len );
+  copy->len += len;
+
+  return ( 0 );
+}
+
+
+static int report_date ( days )
+int days;
+{
+  int year, mon, mday;
+
+  civilDate ( days, &year, &mon, &mday );
+  return ( TASK_DATE ( year, mon, mday ) );
+}
+
+
+static void free_cache_entry ( entry )
+ReportCacheEntry *entry;
+{
+  free ( entry->task_numbers );
+  report_text_release ( entry->text );
+  free ( entry );
+}
+
+
+/*
+** Does a cached report match these options and tasks, and is the
+** data it covers unchanged?
+*/
+static int cache_entry_matches ( entry, options, from_date, to_date,
+  tasks, num_tasks )
+ReportCacheEntry *entry;
+ReportOptions *options;
+int from_date, to_date;
+Task **tasks;
+int num_tasks;
+{
+  int loop;
+
+  if ( entry->options.type != options->type ||
+    entry->options.format != options->format ||
+    entry->options.include_hours != options->include_hours ||
+    entry->options.include_annotations != options->include_annotations ||
+    entry->options.round_incr != options->round_incr ||
+    entry->options.midnight_offset != options->midnight_offset ||
+    entry->options.start_of_week != options->start_of_week ||
+    entry->from_date != from_date || entry->to_date != to_date ||
+    entry->num_tasks != num_tasks )
+    return ( 0 );
+  for ( loop = 0; loop < num_tasks; loop++ ) {
+    if ( entry->task_numbers[loop] != tasks[loop]->number )
+      return ( 0 );
+  }
+  if ( entry->project_version != projectDataVersion () )
+    return ( 0 );
+  if ( taskChangedSince ( entry->task_version, from_date, to_date ) )
+    return ( 0 );
+
+  return ( 1 );
+}
+
+
+/*
+** Same as reportWrite(), but the last few reports are kept in memory.
+** If the same report is asked for again and none of the data it covers
+** has changed, the saved copy is written to the sink instead of
+** generating the report again.  Reports larger than
+** REPORT_CACHE_MAX_TEXT are not kept.  If the sink was set up with
+** reportSinkText() and nothing has been written to it, the sink and
+** the cache share one copy of the text.
+*/
+time_t reportWriteCached ( sink, options, tasks, num_tasks )
+ReportSink *sink;
+ReportOptions *options;
+Task **tasks;
+int num_tasks;
+{
+  ReportCacheEntry *entry;
+  ReportCacheCopy copy;
+  ReportSink copy_sink;
+  ReportText *rt = NULL;
+  int loop, from_date, to_date;
+  unsigned long task_version, project_version;
+  time_t total;
+
+  from_date = report_date ( options->first_day );
+  to_date = report_date ( options->last_day );
+  if ( sink->write == text_sink_write &&
+    ( (ReportText *) sink->data )->len == 0 )
+    rt = (ReportText *) sink->data;
+
+  for ( loop = 0; loop < num_cached; loop++ ) {
+    entry = report_cache[loop];
+    if ( ! cache_entry_matches ( entry, options, from_date, to_date,
+      tasks, num_tasks ) )
+      continue;
+    /* move it to the front */
+    memmove ( report_cache + 1, report_cache, loop * sizeof ( entry ) );
+    report_cache[0] = entry;
+    if ( rt ) {
+      report_text_release ( rt );
+      entry->text->refs++;
+      sink->data = entry->text;
+      return ( entry->total );
+    }
+    errno = 0;
+    if ( ! sink->error &&
+      sink->write ( sink, entry->text->text, entry->text->len ) )
+      sink->error = errno ? errno : EIO;
+    return ( entry->total );
+  }
+
+  task_version = taskDataVersion ();
+  project_version = projectDataVersion ();
+  if ( rt ) {
+    /* the sink already keeps the whole text, so share it */
+    total = reportWrite ( sink, options, tasks, num_tasks );
+    if ( sink->error || rt->len > REPORT_CACHE_MAX_TEXT )
+      return ( total );
+    rt->refs++;
+  } else {
+    memset ( &copy, '\0', sizeof ( copy ) );
+    copy.target = sink;
+    memset ( &copy_sink, '\0', sizeof ( copy_sink ) );
+    copy_sink.write = cache_sink_write;
+    copy_sink.data = &copy;
+    copy_sink.fd = -1;
+    copy_sink.error = sink->error;
+    total = reportWrite ( &copy_sink, options, tasks, num_tasks );
+    sink->error = copy_sink.error;
+    if ( sink->error || copy.too_big ) {
+      if ( copy.text )
+        free ( copy.text );
+      return ( total );
+    }
+    rt = report_text_new ();
+    rt->text = copy.text;
+    rt->len = copy.len;
+    rt->max = copy.max;
+  }
+
+  entry = (ReportCacheEntry *) malloc ( sizeof ( ReportCacheEntry ) );
+  memset ( entry, '\0', sizeof ( ReportCacheEntry ) );
+  entry->options = *options;
+  entry->from_date = from_date;
+  entry->to_date = to_date;
+  entry->task_numbers = (int *) malloc ( ( num_tasks + 1 ) * sizeof ( int ) );
+  for ( loop = 0; loop < num_tasks; loop++ )
+    entry->task_numbers[loop] = tasks[loop]->number;
+  entry->num_tasks = num_tasks;
+  entry->task_version = task_version;
+  entry->project_version = project_version;
+  entry->text = rt;
+  entry->total = total;
+
+  /* drop the least recently used report if the cache is full */
+  if ( num_cached == REPORT_CACHE_SIZE )
+    free_cache_entry ( report_cache[--num_cached] );
+  memmove ( report_cache + 1, report_cache, num_cached * sizeof ( entry ) );
+  report_cache[0] = entry;
+  num_cached++;
+
+  return ( total );
+}
+
+
+/*
+** Get the first and last day of one of the standard report ranges
+** (REPORT_RANGE_TODAY, ...) relative to today.  Weeks start on Sunday.
+*/
+void reportGetRange ( range, midnight_offset, first_day, last_day )
+int range;
+int midnight_offset;
+int *first_day, *last_day;
+{
+  int today, wday, year, mon, mday;
+
+  today = civilToday ( midnight_offset );
+  wday = civilWeekday ( today );
+  civilDate ( today, &year, &mon, &mday );
+  switch ( range ) {
+    case REPORT_RANGE_TODAY:
+      *first_day = *last_day = today;
+      break;
+    case REPORT_RANGE_LAST_WEEK:
+      *first_day = today - wday - 7;
+      *last_day = today - wday - 1;
+      break;
+    case REPORT_RANGE_THIS_AND_LAST_WEEK:
+      *first_day = today - wday - 7;
+      *last_day = *first_day + 14;
+      break;
+    case REPORT_RANGE_LAST_TWO_WEEKS:
+      *first_day = today - wday - 14;
+      *last_day = today - wday - 1;
+      break;
+    case REPORT_RANGE_THIS_MONTH:
+      *first_day = civilDays ( year, mon, 1 );
+      *last_day = today;
+      break;
+    case REPORT_RANGE_LAST_MONTH:
+      *last_day = civilDays ( year, mon, 1 ) - 1;
+      civilDate ( *last_day, &year, &mon, &mday );
+      *first_day = civilDays ( year, mon, 1 );
+      break;
+    case REPORT_RANGE_THIS_YEAR:
+      *first_day = civilDays ( year, 1, 1 );
+      *last_day = today;
+      break;
+    case REPORT_RANGE_LAST_YEAR:
+      *first_day = civilDays ( year - 1, 1, 1 );
+      *last_day = civilDays ( year, 1, 1 ) - 1;
+      break;
+    default:
+    case REPORT_RANGE_THIS_WEEK:
+      *first_day = today - wday;
+      *last_day = today;
+      break;
+  }
+}
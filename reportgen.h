@@ -0,0 +1,110 @@
+/*
+ * Report generation (independent of the user interface)
+ *
+ * Copyright:
+ *	(C) 1998-2023 Craig Knudsen, craig@k5n.us
+ *	See accompanying file "COPYING".
+ *
+ *	This program is free software; you can redistribute it and/or
+ *	modify it under the terms of the GNU General Public License
+ *	as published by the Free Software Foundation; either version 2
+ *	of the License, or (at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program; if not, write to the
+ *	Free Software Foundation, Inc., 59 Temple Place,
+ *	Suite 330, Boston, MA  02111-1307, USA
+ *
+ * History:
+ *	17-Oct-2026	Added reportSinkText()
+ *	16-Oct-2026	Report ranges are day numbers (see civil.h) rather
+ *			than times.  Added REPORT_RANGE_CUSTOM.
+ *	16-Oct-2026	Added reportWriteCached()
+ *	16-Oct-2026	Added num_threads to ReportOptions
+ *	16-Oct-2026	Added ReportSink
+ *	16-Oct-2026	Created
+ */
+
+
+#ifndef _REPORTGEN_H
+#define _REPORTGEN_H
+
+/* Time ranges */
+#define REPORT_RANGE_TODAY              0
+#define REPORT_RANGE_THIS_WEEK          1
+#define REPORT_RANGE_LAST_WEEK          2
+#define REPORT_RANGE_THIS_AND_LAST_WEEK 3
+#define REPORT_RANGE_LAST_TWO_WEEKS     4
+#define REPORT_RANGE_THIS_MONTH         5
+#define REPORT_RANGE_LAST_MONTH         6
+#define REPORT_RANGE_THIS_YEAR          7
+#define REPORT_RANGE_LAST_YEAR          8
+#define REPORT_RANGE_CUSTOM             9 /* caller sets first/last_day */
+
+/* Output types */
+#define REPORT_OUTPUT_TEXT		0
+#define REPORT_OUTPUT_HTML		1
+
+/* Data to include */
+#define REPORT_DATA_HOURS		0
+#define REPORT_DATA_ANNOTATIONS		1
+#define REPORT_DATA_BOTH		2
+
+/* Rounding options (in seconds) */
+#define REPORT_ROUND_NONE		0
+#define REPORT_ROUND_MINUTE		60
+#define REPORT_ROUND_5_MINUTES		300
+#define REPORT_ROUND_10_MINUTES		600
+#define REPORT_ROUND_15_MINUTES		900
+#define REPORT_ROUND_30_MINUTES		1800
+#define REPORT_ROUND_HOUR		3600
+
+/*
+** Where report output goes.  reportWrite() passes its output to the
+** write function a piece at a time as it is generated.  The write
+** function returns 0 on success; after a failure error is set to the
+** errno value and nothing more is written.
+*/
+typedef struct _ReportSink ReportSink;
+struct _ReportSink {
+  int (*write) ( ReportSink *sink, const char *text, int len );
+  void *data;			/* FILE * or other sink-specific data */
+  int fd;			/* file descriptor (reportSinkFd only) */
+  int error;			/* errno value after a failed write */
+};
+
+typedef struct {
+  report_type type;		/* REPORT_TYPE_DAILY, ... */
+  int format;			/* REPORT_OUTPUT_TEXT or REPORT_OUTPUT_HTML */
+  int include_hours;		/* include time worked */
+  int include_annotations;	/* include annotations */
+  int round_incr;		/* round each day to this (REPORT_ROUND_*) */
+  int midnight_offset;		/* seconds after midnight still yesterday */
+  int start_of_week;		/* first day of week (0=Sunday) */
+  int first_day;		/* first day of report (civilDays()) */
+  int last_day;			/* last day of report (civilDays()) */
+  int num_threads;		/* threads used to gather the time */
+} ReportOptions;
+
+/*
+ * Functions
+ */
+
+void reportGetRange ( int range, int midnight_offset, int *first_day,
+  int *last_day );
+void reportSinkFile ( ReportSink *sink, FILE *fp );
+void reportSinkFd ( ReportSink *sink, int fd );
+void reportSinkText ( ReportSink *sink );
+const char *reportSinkTextGet ( ReportSink *sink, int *len );
+void reportSinkTextFree ( ReportSink *sink );
+time_t reportWrite ( ReportSink *sink, ReportOptions *options, Task **tasks,
+  int num_tasks );
+time_t reportWriteCached ( ReportSink *sink, ReportOptions *options,
+  Task **tasks, int num_tasks );
+
+#endif /* _REPORTGEN_H */
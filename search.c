@@ -0,0 +1,361 @@
+/*
+ * Trigram index for finding tasks by name
+ *
+ * Copyright:
+ *	(C) 1999-2023 Craig Knudsen, craig@k5n.us
+ *	See accompanying file "COPYING".
+ *
+ *	This program is free software; you can redistribute it and/or
+ *	modify it under the terms of the GNU General Public License
+ *	as published by the Free Software Foundation; either version 2
+ *	of the License, or (at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program; if not, write to the
+ *	Free Software Foundation, Inc., 59 Temple Place,
+ *	Suite 330, Boston, MA  02111-1307, USA
+ *
+ * History:
+ *	16-Oct-2026	Created
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "search.h"
+
+#ifdef GTIMER_MEMDEBUG
+#include "memdebug/memdebug.h"
+#endif
+
+#define TABLE_INITIAL_SIZE	1024	/* must be a power of 2 */
+
+/*
+** Three bytes packed into an int.  Text never contains a nul byte, so
+** a trigram is never 0, which marks an empty slot in the table.
+*/
+#define TRIGRAM(ptr)	( ( (unsigned char)(ptr)[0] << 16 ) | \
+			  ( (unsigned char)(ptr)[1] << 8 ) | \
+			  (unsigned char)(ptr)[2] )
+
+/* The items containing a trigram */
+typedef struct {
+  unsigned int trigram;		/* 0 if this slot is empty */
+  int num_ids;
+  int max_ids;
+  int *ids;
+} Posting;
+
+typedef struct {
+  void *data;			/* caller's pointer (NULL if unused) */
+  char *text;
+} SearchItem;
+
+struct _SearchIndex {
+  Posting *table;		/* hash table of trigrams */
+  int table_size;
+  int num_trigrams;
+  SearchItem *items;		/* item with id N is items[N - 1] */
+  int num_items;
+  int max_items;
+  int *free_ids;		/* ids of removed items, to be reused */
+  int num_free_ids;
+};
+
+
+static int hash_trigram ( trigram, size )
+unsigned int trigram;
+int size;
+{
+  return ( (int) ( ( trigram * 2654435761U ) >> 8 ) & ( size - 1 ) );
+}
+
+
+/*
+** Find the slot for a trigram: either the one holding it or the empty
+** one it would go in.
+*/
+static Posting *find_slot ( table, size, trigram )
+Posting *table;
+int size;
+unsigned int trigram;
+{
+  int slot;
+
+  for ( slot = hash_trigram ( trigram, size );
+    table[slot].trigram != 0 && table[slot].trigram != trigram;
+    slot = ( slot + 1 ) & ( size - 1 ) )
+    ;
+  return ( &table[slot] );
+}
+
+
+/*
+** Get the list of items for a trigram.  If create is set, a new empty
+** list is added if there is none; otherwise NULL is returned.
+*/
+static Posting *get_posting ( index, trigram, create )
+SearchIndex *index;
+unsigned int trigram;
+int create;
+{
+  Posting *posting, *old_table;
+  int loop, old_size;
+
+  posting = find_slot ( index->table, index->table_size, trigram );
+  if ( posting->trigram != 0 || ! create )
+    return ( posting->trigram != 0 ? posting : NULL );
+
+  /* keep the table at most half full */
+  if ( ( index->num_trigrams + 1 ) * 2 > index->table_size ) {
+    old_table = index->table;
+    old_size = index->table_size;
+    index->table_size *= 2;
+    index->table = (Posting *) calloc ( index->table_size,
+      sizeof ( Posting ) );
+    for ( loop = 0; loop < old_size; loop++ ) {
+      if ( old_table[loop].trigram != 0 )
+        *find_slot ( index->table, index->table_size,
+          old_table[loop].trigram ) = old_table[loop];
+    }
+    free ( old_table );
+    posting = find_slot ( index->table, index->table_size, trigram );
+  }
+
+  posting->trigram = trigram;
+  index->num_trigrams++;
+  return ( posting );
+}
+
+
+SearchIndex *searchNew ()
+{
+  SearchIndex *index;
+
+  index = (SearchIndex *) malloc ( sizeof ( SearchIndex ) );
+  memset ( index, '\0', sizeof ( SearchIndex ) );
+  index->table_size = TABLE_INITIAL_SIZE;
+  index->table = (Posting *) calloc ( index->table_size,
+    sizeof ( Posting ) );
+
+  return ( index );
+}
+
+
+void searchFree ( index )
+SearchIndex *index;
+{
+  int loop;
+
+  for ( loop = 0; loop < index->table_size; loop++ ) {
+    if ( index->table[loop].ids )
+      free ( index->table[loop].ids );
+  }
+  for ( loop = 0; loop < index->num_items; loop++ ) {
+    if ( index->items[loop].text )
+      free ( index->items[loop].text );
+  }
+  free ( index->table );
+  if ( index->items )
+    free ( index->items );
+  if ( index->free_ids )
+    free ( index->free_ids );
+  free ( index );
+}
+
+
+/*
+** Add an item to the index.
+** Returns the item's id (always greater than 0), which is needed
+** to remove it.
+*/
+int searchAdd ( index, data, text )
+SearchIndex *index;
+void *data;
+char *text;
+{
+  Posting *posting;
+  char *ptr;
+  int id;
+
+  if ( index->num_free_ids > 0 ) {
+    id = index->free_ids[--index->num_free_ids];
+  } else {
+    if ( index->num_items == index->max_items ) {
+      index->max_items = index->max_items ? index->max_items * 2 : 256;
+      index->items = (SearchItem *) realloc ( index->items,
+        index->max_items * sizeof ( SearchItem ) );
+    }
+    id = ++index->num_items;
+  }
+  index->items[id - 1].data = data;
+  index->items[id - 1].text = strdup ( text );
+
+  for ( ptr = text; ptr[0] && ptr[1] && ptr[2]; ptr++ ) {
+    posting = get_posting ( index, TRIGRAM ( ptr ), 1 );
+    /* a trigram that appears twice in the text was just added */
+    if ( posting->num_ids > 0 && posting->ids[posting->num_ids - 1] == id )
+      continue;
+    if ( posting->num_ids == posting->max_ids ) {
+      posting->max_ids = posting->max_ids ? posting->max_ids * 2 : 4;
+      posting->ids = (int *) realloc ( posting->ids,
+        posting->max_ids * sizeof ( int ) );
+    }
+    posting->ids[posting->num_ids++] = id;
+  }
+
+  return ( id );
+}
+
+
+/*
+** Remove an item from the index.
+*/
+void searchRemove ( index, id )
+SearchIndex *index;
+int id;
+{
+  Posting *posting;
+  char *ptr;
+  int loop;
+
+  if ( id < 1 || id > index->num_items || index->items[id - 1].text == NULL )
+    return;
+
+  for ( ptr = index->items[id - 1].text; ptr[0] && ptr[1] && ptr[2];
+    ptr++ ) {
+    posting = get_posting ( index, TRIGRAM ( ptr ), 0 );
+    if ( posting == NULL )
+      continue;
+    for ( loop = 0; loop < posting->num_ids; loop++ ) {
+      if ( posting->ids[loop] == id ) {
+        posting->ids[loop] = posting->ids[--posting->num_ids];
+        break;
+      }
+    }
+  }
+  free ( index->items[id - 1].text );
+  index->items[id - 1].text = NULL;
+  index->items[id - 1].data = NULL;
+
+  if ( index->num_free_ids % 256 == 0 )
+    index->free_ids = (int *) realloc ( index->free_ids,
+      ( index->num_free_ids + 256 ) * sizeof ( int ) );
+  index->free_ids[index->num_free_ids++] = id;
+}
+
+
+/*
+** Does an item's text contain the pattern?
+*/
+int searchMatches ( index, id, pattern )
+SearchIndex *index;
+int id;
+char *pattern;
+{
+  if ( id < 1 || id > index->num_items || index->items[id - 1].text == NULL )
+    return ( 0 );
+
+  return ( strstr ( index->items[id - 1].text, pattern ) != NULL );
+}
+
+
+/*
+** Find all the items whose text contains the pattern.
+** Returns the number found.  *matches is set to an array of their
+** data pointers (in no particular order), which the caller must free.
+*/
+int searchFind ( index, pattern, matches )
+SearchIndex *index;
+char *pattern;
+void ***matches;
+{
+  Posting *posting, *shortest = NULL;
+  SearchItem *item;
+  char *ptr;
+  int loop, num, count = 0;
+
+  if ( strlen ( pattern ) >= 3 ) {
+    for ( ptr = pattern; ptr[2]; ptr++ ) {
+      posting = get_posting ( index, TRIGRAM ( ptr ), 0 );
+      if ( posting == NULL || posting->num_ids == 0 ) {
+        *matches = (void **) malloc ( sizeof ( void * ) );
+        return ( 0 );
+      }
+      if ( shortest == NULL || posting->num_ids < shortest->num_ids )
+        shortest = posting;
+    }
+  }
+
+  num = shortest ? shortest->num_ids : index->num_items;
+  *matches = (void **) malloc ( ( num + 1 ) * sizeof ( void * ) );
+  for ( loop = 0; loop < num; loop++ ) {
+    item = &index->items[shortest ? shortest->ids[loop] - 1 : loop];
+    if ( item->text != NULL && strstr ( item->text, pattern ) != NULL )
+      (*matches)[count++] = item->data;
+  }
+
+  return ( count );
+}
+
+
+/*
+** Find the item whose text is most like the pattern, for when nothing
+** contains it (a misspelled name, say).  The item must contain at
+** least half of the pattern's trigrams; of the items with the most,
+** the one with the shortest text is chosen.
+** Returns the item's data pointer, or NULL if there is no such item
+** or no single best one.
+*/
+void *searchFindSimilar ( index, pattern )
+SearchIndex *index;
+char *pattern;
+{
+  Posting *posting;
+  char *ptr, *ptr2;
+  int *counts, loop, num_trigrams = 0, best = -1, best_len = 0, len;
+  int tied = 0;
+
+  if ( strlen ( pattern ) < 3 || index->num_items == 0 )
+    return ( NULL );
+
+  counts = (int *) calloc ( index->num_items, sizeof ( int ) );
+  for ( ptr = pattern; ptr[2]; ptr++ ) {
+    /* count each trigram of the pattern once */
+    for ( ptr2 = pattern; ptr2 < ptr && TRIGRAM ( ptr2 ) != TRIGRAM ( ptr );
+      ptr2++ )
+      ;
+    if ( ptr2 < ptr )
+      continue;
+    num_trigrams++;
+    posting = get_posting ( index, TRIGRAM ( ptr ), 0 );
+    for ( loop = 0; posting != NULL && loop < posting->num_ids; loop++ )
+      counts[posting->ids[loop] - 1]++;
+  }
+
+  for ( loop = 0; loop < index->num_items; loop++ ) {
+    if ( counts[loop] == 0 || counts[loop] * 2 < num_trigrams )
+      continue;
+    len = strlen ( index->items[loop].text );
+    if ( best < 0 || counts[loop] > counts[best] ||
+      ( counts[loop] == counts[best] && len < best_len ) ) {
+      best = loop;
+      best_len = len;
+      tied = 0;
+    } else if ( counts[loop] == counts[best] && len == best_len ) {
+      tied = 1;
+    }
+  }
+  free ( counts );
+
+  if ( best < 0 || tied )
+    return ( NULL );
+  return ( index->items[best].data );
+}
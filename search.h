@@ -0,0 +1,55 @@
+/*
+ * Trigram index for finding tasks by name
+ *
+ * Copyright:
+ *	(C) 1999-2023 Craig Knudsen, craig@k5n.us
+ *	See accompanying file "COPYING".
+ *
+ *	This program is free software; you can redistribute it and/or
+ *	modify it under the terms of the GNU General Public License
+ *	as published by the Free Software Foundation; either version 2
+ *	of the License, or (at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program; if not, write to the
+ *	Free Software Foundation, Inc., 59 Temple Place,
+ *	Suite 330, Boston, MA  02111-1307, USA
+ *
+ * Description:
+ *	Each item in the index is some text and a pointer for the caller.
+ *	For every three byte sequence (trigram) in an item's text, the
+ *	index keeps a list of the items that contain it.  To find the
+ *	items containing a pattern, only the items on the shortest list
+ *	among the pattern's trigrams need to be checked.  Patterns of
+ *	fewer than three bytes are checked against every item.
+ *	The index compares bytes; callers should fold the case of the
+ *	text and patterns they pass in.
+ *
+ * History:
+ *	16-Oct-2026	Created
+ */
+
+
+#ifndef _SEARCH_H
+#define _SEARCH_H
+
+typedef struct _SearchIndex SearchIndex;
+
+/*
+ * Functions
+ */
+
+SearchIndex *searchNew ();
+void searchFree ( SearchIndex *index );
+int searchAdd ( SearchIndex *index, void *data, char *text );
+void searchRemove ( SearchIndex *index, int id );
+int searchMatches ( SearchIndex *index, int id, char *pattern );
+int searchFind ( SearchIndex *index, char *pattern, void ***matches );
+void *searchFindSimilar ( SearchIndex *index, char *pattern );
+
+#endif /* _SEARCH_H */
@@ -0,0 +1,531 @@
+/*
+ * Binary snapshot of all task data for fast startup
+ *
+ * Copyright:
+ *	(C) 1999-2023 Craig Knudsen, craig@k5n.us
+ *	See accompanying file "COPYING".
+ *
+ *	This program is free software; you can redistribute it and/or
+ *	modify it under the terms of the GNU General Public License
+ *	as published by the Free Software Foundation; either version 2
+ *	of the License, or (at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program; if not, write to the
+ *	Free Software Foundation, Inc., 59 Temple Place,
+ *	Suite 330, Boston, MA  02111-1307, USA
+ *
+ * History:
+ *	16-Oct-2026	Compare the nanoseconds of file mtimes as well
+ *			as whole seconds.
+ *	16-Oct-2026	Add together entries for the same date, as
+ *			task_read() does.
+ *	16-Oct-2026	Created
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#if HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#ifdef WIN32
+#include <io.h>
+#endif
+#include <errno.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#if HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+
+#include "task.h"
+#include "snapshot.h"
+
+#ifdef GTIMER_MEMDEBUG
+#include "memdebug/memdebug.h"
+#endif
+
+#define SNAPSHOT_MAGIC		"GTSNAP\r\n"	/* 8 bytes */
+#define SNAPSHOT_VERSION	2
+
+/*
+** Sub-second part of a file's mtime.  Where st_mtime is a macro for
+** st_mtim.tv_sec (glibc, musl, the BSDs) the nanoseconds are available;
+** elsewhere this is 0 and only whole seconds are compared.
+*/
+#if defined(__APPLE__)
+#define STAT_MTIME_NSEC(buf)	((int) (buf)->st_mtimespec.tv_nsec)
+#elif defined(st_mtime) && !defined(WIN32)
+#define STAT_MTIME_NSEC(buf)	((int) (buf)->st_mtim.tv_nsec)
+#else
+#define STAT_MTIME_NSEC(buf)	0
+#endif
+
+/*
+** The snapshot file is written in the native byte order and word size.
+** It is only a cache of the text files on this machine, so there is
+** no need for it to be portable.  All records are made of ints so
+** they can be used in place from the mapped file.
+*/
+typedef struct {
+  char magic[8];		/* SNAPSHOT_MAGIC */
+  int version;			/* SNAPSHOT_VERSION */
+  int task_size;		/* sizeof ( SnapshotTask ) */
+  int entry_size;		/* sizeof ( SnapshotEntry ) */
+  int annotation_size;		/* sizeof ( SnapshotAnnotation ) */
+  int num_tasks;		/* number of task records */
+  int num_entries;		/* number of time entry records */
+  int num_annotations;		/* number of annotation records */
+  int strings_size;		/* size of string table in bytes */
+} SnapshotHeader;
+
+typedef struct {
+  int number;			/* task number (records sorted by this) */
+  int project_id;		/* project (-1 = no project) */
+  unsigned int options;		/* task options */
+  unsigned int created;		/* time created */
+  int name;			/* offset of name in string table */
+  int first_entry;		/* index of first time entry record */
+  int num_entries;		/* number of time entry records */
+  int first_annotation;		/* index of first annotation record */
+  int num_annotations;		/* number of annotation records */
+  unsigned int task_mtime;	/* mtime of .task file */
+  int task_mtime_nsec;		/* nanoseconds of above */
+  int task_size;		/* size of .task file */
+  unsigned int ann_mtime;	/* mtime of .ann file */
+  int ann_mtime_nsec;		/* nanoseconds of above */
+  int ann_size;			/* size of .ann file (-1 = no file) */
+} SnapshotTask;
+
+typedef struct {
+  int date;			/* YYYYMMDD */
+  int seconds;			/* time in seconds */
+} SnapshotEntry;
+
+typedef struct {
+  unsigned int text_time;	/* GMT of annotation */
+  int text;			/* offset of text in string table */
+} SnapshotAnnotation;
+
+struct _Snapshot {
+  char *data;			/* contents of the file */
+  long size;			/* size of above */
+  int mapped;			/* data is mmap()ed rather than malloc()ed */
+  SnapshotHeader *header;
+  SnapshotTask *tasks;
+  SnapshotEntry *entries;
+  SnapshotAnnotation *annotations;
+  char *strings;
+};
+
+
+/*
+** Build the path of a file in the specified directory.
+** Caller must free return value.
+*/
+static char *snapshot_file ( dir, name )
+char *dir;
+char *name;
+{
+  char *path;
+
+  path = (char *) malloc ( strlen ( dir ) + strlen ( name ) + 2 );
+  sprintf ( path, "%s/%s", dir, name );
+  return ( path );
+}
+
+
+/*
+** Make sure an array has room for at least one more element.
+*/
+static void *grow_array ( array, num, max, size )
+void *array;
+int num;
+int *max;
+int size;
+{
+  if ( num < *max )
+    return ( array );
+  *max = *max ? *max * 2 : 64;
+  if ( array )
+    return ( realloc ( array, *max * size ) );
+  else
+    return ( malloc ( *max * size ) );
+}
+
+
+/*
+** Write a snapshot of all tasks that have been saved to their files.
+** Tasks with unsaved (or only journaled) changes are left out and will
+** be loaded from their text files.  This should be called after all
+** tasks have been saved.
+*/
+int snapshotWrite ( dir )
+char *dir;
+{
+  SnapshotHeader header;
+  SnapshotTask *tasks = NULL, *rec;
+  SnapshotEntry *entries = NULL;
+  SnapshotAnnotation *annotations = NULL;
+  char *strings = NULL, *path, *tmppath, *file;
+  int max_tasks = 0, max_entries = 0, max_annotations = 0, max_strings = 0;
+  int len, loop;
+  struct stat task_buf, ann_buf;
+  Task *task;
+  FILE *fp;
+
+  memset ( &header, '\0', sizeof ( header ) );
+  memcpy ( header.magic, SNAPSHOT_MAGIC, sizeof ( header.magic ) );
+  header.version = SNAPSHOT_VERSION;
+  header.task_size = sizeof ( SnapshotTask );
+  header.entry_size = sizeof ( SnapshotEntry );
+  header.annotation_size = sizeof ( SnapshotAnnotation );
+
+  file = (char *) malloc ( strlen ( dir ) + 32 );
+
+  for ( task = taskGetFirst (); task != NULL; task = taskGetNext () ) {
+    if ( task->dirty || task->journaled )
+      continue;
+    sprintf ( file, "%s/%d.task", dir, task->number );
+    if ( stat ( file, &task_buf ) != 0 )
+      continue;
+    sprintf ( file, "%s/%d.ann", dir, task->number );
+    if ( stat ( file, &ann_buf ) != 0 ) {
+      if ( task->num_annotations )
+        continue;
+      ann_buf.st_size = -1;
+    }
+
+    tasks = (SnapshotTask *) grow_array ( tasks, header.num_tasks,
+      &max_tasks, sizeof ( SnapshotTask ) );
+    rec = &tasks[header.num_tasks++];
+    memset ( rec, '\0', sizeof ( SnapshotTask ) );
+    rec->number = task->number;
+    rec->project_id = task->project_id;
+    rec->options = task->options;
+    rec->created = (unsigned int) task->created;
+    rec->task_mtime = (unsigned int) task_buf.st_mtime;
+    rec->task_mtime_nsec = STAT_MTIME_NSEC ( &task_buf );
+    rec->task_size = (int) task_buf.st_size;
+    if ( ann_buf.st_size >= 0 ) {
+      rec->ann_mtime = (unsigned int) ann_buf.st_mtime;
+      rec->ann_mtime_nsec = STAT_MTIME_NSEC ( &ann_buf );
+    }
+    rec->ann_size = (int) ann_buf.st_size;
+
+    len = strlen ( task->name ) + 1;
+    while ( header.strings_size + len > max_strings ) {
+      max_strings = max_strings ? max_strings * 2 : 4096;
+      strings = strings ? (char *) realloc ( strings, max_strings ) :
+        (char *) malloc ( max_strings );
+    }
+    rec->name = header.strings_size;
+    memcpy ( strings + header.strings_size, task->name, len );
+    header.strings_size += len;
+
+    rec->first_entry = header.num_entries;
+    for ( loop = 0; loop < task->num_entries; loop++ ) {
+      /* same as the task file, which leaves out empty days */
+      if ( ! task->entries[loop]->seconds )
+        continue;
+      entries = (SnapshotEntry *) grow_array ( entries, header.num_entries,
+        &max_entries, sizeof ( SnapshotEntry ) );
+      entries[header.num_entries].date = task->entries[loop]->date;
+      entries[header.num_entries].seconds = task->entries[loop]->seconds;
+      header.num_entries++;
+      rec->num_entries++;
+    }
+
+    rec->first_annotation = header.num_annotations;
+    for ( loop = 0; loop < task->num_annotations; loop++ ) {
+      annotations = (SnapshotAnnotation *) grow_array ( annotations,
+        header.num_annotations, &max_annotations,
+        sizeof ( SnapshotAnnotation ) );
+      len = strlen ( task->annotations[loop]->text ) + 1;
+      while ( header.strings_size + len > max_strings ) {
+        max_strings = max_strings ? max_strings * 2 : 4096;
+        strings = strings ? (char *) realloc ( strings, max_strings ) :
+          (char *) malloc ( max_strings );
+      }
+      annotations[header.num_annotations].text_time =
+        (unsigned int) task->annotations[loop]->text_time;
+      annotations[header.num_annotations].text = header.strings_size;
+      memcpy ( strings + header.strings_size,
+        task->annotations[loop]->text, len );
+      header.strings_size += len;
+      header.num_annotations++;
+      rec->num_annotations++;
+    }
+  }
+  free ( file );
+
+  /* write to a temporary file and then rename so a reader never sees
+     a partially written snapshot */
+  path = snapshot_file ( dir, SNAPSHOT_FILE );
+  tmppath = snapshot_file ( dir, SNAPSHOT_FILE ".new" );
+  fp = fopen ( tmppath, "wb" );
+  if ( fp ) {
+    fwrite ( &header, sizeof ( header ), 1, fp );
+    if ( header.num_tasks )
+      fwrite ( tasks, sizeof ( SnapshotTask ), header.num_tasks, fp );
+    if ( header.num_entries )
+      fwrite ( entries, sizeof ( SnapshotEntry ), header.num_entries, fp );
+    if ( header.num_annotations )
+      fwrite ( annotations, sizeof ( SnapshotAnnotation ),
+        header.num_annotations, fp );
+    if ( header.strings_size )
+      fwrite ( strings, 1, header.strings_size, fp );
+  }
+  if ( tasks )
+    free ( tasks );
+  if ( entries )
+    free ( entries );
+  if ( annotations )
+    free ( annotations );
+  if ( strings )
+    free ( strings );
+
+  if ( ! fp || ferror ( fp ) | fclose ( fp ) ||
+    rename ( tmppath, path ) ) {
+    unlink ( tmppath );
+    free ( tmppath );
+    free ( path );
+    return ( SNAPSHOT_ERROR_SYSTEM_ERROR );
+  }
+  free ( tmppath );
+  free ( path );
+
+  return ( 0 );
+}
+
+
+/*
+** Open the snapshot in the specified directory.
+** Returns NULL if there is no snapshot or it is not valid.
+*/
+Snapshot *snapshotOpen ( dir )
+char *dir;
+{
+  Snapshot *snapshot;
+  SnapshotHeader *header;
+  SnapshotTask *rec;
+  char *path;
+  struct stat buf;
+  long expected;
+  int fd, loop;
+
+  path = snapshot_file ( dir, SNAPSHOT_FILE );
+  fd = open ( path, O_RDONLY );
+  free ( path );
+  if ( fd < 0 )
+    return ( NULL );
+  if ( fstat ( fd, &buf ) != 0 || buf.st_size < sizeof ( SnapshotHeader ) ) {
+    close ( fd );
+    return ( NULL );
+  }
+
+  snapshot = (Snapshot *) malloc ( sizeof ( Snapshot ) );
+  memset ( snapshot, '\0', sizeof ( Snapshot ) );
+  snapshot->size = (long) buf.st_size;
+#if HAVE_SYS_MMAN_H
+  snapshot->data = (char *) mmap ( NULL, snapshot->size, PROT_READ,
+    MAP_PRIVATE, fd, 0 );
+  if ( snapshot->data == (char *) MAP_FAILED )
+    snapshot->data = NULL;
+  else
+    snapshot->mapped = 1;
+#endif
+  if ( ! snapshot->data ) {
+    snapshot->data = (char *) malloc ( snapshot->size );
+    if ( read ( fd, snapshot->data, snapshot->size ) != snapshot->size ) {
+      close ( fd );
+      snapshotClose ( snapshot );
+      return ( NULL );
+    }
+  }
+  close ( fd );
+
+  /* check that this is a snapshot we can use */
+  header = snapshot->header = (SnapshotHeader *) snapshot->data;
+  if ( memcmp ( header->magic, SNAPSHOT_MAGIC, sizeof ( header->magic ) ) ||
+    header->version != SNAPSHOT_VERSION ||
+    header->task_size != sizeof ( SnapshotTask ) ||
+    header->entry_size != sizeof ( SnapshotEntry ) ||
+    header->annotation_size != sizeof ( SnapshotAnnotation ) ||
+    header->num_tasks < 0 || header->num_entries < 0 ||
+    header->num_annotations < 0 || header->strings_size < 0 ) {
+    snapshotClose ( snapshot );
+    return ( NULL );
+  }
+  expected = sizeof ( SnapshotHeader ) +
+    (long) header->num_tasks * sizeof ( SnapshotTask ) +
+    (long) header->num_entries * sizeof ( SnapshotEntry ) +
+    (long) header->num_annotations * sizeof ( SnapshotAnnotation ) +
+    header->strings_size;
+  if ( expected != snapshot->size ||
+    ( header->strings_size &&
+    snapshot->data[snapshot->size - 1] != '\0' ) ) {
+    snapshotClose ( snapshot );
+    return ( NULL );
+  }
+  snapshot->tasks = (SnapshotTask *) ( header + 1 );
+  snapshot->entries = (SnapshotEntry *)
+    ( snapshot->tasks + header->num_tasks );
+  snapshot->annotations = (SnapshotAnnotation *)
+    ( snapshot->entries + header->num_entries );
+  snapshot->strings = (char *)
+    ( snapshot->annotations + header->num_annotations );
+
+  /* check the offsets in every task record once here so that
+     snapshotLoadTask() can trust them */
+  for ( loop = 0; loop < header->num_tasks; loop++ ) {
+    rec = &snapshot->tasks[loop];
+    if ( rec->name < 0 || rec->name >= header->strings_size ||
+      rec->first_entry < 0 || rec->num_entries < 0 ||
+      rec->first_entry + rec->num_entries > header->num_entries ||
+      rec->first_annotation < 0 || rec->num_annotations < 0 ||
+      rec->first_annotation + rec->num_annotations >
+      header->num_annotations ||
+      ( loop > 0 && rec->number <= snapshot->tasks[loop - 1].number ) ) {
+      snapshotClose ( snapshot );
+      return ( NULL );
+    }
+  }
+  for ( loop = 0; loop < header->num_annotations; loop++ ) {
+    if ( snapshot->annotations[loop].text < 0 ||
+      snapshot->annotations[loop].text >= header->strings_size ) {
+      snapshotClose ( snapshot );
+      return ( NULL );
+    }
+  }
+
+  return ( snapshot );
+}
+
+
+/*
+** Create a task from its snapshot record.  The stat() results for the
+** task's .task and .ann files (ann_stat is NULL if there is no .ann
+** file) are compared with the ones saved in the snapshot.
+** Returns SNAPSHOT_ERROR_STALE if the task is not in the snapshot or
+** its files have changed since the snapshot was written.  The caller
+** should then load the task with taskLoad().
+** Note: the task is not added with taskAdd().
+*/
+int snapshotLoadTask ( snapshot, number, task_stat, ann_stat, task )
+Snapshot *snapshot;
+int number;
+struct stat *task_stat;
+struct stat *ann_stat;
+Task **task;
+{
+  SnapshotTask *rec = NULL;
+  SnapshotEntry *se;
+  SnapshotAnnotation *sa;
+  TaskTimeEntry *entry;
+  Task *newtask;
+  int low, high, mid, loop;
+
+  /* task records are sorted by number */
+  low = 0;
+  high = snapshot->header->num_tasks - 1;
+  while ( low <= high ) {
+    mid = ( low + high ) / 2;
+    if ( snapshot->tasks[mid].number == number ) {
+      rec = &snapshot->tasks[mid];
+      break;
+    } else if ( snapshot->tasks[mid].number < number )
+      low = mid + 1;
+    else
+      high = mid - 1;
+  }
+  /*
+  ** A file counts as unchanged if its size and mtime match.  Where
+  ** STAT_MTIME_NSEC() is 0 (no sub-second mtime), a rewrite that keeps
+  ** the same size within the same second as the snapshot was written
+  ** will not be noticed.
+  */
+  if ( ! rec ||
+    rec->task_mtime != (unsigned int) task_stat->st_mtime ||
+    rec->task_mtime_nsec != STAT_MTIME_NSEC ( task_stat ) ||
+    rec->task_size != (int) task_stat->st_size )
+    return ( SNAPSHOT_ERROR_STALE );
+  if ( ann_stat ) {
+    if ( rec->ann_mtime != (unsigned int) ann_stat->st_mtime ||
+      rec->ann_mtime_nsec != STAT_MTIME_NSEC ( ann_stat ) ||
+      rec->ann_size != (int) ann_stat->st_size )
+      return ( SNAPSHOT_ERROR_STALE );
+  } else if ( rec->ann_size != -1 ) {
+    return ( SNAPSHOT_ERROR_STALE );
+  }
+
+  newtask = (Task *) malloc ( sizeof ( Task ) );
+  memset ( newtask, '\0', sizeof ( Task ) );
+  newtask->number = rec->number;
+  newtask->project_id = rec->project_id;
+  newtask->options = rec->options;
+  newtask->created = (time_t) rec->created;
+  newtask->name = (char *) malloc ( strlen ( snapshot->strings + rec->name )
+    + 1 );
+  strcpy ( newtask->name, snapshot->strings + rec->name );
+
+  taskReserveTimeEntries ( newtask, rec->num_entries );
+  se = &snapshot->entries[rec->first_entry];
+  for ( loop = 0; loop < rec->num_entries; loop++, se++ ) {
+    entry = taskNewTimeEntry ( newtask, se->date / 10000,
+      ( se->date / 100 ) % 100, se->date % 100 );
+    entry->seconds += se->seconds;
+    entry->marked_seconds = entry->saved_seconds = entry->seconds;
+  }
+
+  taskReserveAnnotations ( newtask, rec->num_annotations );
+  sa = &snapshot->annotations[rec->first_annotation];
+  for ( loop = 0; loop < rec->num_annotations; loop++, sa++ )
+    taskNewAnnotation ( newtask, (time_t) sa->text_time,
+      snapshot->strings + sa->text );
+
+  *task = newtask;
+
+  return ( 0 );
+}
+
+
+/*
+** Release a snapshot opened with snapshotOpen().
+*/
+void snapshotClose ( snapshot )
+Snapshot *snapshot;
+{
+  if ( snapshot->data ) {
+#if HAVE_SYS_MMAN_H
+    if ( snapshot->mapped )
+      munmap ( snapshot->data, snapshot->size );
+    else
+#endif
+    free ( snapshot->data );
+  }
+  free ( snapshot );
+}
+
+
+/*
+** Delete the snapshot in the specified directory (if there is one).
+*/
+void snapshotRemove ( dir )
+char *dir;
+{
+  char *path;
+
+  path = snapshot_file ( dir, SNAPSHOT_FILE );
+  unlink ( path );
+  free ( path );
+}
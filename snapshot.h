@@ -0,0 +1,62 @@
+/*
+ * Binary snapshot of all task data for fast startup
+ *
+ * Copyright:
+ *	(C) 1999-2023 Craig Knudsen, craig@k5n.us
+ *	See accompanying file "COPYING".
+ *
+ *	This program is free software; you can redistribute it and/or
+ *	modify it under the terms of the GNU General Public License
+ *	as published by the Free Software Foundation; either version 2
+ *	of the License, or (at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program; if not, write to the
+ *	Free Software Foundation, Inc., 59 Temple Place,
+ *	Suite 330, Boston, MA  02111-1307, USA
+ *
+ * Description:
+ *	The snapshot is a cache of the .task and .ann files in a single
+ *	binary file.  It is laid out as a header followed by arrays of
+ *	fixed-width task, time entry and annotation records and then a
+ *	table of nul-terminated strings (task names and annotation text).
+ *	Each task record remembers the modification time and size of the
+ *	task's .task and .ann files when the snapshot was written, so a
+ *	task whose files have changed since is loaded from the text files
+ *	instead.  The text files are always the real data; the snapshot
+ *	can be deleted at any time.
+ *
+ * History:
+ *	16-Oct-2026	Created
+ */
+
+
+#ifndef _SNAPSHOT_H
+#define _SNAPSHOT_H
+
+#define SNAPSHOT_FILE		"snapshot.bin"	/* in the task directory */
+
+/* Errors */
+#define SNAPSHOT_ERROR_SYSTEM_ERROR	1	/* check errno value */
+#define SNAPSHOT_ERROR_BAD_FILE		2	/* not a valid snapshot */
+#define SNAPSHOT_ERROR_STALE		3	/* task files have changed */
+
+typedef struct _Snapshot Snapshot;
+
+/*
+ * Functions
+ */
+
+int snapshotWrite ( char *dir );
+Snapshot *snapshotOpen ( char *dir );
+int snapshotLoadTask ( Snapshot *snapshot, int number,
+  struct stat *task_stat, struct stat *ann_stat, Task **task );
+void snapshotClose ( Snapshot *snapshot );
+void snapshotRemove ( char *dir );
+
+#endif /* _SNAPSHOT_H */
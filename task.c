@@ -21,6 +21,43 @@
  *	Suite 330, Boston, MA  02111-1307, USA
  *
  * History:
+ *	17-Oct-2026	taskGetSaveCounts() counts tasks appended to the
+ *			journal separately from task files written.
+ *	16-Oct-2026	taskReplay() no longer removes the files of deleted
+ *			tasks; taskCompact() does.
+ *	16-Oct-2026	A task has at most one time entry per date; times
+ *			for a date listed more than once in a task file
+ *			are added together.
+ *	16-Oct-2026	Count changes to tasks so that callers can tell
+ *			whether anything has changed since they last
+ *			looked (see taskDataVersion()).
+ *	16-Oct-2026	TaskGetAnnotationEntries() uses an index of the
+ *			annotations sorted by day and returns a slice of
+ *			it rather than a newly allocated array.
+ *	16-Oct-2026	Keep a Fenwick tree of each task's time entries
+ *			so taskSumRange() can total any range of dates
+ *			without adding up every entry.
+ *	16-Oct-2026	Keep time entries sorted by date so that
+ *			taskGetTimeEntry() can use a binary search.
+ *			Added taskGetTimeEntryRange().
+ *	16-Oct-2026	Time entries and annotations are allocated from
+ *			per-task blocks and the pointer arrays grow by
+ *			doubling rather than one at a time.
+ *	16-Oct-2026	Rewrote the task file parser: each file is read in
+ *			one go, time entries go into a single block and
+ *			there is no longer a limit on the length of lines.
+ *	16-Oct-2026	taskLoadAll() can read task files with a pool of
+ *			threads (see taskSetLoadThreads()).
+ *	16-Oct-2026	taskLoadAll() loads tasks from the binary snapshot
+ *			when their files have not changed since it was
+ *			written.
+ *	16-Oct-2026	When the journal is open, taskSaveAll() appends
+ *			the changes to it instead of rewriting task files.
+ *			Added taskReplay() and taskCompact().
+ *	16-Oct-2026	Track unsaved changes in each task so that
+ *			taskSaveAll() only rewrites modified task files.
+ *			Added taskSetName(), taskSetProject(),
+ *			taskAddTime(), taskSetTime() and taskGetSaveCounts().
  *	17-Apr-2005	Add support for subtracting a particular offset
  *			off of timers.  (Russ Allbery)
  *	09-Mar-2000	Added functions to allow for restoring to
@@ -62,8 +99,13 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#if HAVE_PTHREAD
+#include <pthread.h>
+#endif
 
 #include "task.h"
+#include "journal.h"
+#include "snapshot.h"
 
 #ifdef GTIMER_MEMDEBUG
 #include "memdebug/memdebug.h"
@@ -76,6 +118,45 @@ static int num_tasks = 0;
 static Task **tasks = NULL;
 static int max_task = -1;
 static int last_number = -1;
+static int num_written = 0;	/* task files written by taskSaveAll */
+static int num_journaled = 0;	/* tasks appended to the journal */
+static int num_skipped = 0;	/* unchanged tasks skipped by taskSaveAll */
+static int load_threads = 1;	/* threads used by taskLoadAll */
+static int *replay_deleted = NULL; /* tasks deleted by taskReplay() */
+static int num_replay_deleted = 0;
+
+/*
+** Every change to a task in memory increments data_version.  Changes
+** to the time of a single day are also remembered by date so that
+** taskChangedSince() can tell that a change to today's time does not
+** affect last week.
+*/
+typedef struct {
+  int date;			/* TASK_DATE() of the day */
+  unsigned long version;	/* data_version of the last change to it */
+} TaskDateChange;
+
+static unsigned long data_version = 0;
+static unsigned long undated_version = 0; /* last change not to one day */
+static TaskDateChange *date_changes = NULL; /* sorted by date */
+static int num_date_changes = 0;
+static int max_date_changes = 0;
+
+/*
+** List of task files shared by the threads in taskLoadAll().
+** Each thread takes the next file from the list until there are none
+** left.  The tasks are only added to tasks[] once all threads are done.
+*/
+typedef struct {
+  char **paths;			/* task files to load */
+  Task **results;		/* task loaded from each file (or NULL) */
+  int num_paths;		/* size of above arrays */
+  int next;			/* next file to load */
+  Snapshot *snapshot;		/* snapshot to use (or NULL) */
+#if HAVE_PTHREAD
+  pthread_mutex_t lock;		/* protects next */
+#endif
+} TaskLoadQueue;
 
 
 #ifdef WIN32
@@ -89,6 +170,195 @@ char *filename;
 #endif
 
 
+/*
+** Get the task number from the path of a task file ("dir/NN.task").
+*/
+static int task_file_number ( path )
+char *path;
+{
+  char *ptr;
+
+  for ( ptr = path + strlen ( path ) - 1; *ptr != '/' && ptr != path; ptr-- );
+  if ( *ptr == '/' )
+    ptr++;
+  return ( atoi ( ptr ) );
+}
+
+
+/*
+** Make sure the newest block in a list of blocks has room for num more
+** items, allocating a new block if needed.  Blocks double in size (up
+** to TASK_MAX_BLOCK items) unless a bigger one is asked for.
+*/
+#define TASK_MIN_BLOCK	8
+#define TASK_MAX_BLOCK	512
+
+static void task_block_reserve ( blocks, item_size, num )
+TaskBlock **blocks;
+int item_size;
+int num;
+{
+  TaskBlock *block;
+  int size;
+
+  if ( *blocks && ( *blocks )->size - ( *blocks )->used >= num )
+    return;
+  size = *blocks ? ( *blocks )->size * 2 : TASK_MIN_BLOCK;
+  if ( size > TASK_MAX_BLOCK )
+    size = TASK_MAX_BLOCK;
+  if ( size < num )
+    size = num;
+  block = (TaskBlock *) malloc ( sizeof ( TaskBlock ) + size * item_size );
+  block->next = *blocks;
+  block->size = size;
+  block->used = 0;
+  *blocks = block;
+}
+
+
+/*
+** Get space for one item from a list of blocks.
+*/
+static void *task_block_alloc ( blocks, item_size )
+TaskBlock **blocks;
+int item_size;
+{
+  char *item;
+
+  task_block_reserve ( blocks, item_size, 1 );
+  item = (char *) ( *blocks + 1 ) + ( *blocks )->used * item_size;
+  ( *blocks )->used++;
+
+  return ( (void *) item );
+}
+
+
+/*
+** Free a list of blocks.
+*/
+static void task_block_free ( blocks )
+TaskBlock *blocks;
+{
+  TaskBlock *next;
+
+  for ( ; blocks != NULL; blocks = next ) {
+    next = blocks->next;
+    free ( blocks );
+  }
+}
+
+
+/*
+** Make sure an array of pointers has room for num elements.
+** The array is doubled in size as needed.
+*/
+static void *task_grow_array ( array, max, num, size )
+void *array;
+int *max;
+int num;
+int size;
+{
+  int newmax;
+
+  if ( num <= *max )
+    return ( array );
+  newmax = *max ? *max * 2 : TASK_MIN_BLOCK;
+  while ( newmax < num )
+    newmax *= 2;
+  *max = newmax;
+  if ( array )
+    return ( realloc ( array, newmax * size ) );
+  else
+    return ( malloc ( newmax * size ) );
+}
+
+
+/*
+** Note that tasks have changed.  If the change only affects the time
+** for one day, date is its TASK_DATE(); otherwise it is TASK_DATE_MIN.
+** This is not called for tasks still being loaded (which may be in
+** other threads); the change is noted when the task is added.
+*/
+static void task_changed ( date )
+int date;
+{
+  int low, high, mid;
+
+  data_version++;
+  if ( date == TASK_DATE_MIN ) {
+    undated_version = data_version;
+    return;
+  }
+
+  low = 0;
+  high = num_date_changes;
+  while ( low < high ) {
+    mid = ( low + high ) / 2;
+    if ( date_changes[mid].date < date )
+      low = mid + 1;
+    else
+      high = mid;
+  }
+  if ( low == num_date_changes || date_changes[low].date != date ) {
+    date_changes = (TaskDateChange *) task_grow_array ( date_changes,
+      &max_date_changes, num_date_changes + 1, sizeof ( TaskDateChange ) );
+    memmove ( date_changes + low + 1, date_changes + low,
+      ( num_date_changes - low ) * sizeof ( TaskDateChange ) );
+    date_changes[low].date = date;
+    num_date_changes++;
+  }
+  date_changes[low].version = data_version;
+}
+
+
+/*
+** Get the current data version.  It goes up every time any task is
+** added, deleted or changed in memory (saving a task does not change
+** it).
+*/
+unsigned long taskDataVersion ()
+{
+  return ( data_version );
+}
+
+
+/*
+** Has anything that could affect the tasks' data between from_date and
+** to_date (inclusive, as TASK_DATE() values) changed since the data
+** version was the specified version?  Changes other than to a day's
+** time (names, projects, annotations, tasks added or deleted) count
+** for every date.
+*/
+int taskChangedSince ( version, from_date, to_date )
+unsigned long version;
+int from_date, to_date;
+{
+  int low, high, mid;
+
+  if ( data_version == version )
+    return ( 0 );
+  if ( undated_version > version )
+    return ( 1 );
+
+  low = 0;
+  high = num_date_changes;
+  while ( low < high ) {
+    mid = ( low + high ) / 2;
+    if ( date_changes[mid].date < from_date )
+      low = mid + 1;
+    else
+      high = mid;
+  }
+  for ( ; low < num_date_changes && date_changes[low].date <= to_date;
+    low++ ) {
+    if ( date_changes[low].version > version )
+      return ( 1 );
+  }
+
+  return ( 0 );
+}
+
+
 /*
 ** Add a task.
 */
@@ -127,6 +397,7 @@ Task *task;
 
   tasks[task->number] = task;
   num_tasks++;
+  task_changed ( TASK_DATE_MIN );
 }
 
 
@@ -145,6 +416,7 @@ char *name;
   strcpy ( task->name, name );
   time ( &task->created );
   task->number = -1; /* not yet assigned */
+  task->dirty = TASK_DIRTY_NEW;
 
   return ( task );
 }
@@ -206,7 +478,12 @@ Task *task;
   int i;
 
   for ( i = 0; i < task->num_entries; i++ ) {
-    task->entries[i]->seconds = task->entries[i]->marked_seconds;
+    if ( task->entries[i]->seconds != task->entries[i]->marked_seconds ) {
+      task->entries[i]->seconds = task->entries[i]->marked_seconds;
+      task->dirty |= TASK_DIRTY_TIME;
+      task->sum_tree_valid = 0;
+      task_changed ( task->entries[i]->date );
+    }
   }
 }
 
@@ -229,6 +506,19 @@ void taskRestoreAll ()
 
 
 
+/*
+** Remove a task from memory, leaving its files alone.
+*/
+static void task_remove ( task )
+Task *task;
+{
+  tasks[task->number] = NULL;
+  num_tasks--;
+  taskFree ( task );
+  task_changed ( TASK_DATE_MIN );
+}
+
+
 /*
 ** Delete a task.
 */
@@ -238,16 +528,19 @@ char *taskdir;
 {
   char *path;
 
-  path = (char *) malloc ( strlen ( taskdir ) + 10 );
+  path = (char *) malloc ( strlen ( taskdir ) + 32 );
+  if ( journalIsOpen () ) {
+    sprintf ( path, "TD %d", task->number );
+    journalAppend ( path );
+    journalSync ();
+  }
   sprintf ( path, "%s/%d.task", taskdir, task->number );
   unlink ( path );
   sprintf ( path, "%s/%d.ann", taskdir, task->number );
   unlink ( path );
   free ( path );
 
-  tasks[task->number] = NULL;
-  num_tasks--;
-  taskFree ( task );
+  task_remove ( task );
 
   return ( 0 );
 }
@@ -318,6 +611,7 @@ void taskClearAll ()
   }
   num_tasks = 0;
   last_number = max_task = -1;
+  task_changed ( TASK_DATE_MIN );
 }
 
 
@@ -355,15 +649,77 @@ char *taskdir;
         task->entries[loop]->mday, task->entries[loop]->seconds );
   }
 
-  fclose ( fp );
+  if ( fclose ( fp ) ) {
+    free ( path );
+    return ( TASK_ERROR_SYSTEM_ERROR );
+  }
   free ( path );
+  for ( loop = 0; loop < task->num_entries; loop++ )
+    task->entries[loop]->saved_seconds = task->entries[loop]->seconds;
+  task->dirty = 0;
+  task->journaled = 0;
+
+  return ( 0 );
+}
+
+
+/*
+** Append the changes to a task since it was last saved to the journal.
+** Only the time entries that have changed are written.
+*/
+static int task_journal ( task )
+Task *task;
+{
+  char *record;
+  TaskTimeEntry *entry;
+  int loop;
+  int ret = 0;
+
+  record = (char *) malloc ( strlen ( task->name ) + 64 );
+
+  if ( task->dirty & TASK_DIRTY_NEW ) {
+    sprintf ( record, "TC %d %u", task->number, (unsigned int)task->created );
+    ret |= journalAppend ( record );
+  }
+  if ( task->dirty & ( TASK_DIRTY_NEW | TASK_DIRTY_NAME ) ) {
+    sprintf ( record, "TN %d %s", task->number, task->name );
+    ret |= journalAppend ( record );
+  }
+  if ( task->dirty & ( TASK_DIRTY_NEW | TASK_DIRTY_OPTIONS ) ) {
+    sprintf ( record, "TO %d %u", task->number, task->options );
+    ret |= journalAppend ( record );
+  }
+  if ( task->dirty & ( TASK_DIRTY_NEW | TASK_DIRTY_PROJECT ) ) {
+    sprintf ( record, "TP %d %d", task->number, task->project_id );
+    ret |= journalAppend ( record );
+  }
+  if ( task->dirty & ( TASK_DIRTY_NEW | TASK_DIRTY_TIME ) ) {
+    for ( loop = 0; loop < task->num_entries; loop++ ) {
+      entry = task->entries[loop];
+      if ( entry->seconds != entry->saved_seconds ) {
+        sprintf ( record, "TT %d %04d%02d%02d %d", task->number,
+          entry->year, entry->mon, entry->mday, entry->seconds );
+        ret |= journalAppend ( record );
+        entry->saved_seconds = entry->seconds;
+      }
+    }
+  }
+  free ( record );
+
+  if ( ret )
+    return ( TASK_ERROR_SYSTEM_ERROR );
+  task->dirty = 0;
+  task->journaled = 1;
 
   return ( 0 );
 }
 
 
 /*
-** Save all tasks
+** Save all tasks that have changed since they were loaded or last saved.
+** Tasks that have not changed are left alone on disk.
+** If the journal is open, the changes are appended to the journal
+** rather than rewriting each task file.
 */
 int taskSaveAll ( taskdir )
 char *taskdir;
@@ -373,6 +729,59 @@ char *taskdir;
 
   for ( loop = 0; loop <= max_task; loop++ ) {
     if ( tasks[loop] ) {
+      if ( ! tasks[loop]->dirty ) {
+        num_skipped++;
+        continue;
+      }
+      if ( journalIsOpen () ) {
+        ret = task_journal ( tasks[loop] );
+        if ( ret == 0 )
+          num_journaled++;
+      } else {
+        ret = taskSave ( tasks[loop], taskdir );
+        if ( ret == 0 )
+          num_written++;
+      }
+      if ( ret )
+        return ( ret );
+    }
+  }
+  if ( journalIsOpen () && journalSync () )
+    return ( TASK_ERROR_SYSTEM_ERROR );
+  return ( 0 );
+}
+
+
+/*
+** Write every task that has changes in the journal back to its task file.
+** Called by journalCompact().
+*/
+int taskCompact ( taskdir )
+char *taskdir;
+{
+  char *path;
+  int loop, number;
+  int ret;
+
+  /* remove the files of tasks deleted in the journal (unless reused) */
+  path = (char *) malloc ( strlen ( taskdir ) + 32 );
+  for ( loop = 0; loop < num_replay_deleted; loop++ ) {
+    number = replay_deleted[loop];
+    if ( number <= max_task && tasks[number] )
+      continue;
+    sprintf ( path, "%s/%d.task", taskdir, number );
+    unlink ( path );
+    sprintf ( path, "%s/%d.ann", taskdir, number );
+    unlink ( path );
+  }
+  free ( path );
+  if ( replay_deleted )
+    free ( replay_deleted );
+  replay_deleted = NULL;
+  num_replay_deleted = 0;
+
+  for ( loop = 0; loop <= max_task; loop++ ) {
+    if ( tasks[loop] && ( tasks[loop]->journaled || tasks[loop]->dirty ) ) {
       ret = taskSave ( tasks[loop], taskdir );
       if ( ret )
         return ( ret );
@@ -382,6 +791,96 @@ char *taskdir;
 }
 
 
+/*
+** Apply a single task record from the journal (see journal.h).
+** Only the tasks in memory are changed: a deleted task's files are
+** removed by taskCompact(), so replaying (as "gtimer --report" does)
+** never writes to the data directory.
+** Returns TASK_ERROR_BAD_FILE if the record cannot be parsed.
+*/
+int taskReplay ( record, taskdir )
+char *record;
+char *taskdir;
+{
+  Task *task = NULL;
+  TaskTimeEntry *entry;
+  char *ptr;
+  int number, date, seconds;
+
+  if ( strlen ( record ) < 4 || record[2] != ' ' )
+    return ( TASK_ERROR_BAD_FILE );
+  number = strtol ( record + 3, &ptr, 10 );
+  if ( ptr == record + 3 || number < 0 )
+    return ( TASK_ERROR_BAD_FILE );
+  if ( *ptr == ' ' )
+    ptr++;
+  if ( number <= max_task )
+    task = tasks[number];
+
+  if ( record[1] == 'C' ) {
+    if ( ! task ) {
+      task = taskCreate ( "" );
+      task->number = number;
+      taskAdd ( task );
+    }
+    task->created = (time_t) strtoul ( ptr, NULL, 10 );
+  } else if ( ! task ) {
+    /* a record for a task that has since been deleted */
+    return ( TASK_ERROR_BAD_FILE );
+  } else if ( record[1] == 'N' ) {
+    taskSetName ( task, ptr );
+  } else if ( record[1] == 'O' ) {
+    task->options = (unsigned int) strtoul ( ptr, NULL, 10 );
+  } else if ( record[1] == 'P' ) {
+    task->project_id = atoi ( ptr );
+  } else if ( record[1] == 'T' ) {
+    if ( sscanf ( ptr, "%d %d", &date, &seconds ) != 2 )
+      return ( TASK_ERROR_BAD_FILE );
+    entry = taskGetTimeEntry ( task, date / 10000, ( date / 100 ) % 100,
+      date % 100 );
+    if ( ! entry )
+      entry = taskNewTimeEntry ( task, date / 10000, ( date / 100 ) % 100,
+        date % 100 );
+    entry->seconds = entry->marked_seconds = entry->saved_seconds = seconds;
+    task->sum_tree_valid = 0;
+  } else if ( record[1] == 'D' ) {
+    replay_deleted = (int *) realloc ( replay_deleted,
+      ( num_replay_deleted + 1 ) * sizeof ( int ) );
+    replay_deleted[num_replay_deleted++] = number;
+    task_remove ( task );
+    return ( 0 );
+  } else {
+    return ( TASK_ERROR_BAD_FILE );
+  }
+
+  /* the change is already in the journal; it just needs compacting */
+  task->dirty = 0;
+  task->journaled = 1;
+  task_changed ( TASK_DATE_MIN );
+
+  return ( 0 );
+}
+
+
+/*
+** Get the number of task files written, the number of tasks appended
+** to the journal and the number of unchanged tasks skipped by
+** taskSaveAll() since the program started.
+*/
+void taskGetSaveCounts ( written, journaled, skipped )
+int *written;
+int *journaled;
+int *skipped;
+{
+  if ( written )
+    *written = num_written;
+  if ( journaled )
+    *journaled = num_journaled;
+  if ( skipped )
+    *skipped = num_skipped;
+}
+
+
 
 /*
 ** Free all resources of a task.
@@ -391,112 +890,196 @@ Task *task;
 {
   int loop;
   free ( task->name );
-  for ( loop = 0; loop < task->num_entries; loop++ )
-    free ( task->entries[loop] );
   if ( task->entries )
     free ( task->entries );
-  for ( loop = 0; loop < task->num_annotations; loop++ ) {
+  task_block_free ( task->entry_blocks );
+  for ( loop = 0; loop < task->num_annotations; loop++ )
     free ( task->annotations[loop]->text );
-    free ( task->annotations[loop] );
-  }
   if ( task->annotations )
     free ( task->annotations );
+  task_block_free ( task->annotation_blocks );
+  if ( task->sum_tree )
+    free ( task->sum_tree );
+  if ( task->day_index )
+    free ( task->day_index );
   free ( task );
 }
 
 
 
 /*
-** Load a task from file.
+** Read an entire file into memory.  The returned text is nul-terminated.
+** Returns NULL if the file cannot be read.
+** NOTE: Caller must free return value.
 */
-int taskLoad ( path, task )
+static char *task_read_file ( path )
+char *path;
+{
+  struct stat buf;
+  char *text;
+  int fd, len, ret = 0;
+
+  fd = open ( path, O_RDONLY );
+  if ( fd < 0 )
+    return ( NULL );
+  if ( fstat ( fd, &buf ) != 0 ) {
+    close ( fd );
+    return ( NULL );
+  }
+  text = (char *) malloc ( buf.st_size + 1 );
+  for ( len = 0; len < buf.st_size; len += ret ) {
+    ret = read ( fd, text + len, buf.st_size - len );
+    if ( ret <= 0 )
+      break;
+  }
+  close ( fd );
+  if ( ret < 0 ) {
+    free ( text );
+    return ( NULL );
+  }
+  text[len] = '\0';
+
+  return ( text );
+}
+
+
+/*
+** Get the next line from text read by task_read_file().  The newline
+** is replaced with a nul and *text is moved to the start of the next line.
+** Returns NULL when there are no more lines.
+*/
+static char *task_next_line ( text )
+char **text;
+{
+  char *line = *text, *ptr;
+
+  if ( *line == '\0' )
+    return ( NULL );
+  for ( ptr = line; *ptr != '\0' && *ptr != '\n'; ptr++ ) ;
+  if ( *ptr == '\n' )
+    *ptr++ = '\0';
+  *text = ptr;
+
+  return ( line );
+}
+
+
+/*
+** Parse a time entry line from a task file: "YYYYMMDD seconds".
+** Returns 0 if the line is not valid.
+*/
+static int task_parse_entry ( line, entry )
+char *line;
+TaskTimeEntry *entry;
+{
+  int loop, date = 0, seconds = 0;
+
+  for ( loop = 0; loop < 8; loop++, line++ ) {
+    if ( *line < '0' || *line > '9' )
+      return ( 0 );
+    date = date * 10 + ( *line - '0' );
+  }
+  if ( *line != ' ' && *line != '\t' )
+    return ( 0 );
+  while ( *line == ' ' || *line == '\t' )
+    line++;
+  if ( *line < '0' || *line > '9' )
+    return ( 0 );
+  while ( *line >= '0' && *line <= '9' )
+    seconds = seconds * 10 + ( *line++ - '0' );
+  while ( *line == ' ' || *line == '\t' || *line == '\r' )
+    line++;
+  if ( *line != '\0' )
+    return ( 0 );
+
+  entry->year = date / 10000;
+  entry->mon = ( date / 100 ) % 100;
+  entry->mday = date % 100;
+  entry->seconds = entry->marked_seconds = entry->saved_seconds = seconds;
+
+  return ( 1 );
+}
+
+
+/*
+** Read a task from file without adding it with taskAdd().
+** The whole file is read at once and all the time entries are stored
+** in one block.  Time entries that cannot be parsed are reported on
+** stderr (with their line numbers) and skipped.
+** This does not touch any global data, so it is safe to call from
+** several threads at once.
+*/
+static int task_read ( path, task )
 char *path;
 Task **task;
 {
-  FILE *fp;
-  int fd;
   Task *newtask;
-  char line[512], *ptr, *ptr2, temp[10], *annfile, *anntext;
-  int len, created, number, options, project_id = -1;
-  TaskTimeEntry *entry;
+  char *text, *ptr, *ptr2, *line, *annfile, *anntext;
+  int lineno, num_lines;
+  TaskTimeEntry *entry, parsed;
   TaskAnnotation *a;
-  struct stat buf;
 
-  fp = fopen ( path, "r" );
-  if ( !fp )
+  text = task_read_file ( path );
+  if ( ! text )
     return ( TASK_ERROR_SYSTEM_ERROR );
 
-  for ( ptr = path + strlen ( path ) - 1; *ptr != '/' && ptr != path; ptr-- );
-  if ( *ptr == '/' )
-    ptr++;
-  sscanf ( ptr, "%d.task", &number );
-
-  fgets ( line, 512, fp );
-  len = strlen ( line );
-  if ( line[len-1] == '\n' )
-    line[len-1] = '\0';
-  if ( strcmp ( line, "Format: 1.0" ) && strcmp ( line, "Format: 1.1" ) &&
-    strcmp ( line, "Format: 1.2" ) ) {
-    fclose ( fp );
+  ptr = text;
+  line = task_next_line ( &ptr );
+  if ( ! line || ( strcmp ( line, "Format: 1.0" ) &&
+    strcmp ( line, "Format: 1.1" ) && strcmp ( line, "Format: 1.2" ) ) ) {
+    free ( text );
     return ( TASK_ERROR_BAD_FILE );
   }
+  lineno = 1;
 
   newtask = (Task *) malloc ( sizeof ( Task ) );
   memset ( newtask, '\0', sizeof ( Task ) );
-  newtask->number = number;
+  newtask->number = task_file_number ( path );
   newtask->project_id = -1; /* no project */
 
-  while ( fgets ( line, 512, fp ) ) {
-    len = strlen ( line );
-    if ( line[len-1] == '\n' )
-      line[len-1] = '\0';
+  while ( ( line = task_next_line ( &ptr ) ) ) {
+    lineno++;
     if ( strncmp ( line, "Name:", 5 ) == 0 ) {
-      ptr = line + 5;
-      if ( *ptr == ' ' )
-        ptr++;
-      newtask->name = (char *) malloc ( strlen ( ptr ) + 1 );
-      strcpy ( newtask->name, ptr );
+      line += 5;
+      if ( *line == ' ' )
+        line++;
+      if ( newtask->name )
+        free ( newtask->name );
+      newtask->name = (char *) malloc ( strlen ( line ) + 1 );
+      strcpy ( newtask->name, line );
     } else if ( strncmp ( line, "Created:", 8 ) == 0 ) {
-      sscanf ( line + 8, "%d", &created );
-      newtask->created = (time_t) created;
+      newtask->created = (time_t) atoi ( line + 8 );
     } else if ( strncmp ( line, "Project:", 8 ) == 0 ) {
-      sscanf ( line + 8, "%d", &project_id );
-      newtask->project_id = project_id;
+      newtask->project_id = atoi ( line + 8 );
     } else if ( strncmp ( line, "Options:", 8 ) == 0 ) {
-      sscanf ( line + 8, "%d", &options );
-      newtask->options = (unsigned int) options;
+      newtask->options = (unsigned int) atoi ( line + 8 );
     } else if ( strcmp ( line, "Data:" ) == 0 ) {
-      while ( fgets ( line, 512, fp ) ) {
-        entry = (TaskTimeEntry *) malloc ( sizeof ( TaskTimeEntry ) );
-        memset ( entry, '\0', sizeof ( TaskTimeEntry ) );
-        strncpy ( temp, line, 4 );
-        temp[4] = '\0';
-        entry->year = atoi ( temp );
-        strncpy ( temp, line + 4, 2 );
-        temp[2] = '\0';
-        entry->mon = atoi ( temp );
-        strncpy ( temp, line + 6, 2 );
-        temp[2] = '\0';
-        entry->mday = atoi ( temp );
-        entry->seconds = atoi ( line + 9 );
-        entry->marked_seconds = entry->seconds;
-        if ( ! newtask->entries )
-          newtask->entries = (TaskTimeEntry **) malloc ( 
-            sizeof ( TaskTimeEntry * ) );
-        else
-          newtask->entries = (TaskTimeEntry **) realloc ( newtask->entries,
-            sizeof ( TaskTimeEntry * ) * ( newtask->num_entries + 1 ) );
-        newtask->entries[newtask->num_entries] = entry;
-        newtask->num_entries++;
+      /* one entry per remaining line */
+      for ( num_lines = 1, ptr2 = ptr; *ptr2 != '\0'; ptr2++ )
+        if ( *ptr2 == '\n' )
+          num_lines++;
+      taskReserveTimeEntries ( newtask, num_lines );
+      while ( ( line = task_next_line ( &ptr ) ) ) {
+        lineno++;
+        if ( task_parse_entry ( line, &parsed ) ) {
+          /* a date listed more than once gets the sum of its times */
+          entry = taskNewTimeEntry ( newtask, parsed.year, parsed.mon,
+            parsed.mday );
+          entry->seconds += parsed.seconds;
+          entry->marked_seconds = entry->saved_seconds = entry->seconds;
+        } else if ( *line != '\0' ) {
+          fprintf ( stderr, "%s:%d: %s\n", path, lineno,
+            gettext("Invalid time entry") );
+        }
       }
       break;
     } else {
-      fclose ( fp );
+      free ( text );
       taskFree ( newtask );
       return ( TASK_ERROR_BAD_FILE );
     }
   }
-  fclose ( fp );
+  free ( text );
 
   /* now load annotations */
   annfile = (char *) malloc ( strlen ( path ) + 1 );
@@ -504,54 +1087,111 @@ Task **task;
   ptr = annfile + strlen ( annfile ) - 5;
   if ( strcmp ( ptr, ".task" ) == 0 ) {
     strcpy ( ptr, ".ann" );
-    if ( stat ( annfile, &buf ) == 0 ) {
-      fd = open ( annfile, O_RDONLY );
-      anntext = (char *) malloc ( buf.st_size + 1 );
-      read ( fd, anntext, buf.st_size );
-      anntext[buf.st_size] = '\0';
-      close ( fd );
-      ptr = strtok ( anntext, "\n" );
-      while ( ptr ) {
-        ptr2 = ptr;
+    if ( ( anntext = task_read_file ( annfile ) ) ) {
+      ptr = anntext;
+      while ( ( line = task_next_line ( &ptr ) ) ) {
+        ptr2 = line;
         while ( isdigit ( *ptr2 ) )
           ptr2++;
         if ( *ptr2 == ' ' ) {
-          *ptr2 = '\0';
-          a = (TaskAnnotation *) malloc ( sizeof ( TaskAnnotation ) );
-          memset ( a, '\0', sizeof ( TaskAnnotation ) );
-          a->text_time = atoi ( ptr );
-          ptr2++;
-          a->text = (char *) malloc ( strlen ( ptr2 ) + 1 );
-          strcpy ( a->text, ptr2 );
+          *ptr2++ = '\0';
+          a = taskNewAnnotation ( newtask, (time_t) atoi ( line ), ptr2 );
           for ( ptr2 = a->text; *ptr2 != '\0'; ptr2++ )
             if ( *ptr2 == '\r' )
               *ptr2 = '\n';
-          if ( newtask->annotations == NULL ) {
-            newtask->annotations = (TaskAnnotation **) malloc (
-              sizeof ( TaskAnnotation * ) );
-          } else {
-            newtask->annotations = (TaskAnnotation **) realloc (
-              newtask->annotations,
-              ( newtask->num_annotations + 1 ) * sizeof ( TaskAnnotation * ) );
-          }
-          newtask->annotations[newtask->num_annotations] = a;
-          newtask->num_annotations++;
         }
-        ptr = strtok ( NULL, "\n" );
       }
       free ( anntext );
     }
   }
   free ( annfile );
 
-  taskAdd ( newtask );
-
   *task = newtask;
 
   return ( 0 );
 }
 
 
+/*
+** Load a task from file.
+*/
+int taskLoad ( path, task )
+char *path;
+Task **task;
+{
+  int ret;
+
+  ret = task_read ( path, task );
+  if ( ret == 0 )
+    taskAdd ( *task );
+
+  return ( ret );
+}
+
+
+/*
+** Set the number of threads taskLoadAll() uses to read task files.
+** With one thread (the default) all files are read by the caller.
+*/
+void taskSetLoadThreads ( num )
+int num;
+{
+#if HAVE_PTHREAD
+  load_threads = num > 0 ? num : 1;
+#else
+  load_threads = 1;
+#endif
+}
+
+
+/*
+** Load the task for each file in a TaskLoadQueue until there are no
+** more files.  Tasks are loaded from the snapshot if it is up to date
+** and parsed from the task file otherwise.
+*/
+static void *task_load_worker ( arg )
+void *arg;
+{
+  TaskLoadQueue *queue = (TaskLoadQueue *) arg;
+  struct stat buf, ann_buf;
+  char *path;
+  int i, len;
+  Task *task;
+
+  for ( ;; ) {
+#if HAVE_PTHREAD
+    pthread_mutex_lock ( &queue->lock );
+#endif
+    i = queue->next++;
+#if HAVE_PTHREAD
+    pthread_mutex_unlock ( &queue->lock );
+#endif
+    if ( i >= queue->num_paths )
+      break;
+
+    path = queue->paths[i];
+    if ( stat ( path, &buf ) != 0 || ! S_ISREG ( buf.st_mode ) )
+      continue;
+    task = NULL;
+    if ( queue->snapshot ) {
+      /* use the snapshot if neither the .task nor .ann has changed */
+      len = strlen ( path );
+      strcpy ( path + len - 5, ".ann" );
+      if ( snapshotLoadTask ( queue->snapshot, task_file_number ( path ),
+        &buf, stat ( path, &ann_buf ) == 0 ? &ann_buf : NULL, &task ) )
+        task = NULL;
+      strcpy ( path + len - 5, ".task" );
+    }
+    /* NOTE: add catching of errors here... */
+    if ( ! task && task_read ( path, &task ) )
+      task = NULL;
+    queue->results[i] = task;
+  }
+
+  return ( NULL );
+}
+
+
 
 int taskLoadAll ( taskdir )
 char *taskdir;
@@ -584,26 +1224,75 @@ char *taskdir;
 #else
   DIR *dir;
   struct dirent *entry;
-  struct stat buf;
-  char *path, *ptr;
-  Task *task;
+  char *ptr;
+  TaskLoadQueue queue;
+  int loop, max_paths = 0;
+#if HAVE_PTHREAD
+  pthread_t *threads;
+  int num_threads;
+#endif
 
   dir = opendir ( taskdir );
   if ( ! dir )
     return ( TASK_ERROR_SYSTEM_ERROR );
+
+  /* get the list of task files */
+  memset ( &queue, '\0', sizeof ( queue ) );
   while ( ( entry = readdir ( dir ) ) ) {
-    path = (char *) malloc ( strlen ( taskdir ) + strlen ( entry->d_name )
-      + 2 );
-    sprintf ( path, "%s/%s", taskdir, entry->d_name );
-    if ( stat ( path, &buf ) == 0 ) {
-      for ( ptr = entry->d_name; isdigit ( *ptr ); ptr++ ) ;
-      if ( strcmp ( ptr, ".task" ) == 0 && S_ISREG ( buf.st_mode ) ) {
-        /* NOTE: add catching of errors here... */
-        taskLoad ( path, &task );
-      }
+    for ( ptr = entry->d_name; isdigit ( *ptr ); ptr++ ) ;
+    if ( strcmp ( ptr, ".task" ) )
+      continue;
+    if ( queue.num_paths == max_paths ) {
+      max_paths = max_paths ? max_paths * 2 : 64;
+      queue.paths = (char **) ( queue.paths ?
+        realloc ( queue.paths, max_paths * sizeof ( char * ) ) :
+        malloc ( max_paths * sizeof ( char * ) ) );
     }
-    free ( path );
+    queue.paths[queue.num_paths] = (char *) malloc ( strlen ( taskdir ) +
+      strlen ( entry->d_name ) + 2 );
+    sprintf ( queue.paths[queue.num_paths], "%s/%s", taskdir,
+      entry->d_name );
+    queue.num_paths++;
   }
+  closedir ( dir );
+  if ( ! queue.num_paths )
+    return ( 0 );
+
+  /* load them, in parallel if we can */
+  queue.results = (Task **) malloc ( queue.num_paths * sizeof ( Task * ) );
+  memset ( queue.results, '\0', queue.num_paths * sizeof ( Task * ) );
+  queue.snapshot = snapshotOpen ( taskdir );
+#if HAVE_PTHREAD
+  num_threads = load_threads < queue.num_paths ?
+    load_threads : queue.num_paths;
+  threads = (pthread_t *) malloc ( num_threads * sizeof ( pthread_t ) );
+  pthread_mutex_init ( &queue.lock, NULL );
+  /* the calling thread does its share of the work too */
+  for ( loop = 1; loop < num_threads; loop++ ) {
+    if ( pthread_create ( &threads[loop], NULL, task_load_worker, &queue ) )
+      break;
+  }
+  num_threads = loop;
+  task_load_worker ( &queue );
+  for ( loop = 1; loop < num_threads; loop++ )
+    pthread_join ( threads[loop], NULL );
+  pthread_mutex_destroy ( &queue.lock );
+  free ( threads );
+#else
+  task_load_worker ( &queue );
+#endif
+  if ( queue.snapshot )
+    snapshotClose ( queue.snapshot );
+
+  /* add the tasks from this thread only, in the same order the
+     files were found in the directory */
+  for ( loop = 0; loop < queue.num_paths; loop++ ) {
+    if ( queue.results[loop] )
+      taskAdd ( queue.results[loop] );
+    free ( queue.paths[loop] );
+  }
+  free ( queue.paths );
+  free ( queue.results );
 
 #endif
   return ( 0 );
@@ -630,11 +1319,13 @@ int task_error;
 
 
 
-TaskTimeEntry *taskGetTimeEntry ( task, year, month, day )
-Task *task;
-int year, month, day;
+/*
+** Turn a two digit year (years since 1900 mod 100) into a four digit
+** year in the current century.
+*/
+static int task_full_year ( year )
+int year;
 {
-  int loop;
   struct tm *tm;
   time_t now;
 
@@ -643,55 +1334,307 @@ int year, month, day;
     tm = localtime ( &now );
     year += 1900 + ( tm->tm_year % 100 );
   }
-  
-  for ( loop = 0; loop < task->num_entries; loop++ ) {
-    if ( task->entries[loop]->year == year &&
-      task->entries[loop]->mon == month &&
-      task->entries[loop]->mday == day )
-      return ( task->entries[loop] );
+  return ( year );
+}
+
+
+/*
+** Find the index of the first time entry on or after the specified
+** date (a TASK_DATE() value).  Returns task->num_entries if all entries
+** are before the date.
+*/
+static int task_entry_index ( task, date )
+Task *task;
+int date;
+{
+  int low = 0, high = task->num_entries, mid;
+
+  while ( low < high ) {
+    mid = ( low + high ) / 2;
+    if ( task->entries[mid]->date < date )
+      low = mid + 1;
+    else
+      high = mid;
   }
+  return ( low );
+}
+
+
+/*
+** Get the time entry for the specified date.
+** Returns NULL if the task has no entry for that date.
+*/
+TaskTimeEntry *taskGetTimeEntry ( task, year, month, day )
+Task *task;
+int year, month, day;
+{
+  int date, i;
+
+  date = TASK_DATE ( task_full_year ( year ), month, day );
+  i = task_entry_index ( task, date );
+  if ( i < task->num_entries && task->entries[i]->date == date )
+    return ( task->entries[i] );
 
   return ( NULL );
 }
 
 
+/*
+** Get all the time entries between two dates (TASK_DATE() values,
+** inclusive).  Since entries are kept sorted by date, they are
+** returned as a slice of task->entries: first is set to the first entry
+** in the range and the number of entries is returned.
+** The slice is only valid until the next call to taskNewTimeEntry().
+*/
+int taskGetTimeEntryRange ( task, from_date, to_date, first )
+Task *task;
+int from_date, to_date;
+TaskTimeEntry ***first;
+{
+  int start, end;
+
+  start = task_entry_index ( task, from_date );
+  end = task_entry_index ( task, to_date + 1 );
+  *first = task->entries + start;
+  return ( end > start ? end - start : 0 );
+}
 
 
+/*
+** Rebuild the Fenwick tree of a task's time entries.  Element i
+** (1-based) of the tree holds the sum of the seconds of the entries
+** from i - lowbit(i) up to i - 1, so any prefix sum can be found by
+** adding up O(log n) elements.
+*/
+static void task_sum_tree_build ( task )
+Task *task;
+{
+  int i, j;
+
+  if ( task->sum_tree_max < task->max_entries + 1 ) {
+    if ( task->sum_tree )
+      free ( task->sum_tree );
+    task->sum_tree_max = task->max_entries + 1;
+    task->sum_tree = (int *) malloc ( task->sum_tree_max * sizeof ( int ) );
+  }
+  task->sum_tree[0] = 0;
+  for ( i = 1; i <= task->num_entries; i++ )
+    task->sum_tree[i] = task->entries[i - 1]->seconds;
+  for ( i = 1; i <= task->num_entries; i++ ) {
+    j = i + ( i & -i );
+    if ( j <= task->num_entries )
+      task->sum_tree[j] += task->sum_tree[i];
+  }
+  task->sum_tree_valid = 1;
+}
+
+
+/*
+** Add seconds to an entry's element in the Fenwick tree (if it has
+** been built).  Called before or after the entry itself is changed.
+*/
+static void task_sum_tree_update ( task, entry, seconds )
+Task *task;
+TaskTimeEntry *entry;
+int seconds;
+{
+  int i;
+
+  if ( ! task->sum_tree_valid )
+    return;
+  /* there is only one entry per date, so it is at its date's index */
+  i = task_entry_index ( task, entry->date );
+  if ( i >= task->num_entries || task->entries[i] != entry ) {
+    task->sum_tree_valid = 0;
+    return;
+  }
+  for ( i++; i <= task->num_entries; i += ( i & -i ) )
+    task->sum_tree[i] += seconds;
+}
+
+
+/*
+** Sum the seconds of the first num entries of a task.
+*/
+static int task_sum_prefix ( task, num )
+Task *task;
+int num;
+{
+  int sum = 0;
+
+  for ( ; num > 0; num -= ( num & -num ) )
+    sum += task->sum_tree[num];
+  return ( sum );
+}
+
+
+/*
+** Get the total time (in seconds) of a task between two dates
+** (TASK_DATE() values, inclusive).  Use TASK_DATE_MIN and TASK_DATE_MAX
+** for the total of all time.
+*/
+int taskSumRange ( task, from_date, to_date )
+Task *task;
+int from_date, to_date;
+{
+  if ( from_date > to_date )
+    return ( 0 );
+  if ( ! task->sum_tree_valid )
+    task_sum_tree_build ( task );
+  return ( task_sum_prefix ( task, task_entry_index ( task, to_date + 1 ) ) -
+    task_sum_prefix ( task, task_entry_index ( task, from_date ) ) );
+}
+
+
+/*
+** Add a new time entry for the specified date.  The entry is inserted
+** so that task->entries stays sorted by date.  A task has at most one
+** entry per date: if there already is one for the date, it is returned
+** instead (callers loading a task add to its seconds, so duplicate
+** dates in a file are merged into one entry).
+*/
 TaskTimeEntry *taskNewTimeEntry ( task, year, month, day )
 Task *task;
 int year, month, day;
 {
-  struct tm *tm;
-  time_t now;
   TaskTimeEntry *ret;
-
-  if ( year < 100 ) {
-    time ( &now );
-    tm = localtime ( &now );
-    year += 1900 + ( tm->tm_year % 100 );
+  int date, low, high, mid;
+
+  year = task_full_year ( year );
+  date = TASK_DATE ( year, month, day );
+
+  /* new entries are almost always for today, so check the end first */
+  low = high = task->num_entries;
+  if ( low > 0 && task->entries[low - 1]->date > date ) {
+    low = 0;
+    while ( low < high ) {
+      mid = ( low + high ) / 2;
+      if ( task->entries[mid]->date <= date )
+        low = mid + 1;
+      else
+        high = mid;
+    }
   }
+  if ( low > 0 && task->entries[low - 1]->date == date )
+    return ( task->entries[low - 1] );
 
-  ret = (TaskTimeEntry *) malloc ( sizeof ( TaskTimeEntry ) );
+  task->entries = (TaskTimeEntry **) task_grow_array ( task->entries,
+    &task->max_entries, task->num_entries + 1, sizeof ( TaskTimeEntry * ) );
+  ret = (TaskTimeEntry *) task_block_alloc ( &task->entry_blocks,
+    sizeof ( TaskTimeEntry ) );
 
   ret->year = year;
   ret->mon = month;
   ret->mday = day;
+  ret->date = date;
   ret->seconds = 0;
   ret->marked_seconds = 0;
+  ret->saved_seconds = 0;
 
-  if ( task->entries )
-    task->entries = (TaskTimeEntry **) realloc ( task->entries,
-      ( task->num_entries + 1 ) * ( sizeof ( TaskTimeEntry * ) ) );
-  else
-    task->entries = (TaskTimeEntry **) malloc ( ( task->num_entries + 1 )
-      * ( sizeof ( TaskTimeEntry * ) ) );
-  task->entries[task->num_entries] = ret;
+  if ( low < task->num_entries )
+    memmove ( task->entries + low + 1, task->entries + low,
+      ( task->num_entries - low ) * sizeof ( TaskTimeEntry * ) );
+  task->entries[low] = ret;
   task->num_entries++;
+  /* callers loading a task set the seconds directly, so rebuild later */
+  task->sum_tree_valid = 0;
 
   return ( ret );
 }
 
 
+/*
+** Make room for num more time entries in a task so that adding them
+** with taskNewTimeEntry() does not need any more allocations.
+** Used when loading a task and the number of entries is known.
+*/
+void taskReserveTimeEntries ( task, num )
+Task *task;
+int num;
+{
+  if ( num <= 0 )
+    return;
+  task->entries = (TaskTimeEntry **) task_grow_array ( task->entries,
+    &task->max_entries, task->num_entries + num,
+    sizeof ( TaskTimeEntry * ) );
+  task_block_reserve ( &task->entry_blocks, sizeof ( TaskTimeEntry ), num );
+}
+
+
+/*
+** Get the local date (TASK_DATE() value) of an annotation, with
+** time_offset seconds taken off so that late night annotations
+** count towards the previous day.
+*/
+static int task_annotation_date ( a, time_offset )
+TaskAnnotation *a;
+int time_offset;
+{
+  struct tm *tm;
+  time_t then;
+
+  then = a->text_time - time_offset;
+  tm = localtime ( &then );
+  return ( TASK_DATE ( tm->tm_year + 1900, tm->tm_mon + 1, tm->tm_mday ) );
+}
+
+
+/*
+** Add an annotation to a task in memory only (see taskAddAnnotation()).
+*/
+TaskAnnotation *taskNewAnnotation ( task, text_time, text )
+Task *task;
+time_t text_time;
+char *text;
+{
+  TaskAnnotation *a;
+
+  task->annotations = (TaskAnnotation **) task_grow_array (
+    task->annotations, &task->max_annotations, task->num_annotations + 1,
+    sizeof ( TaskAnnotation * ) );
+  a = (TaskAnnotation *) task_block_alloc ( &task->annotation_blocks,
+    sizeof ( TaskAnnotation ) );
+  a->text_time = text_time;
+  a->text = (char *) malloc ( strlen ( text ) + 1 );
+  strcpy ( a->text, text );
+  task->annotations[task->num_annotations] = a;
+  task->num_annotations++;
+
+  /* keep the day index up to date if this is the latest day */
+  if ( task->day_index_valid ) {
+    a->date = task_annotation_date ( a, task->day_index_offset );
+    if ( task->num_annotations > 1 &&
+      task->day_index[task->num_annotations - 2]->date > a->date ) {
+      task->day_index_valid = 0;
+    } else {
+      task->day_index = (TaskAnnotation **) task_grow_array (
+        task->day_index, &task->max_day_index, task->num_annotations,
+        sizeof ( TaskAnnotation * ) );
+      task->day_index[task->num_annotations - 1] = a;
+    }
+  }
+
+  return ( a );
+}
+
+
+/*
+** Make room for num more annotations in a task.
+*/
+void taskReserveAnnotations ( task, num )
+Task *task;
+int num;
+{
+  if ( num <= 0 )
+    return;
+  task->annotations = (TaskAnnotation **) task_grow_array (
+    task->annotations, &task->max_annotations, task->num_annotations + num,
+    sizeof ( TaskAnnotation * ) );
+  task_block_reserve ( &task->annotation_blocks, sizeof ( TaskAnnotation ),
+    num );
+}
+
+
 /*
 ** Get the options for the specified task.
 */
@@ -720,15 +1663,90 @@ void taskSetOption ( task, option )
 Task *task;
 unsigned int option;
 {
-  task->options |= option;
+  if ( ( task->options & option ) != option ) {
+    task->options |= option;
+    task->dirty |= TASK_DIRTY_OPTIONS;
+    task_changed ( TASK_DATE_MIN );
+  }
 }
 
 void taskUnsetOption ( task, option )
 Task *task;
 unsigned int option;
 {
-  if ( taskOptionEnabled ( task, option ) )
+  if ( taskOptionEnabled ( task, option ) ) {
     task->options -= option;
+    task->dirty |= TASK_DIRTY_OPTIONS;
+    task_changed ( TASK_DATE_MIN );
+  }
+}
+
+
+/*
+** Change the name of a task.
+*/
+void taskSetName ( task, name )
+Task *task;
+char *name;
+{
+  if ( task->name && strcmp ( task->name, name ) == 0 )
+    return;
+  free ( task->name );
+  task->name = (char *) malloc ( strlen ( name ) + 1 );
+  strcpy ( task->name, name );
+  task->dirty |= TASK_DIRTY_NAME;
+  task_changed ( TASK_DATE_MIN );
+}
+
+
+/*
+** Change the project a task belongs to (-1 for no project).
+*/
+void taskSetProject ( task, project_id )
+Task *task;
+int project_id;
+{
+  if ( task->project_id != project_id ) {
+    task->project_id = project_id;
+    task->dirty |= TASK_DIRTY_PROJECT;
+    task_changed ( TASK_DATE_MIN );
+  }
+}
+
+
+/*
+** Add (or subtract if negative) time to a task's time entry.
+** All changes to an entry's seconds should go through here or
+** taskSetTime() so that the task gets saved on the next taskSaveAll().
+*/
+void taskAddTime ( task, entry, seconds )
+Task *task;
+TaskTimeEntry *entry;
+int seconds;
+{
+  if ( seconds ) {
+    entry->seconds += seconds;
+    task->dirty |= TASK_DIRTY_TIME;
+    task_sum_tree_update ( task, entry, seconds );
+    task_changed ( entry->date );
+  }
+}
+
+
+/*
+** Set the time of a task's time entry.
+*/
+void taskSetTime ( task, entry, seconds )
+Task *task;
+TaskTimeEntry *entry;
+int seconds;
+{
+  if ( entry->seconds != seconds ) {
+    task_sum_tree_update ( task, entry, seconds - entry->seconds );
+    entry->seconds = seconds;
+    task->dirty |= TASK_DIRTY_TIME;
+    task_changed ( entry->date );
+  }
 }
 
 /*
@@ -745,22 +1763,11 @@ char *text;
   char *ptr, *path, *newtext;
   TaskAnnotation *a;
   FILE *fp;
+  time_t now;
 
-  a = (TaskAnnotation *) malloc ( sizeof ( TaskAnnotation ) );
-  memset ( a, '\0', sizeof ( TaskAnnotation ) );
-  time ( &a->text_time );
-  a->text = (char *) malloc ( strlen ( text ) + 1 );
-  strcpy ( a->text, text );
-
-  if ( task->annotations == NULL ) {
-    task->annotations = (TaskAnnotation **) malloc (
-      sizeof ( TaskAnnotation * ) );
-  } else {
-    task->annotations = (TaskAnnotation **) realloc ( task->annotations,
-      ( task->num_annotations + 1 ) * sizeof ( TaskAnnotation * ) );
-  }
-  task->annotations[task->num_annotations] = a;
-  task->num_annotations++;
+  time ( &now );
+  a = taskNewAnnotation ( task, now, text );
+  task_changed ( TASK_DATE_MIN );
 
   /* now save to file */
   path = (char *) malloc ( strlen ( taskdir ) + 10 );
@@ -782,9 +1789,40 @@ char *text;
 
 
 /*
-** Get all annotations for the specified task on the specified day.
-** NOTE: Caller must free return value.
-** ??? Maybe we should take the midnight offset into consideration here ???
+** Build the index of a task's annotations sorted by day.
+** Annotations are almost always in time order already, so an insertion
+** sort (which also keeps annotations on the same day in the order they
+** were added) does little more than one pass.
+*/
+static void task_build_day_index ( task, time_offset )
+Task *task;
+int time_offset;
+{
+  TaskAnnotation *a;
+  int loop, i;
+
+  task->day_index = (TaskAnnotation **) task_grow_array ( task->day_index,
+    &task->max_day_index, task->num_annotations,
+    sizeof ( TaskAnnotation * ) );
+  for ( loop = 0; loop < task->num_annotations; loop++ ) {
+    a = task->annotations[loop];
+    a->date = task_annotation_date ( a, time_offset );
+    for ( i = loop; i > 0 && task->day_index[i - 1]->date > a->date; i-- )
+      task->day_index[i] = task->day_index[i - 1];
+    task->day_index[i] = a;
+  }
+  task->day_index_offset = time_offset;
+  task->day_index_valid = 1;
+}
+
+
+/*
+** Get all the annotations for a task for the specified day.
+** The time_offset is the number of seconds after midnight that
+** should still count as the previous day.
+** The annotations are returned as a slice of the task's day index,
+** so the caller should NOT free the return value.  It is only valid
+** until the next annotation is added.
 */
 TaskAnnotation **TaskGetAnnotationEntries ( task, year, month, day,
   time_offset, num_ret )
@@ -793,31 +1831,26 @@ int year, month, day;
 int time_offset;
 int *num_ret;
 {
-  TaskAnnotation **ret = NULL;
-  int loop = 0;
-  struct tm *tm;
-  int num = 0;
-  time_t then;
-
-  for ( loop = 0; loop < task->num_annotations; loop++ ) {
-    then = task->annotations[loop]->text_time - time_offset;
-    tm = localtime ( &then );
-    if ( tm->tm_year + 1900 == year &&
-      tm->tm_mon + 1 == month &&
-      tm->tm_mday == day ) {
-      if ( num ) {
-        ret = (TaskAnnotation **) realloc ( ret,
-          ( num + 1 ) * sizeof ( TaskAnnotation * ) );
-      } else {
-        ret = (TaskAnnotation **) malloc ( sizeof ( TaskAnnotation * ) );
-      }
-      ret[num] = task->annotations[loop];
-      num++;
-    }
+  int date, low, high, mid, end;
+
+  if ( ! task->day_index_valid || task->day_index_offset != time_offset )
+    task_build_day_index ( task, time_offset );
+
+  date = TASK_DATE ( year, month, day );
+  low = 0;
+  high = task->num_annotations;
+  while ( low < high ) {
+    mid = ( low + high ) / 2;
+    if ( task->day_index[mid]->date < date )
+      low = mid + 1;
+    else
+      high = mid;
   }
+  for ( end = low; end < task->num_annotations &&
+    task->day_index[end]->date == date; end++ ) ;
 
-  *num_ret = num;
-  return ( ret );
+  *num_ret = end - low;
+  return ( end > low ? task->day_index + low : NULL );
 }
 
 
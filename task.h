@@ -20,6 +20,15 @@
  *	Free Software Foundation, Inc., 59 Temple Place,
  *	Suite 330, Boston, MA  02111-1307, USA
  *
+ *	17-Oct-2026	taskGetSaveCounts() also returns the number of
+ *			tasks appended to the journal.
+ *	16-Oct-2026	Added taskDataVersion() and taskChangedSince().
+ *	16-Oct-2026	Index annotations by day.
+ *	16-Oct-2026	Added taskSumRange().
+ *	16-Oct-2026	Keep time entries sorted by a packed date key.
+ *	16-Oct-2026	Save changes to the journal when it is open.
+ *	16-Oct-2026	Track unsaved changes so taskSaveAll() only
+ *			writes tasks that have been modified.
  *	17-Apr-2005	Add support for subtracting a particular offset
  *			off of timers.  (Russ Allbery)
  */
@@ -34,20 +43,47 @@
 #define TASK_ERROR_SYSTEM_ERROR	1	/* check errno value */
 #define TASK_ERROR_BAD_FILE	2	/* bad file format */
 
+/* Values for Task.dirty (what has changed since the last save) */
+#define TASK_DIRTY_TIME		0x0001	/* time entries changed */
+#define TASK_DIRTY_NAME		0x0002	/* name changed */
+#define TASK_DIRTY_OPTIONS	0x0004	/* options changed */
+#define TASK_DIRTY_PROJECT	0x0008	/* project changed */
+#define TASK_DIRTY_NEW		0x0010	/* never been saved */
+
+/* Pack a date into one int (YYYYMMDD) that sorts in date order */
+#define TASK_DATE(year,mon,mday)	((year) * 10000 + (mon) * 100 + (mday))
+#define TASK_DATE_MIN		0
+#define TASK_DATE_MAX		TASK_DATE(9999,12,31)
+
 typedef struct {
   int seconds;		/* time in seconds */
   int mon, mday, year;	/* MM/DD/YYYY */
+  int date;		/* TASK_DATE() of above; entries sorted by this */
   int marked_seconds;	/* time in seconds - used by taskMark() */
+  int saved_seconds;	/* time in seconds when last saved */
 } TaskTimeEntry;
 
 typedef struct {
   char *text;		/* text of annotiation */
   time_t text_time;	/* GMT of annotation */
+  int date;		/* TASK_DATE() of local day (for day index) */
 } TaskAnnotation;
 
+/*
+** Time entries and annotations are handed out from blocks that are
+** never moved or shrunk, so pointers to them (such as
+** TaskData.todays_entry) stay valid until the task is freed.
+** The items follow this header in the same allocation.
+*/
+typedef struct _TaskBlock {
+  struct _TaskBlock *next;	/* block allocated before this one */
+  int size;			/* number of items that fit in block */
+  int used;			/* number of items handed out */
+} TaskBlock;
+
 typedef struct {
   char *name;			/* name of task */
-  TaskTimeEntry **entries;	/* entries */
+  TaskTimeEntry **entries;	/* entries (sorted by date) */
   int num_entries;		/* number entries (dates) */
   time_t created;		/* time created */
   int number;			/* unique task id number */
@@ -55,6 +91,19 @@ typedef struct {
   unsigned int options;		/* app-defined bit-or options */
   TaskAnnotation **annotations;	/* annotations */
   int num_annotations;		/* size of above array */
+  unsigned int dirty;		/* TASK_DIRTY_* changes since last save */
+  int journaled;		/* has changes in journal not in task file */
+  int max_entries;		/* allocated size of entries */
+  int max_annotations;		/* allocated size of annotations */
+  TaskBlock *entry_blocks;	/* storage for entries */
+  TaskBlock *annotation_blocks;	/* storage for annotations */
+  int *sum_tree;		/* Fenwick tree of entry seconds */
+  int sum_tree_max;		/* allocated size of sum_tree */
+  int sum_tree_valid;		/* sum_tree is up to date */
+  TaskAnnotation **day_index;	/* annotations sorted by date */
+  int max_day_index;		/* allocated size of day_index */
+  int day_index_offset;		/* midnight offset day_index was built with */
+  int day_index_valid;		/* day_index is up to date */
 } Task;
 
 /*
@@ -73,6 +122,7 @@ void taskRestoreAll ();
 void taskClearAll ();
 int taskLoad ( char *file, Task **task );
 int taskLoadAll ( char *taskdir );
+void taskSetLoadThreads ( int num );
 Task *taskCreate ( char *name );
 int taskDelete ( Task *task, char *taskdir );
 void taskFree ();
@@ -81,14 +131,29 @@ Task *taskGet ( int number );
 Task *taskGetFirst ();
 Task *taskGetNext ();
 TaskTimeEntry *taskGetTimeEntry ( Task *task, int year, int month, int day );
+int taskGetTimeEntryRange ( Task *task, int from_date, int to_date,
+  TaskTimeEntry ***first );
+int taskSumRange ( Task *task, int from_date, int to_date );
 TaskTimeEntry *taskNewTimeEntry ( Task *task, int year, int month, int day );
+void taskReserveTimeEntries ( Task *task, int num );
+TaskAnnotation *taskNewAnnotation ( Task *task, time_t text_time, char *text );
+void taskReserveAnnotations ( Task *task, int num );
 unsigned int taskOptions ( Task *task );
 unsigned int taskOptionEnabled ( Task *task, unsigned int option );
 void taskSetOption ( Task *task, unsigned int option );
 void taskUnsetOption ( Task *task, unsigned int option );
 void taskAddAnnotation ( Task *task, char *taskdir, char *text );
+void taskSetName ( Task *task, char *name );
+void taskSetProject ( Task *task, int project_id );
+void taskAddTime ( Task *task, TaskTimeEntry *entry, int seconds );
+void taskSetTime ( Task *task, TaskTimeEntry *entry, int seconds );
+void taskGetSaveCounts ( int *written, int *journaled, int *skipped );
+int taskReplay ( char *record, char *taskdir );
+int taskCompact ( char *taskdir );
 TaskAnnotation **TaskGetAnnotationEntries ( Task *task, int year,
   int month, int day, int time_offset, int *num_ret );
 char *taskErrorString ( int task_error );
+unsigned long taskDataVersion ();
+int taskChangedSince ( unsigned long version, int from_date, int to_date );
 
 #endif /* _TASK_H */
@@ -30,6 +30,8 @@
  *	https://www.k5n.us/gtimer/
  *
  * History:
+ *	16-Oct-2026	Map selected rows straight to their tasks using the
+ *			index stored with each row.
  *      07-Sep-2007	Updated to use GtkTreeView 
  *	09-Mar-2000	Updated call to create_confirm_window()
  *	18-Mar-1999	Internationalization
@@ -77,8 +79,6 @@ typedef struct {
 //GtkTreeView *task_list;   // PV: +
   TaskData **tasks;
   int num_tasks;
-//GtkWidget **list_items;   // PV: -
-  GtkTreePath **list_items; // PV: +
 } HideData;
 
 
@@ -95,12 +95,7 @@ gpointer data;
   int loop;
   // PV:
   GtkTreeSelection *select;
-#if PV_DEBUG
-  volatile const char *s1;
-  volatile const char *s2;
-#else
-  const char *s1, *s2;
-#endif
+  CustomList *customlist;
 
 //  selected = GTK_LIST ( hd->task_list ) ->selection;
 
@@ -119,29 +114,29 @@ gpointer data;
   }
 
   /* which tasks were selected... */
+  /* each row in the list carries the index of its task in hd->tasks */
+  customlist = CUSTOM_LIST ( gtk_tree_view_get_model (
+    GTK_TREE_VIEW ( hd->task_list ) ) );
   for ( item = selected; item != NULL; item = item->next ) {
-    s1 = gtk_tree_path_to_string(item->data);
-    for ( loop = 0; loop < hd->num_tasks; loop++ ) {
-      s2 = gtk_tree_path_to_string( hd->list_items[loop] );
-//    if ( item->data == hd->list_items[loop] ) {
-      if ( strcmp (s1, s2) == 0 ) {
-        /* don't need to realloc visible_tasks[] */
-        visible_tasks[num_visible_tasks] = hd->tasks[loop];
-        visible_tasks[num_visible_tasks]->moved = 1;
-        visible_tasks[num_visible_tasks]->new_task = 1; /* add back */
-        taskUnsetOption ( visible_tasks[num_visible_tasks]->task,
-          GTIMER_TASK_OPTION_HIDDEN );
-        num_visible_tasks++;
-      }
-    }
+    loop = custom_list_get_index ( customlist, (GtkTreePath *) item->data );
+    if ( loop < 0 || loop >= hd->num_tasks )
+      continue;
+    /* don't need to realloc visible_tasks[] */
+    visible_tasks[num_visible_tasks] = hd->tasks[loop];
+    visible_tasks[num_visible_tasks]->moved = 1;
+    visible_tasks[num_visible_tasks]->new_task = 1; /* add back */
+    taskUnsetOption ( visible_tasks[num_visible_tasks]->task,
+      GTIMER_TASK_OPTION_HIDDEN );
+    num_visible_tasks++;
   }
+  g_list_foreach ( selected, (GFunc) gtk_tree_path_free, NULL );
+  g_list_free ( selected );
 
   gtk_grab_remove ( hd->window );
   gtk_widget_destroy ( hd->window );
 
   /* Free resources */
   free ( hd->tasks );
-  free ( hd->list_items );
   free ( hd );
 
   /* redraw the task list */
@@ -157,7 +152,6 @@ gpointer data;
   gtk_grab_remove ( hd->window );
   gtk_widget_destroy ( hd->window );
   free ( hd->tasks );
-  free ( hd->list_items );
   free ( hd );
 }
 
@@ -200,7 +194,6 @@ GtkWidget *create_unhide_window ()
   /*GtkTooltips *tooltips;*/
   GtkWidget *label, *button, *scrolled;
   HideData *hd;
-  GList *items = NULL;
   int loop, count;
   char msg[100];
   // PV:
@@ -209,7 +202,6 @@ GtkWidget *create_unhide_window ()
   GtkCellRenderer *renderer;
   GtkTreeViewColumn *col;
   GtkTreeSelection *select;
-  gchar * xtaskname;
 
   customlist = custom_list_new();
 
@@ -239,8 +231,6 @@ GtkWidget *create_unhide_window ()
 
   hd->tasks = (TaskData **) malloc ( sizeof ( TaskData * ) *
     num_tasks ); /* more than we need... */
-  hd->list_items = (GtkWidget **) malloc ( sizeof ( GtkTreePath * ) *
-    num_tasks ); /* more than we need... */
   for ( loop = 0, count = 0; loop < num_tasks; loop++ ) {
     if ( taskOptionEnabled ( tasks[loop]->task, GTIMER_TASK_OPTION_HIDDEN ) ) {
 
@@ -249,10 +239,8 @@ GtkWidget *create_unhide_window ()
       else
         snprintf ( temp, sizeof (temp), "[%s] %s", tasks[loop]->project_name,
 	  tasks[loop]->task->name );
-      items = g_list_append ( items, hd->list_items[count] );
       hd->tasks[count] = tasks[loop];
-      xtaskname = g_strdup_printf ("%s", temp);
-      hd->list_items[count] = custom_list_append_record( customlist, xtaskname);
+      custom_list_append_record ( customlist, temp, count );
       count++;
     }
   }